@@ -6,6 +6,7 @@
 #include "caffe/common.hpp"
 #include "caffe/syncedmem.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/float16.hpp"
 
 namespace caffe {
 
@@ -13,14 +14,17 @@ template <typename Dtype>
 class Blob {
  public:
   Blob()
-       : num_(0), channels_(0), length_(0), height_(0), width_(0), count_(0), data_(),
-       diff_() {}
+       : num_(0), channels_(0), length_(0), height_(0), width_(0), count_(0),
+       capacity_(0), data_(), diff_(), compact_(false) {}
   explicit Blob(const int num, const int channels, const int length, const int height,
     const int width);
 
   explicit Blob(const int num, const int channels, const int height,
     const int width);
 
+  // Change the dimensions of the blob. The underlying memory is only
+  // reallocated when the new count exceeds the current capacity, so shrinking
+  // a blob (e.g. a smaller batch) and growing it back is free.
   void Reshape(const int num, const int channels, const int length, const int height,
     const int width);
 
@@ -35,6 +39,7 @@ class Blob {
   inline int height() const { return height_; }
   inline int width() const { return width_; }
   inline int count() const {return count_; }
+  inline int capacity() const { return capacity_; }
 
   // for backward compatibility
   inline int offset(const int n){
@@ -101,6 +106,8 @@ class Blob {
 
   const Dtype* cpu_data() const;
   void set_cpu_data(Dtype* data);
+  // See SyncedMemory::set_cpu_data.
+  void set_cpu_data(Dtype* data, const shared_ptr<void>& owner);
   const Dtype* gpu_data() const;
   const Dtype* cpu_diff() const;
   const Dtype* gpu_diff() const;
@@ -113,6 +120,19 @@ class Blob {
   void Lift3DFromProto(const BlobProto& proto, const int l);
   void ToProto(BlobProto* proto, bool write_diff = false) const;
 
+  // Compact storage keeps the data as 16-bit floats in the given format and
+  // frees the Dtype data, halving its footprint for float. Layers that
+  // support it compute from cpu_compact_data(); the Dtype data accessors fail
+  // until Expand() converts the data back. The diff is left alone. Layers
+  // that write a compact top (see Net::CompactActivations) store into
+  // mutable_cpu_compact_data().
+  void Compact(const HalfFormat format);
+  void Expand();
+  inline bool compact() const { return compact_; }
+  inline HalfFormat compact_format() const { return compact_format_; }
+  const uint16_t* cpu_compact_data() const;
+  uint16_t* mutable_cpu_compact_data();
+
   // Set the data_/diff_ shared_ptr to point to the SyncedMemory holding the
   // data_/diff_ of Blob other -- useful in layers which simply perform a copy
   // in their forward or backward pass.
@@ -120,6 +140,14 @@ class Blob {
   // shared_ptr calls its destructor when reset with the = operator.
   void ShareData(const Blob& other);
   void ShareDiff(const Blob& other);
+  // Make the data_/diff_ of this blob views of count() elements of the
+  // data_/diff_ of Blob other from element offset on, so that a layer writing
+  // this blob writes that part of other in place (see ConcatLayer). A Reshape
+  // to a different count gives the blob its own memory again.
+  void ShareView(const Blob& other, const int offset);
+  // Whether data_/diff_ is still the view of Blob other at offset.
+  bool DataIsViewOf(const Blob& other, const int offset) const;
+  bool DiffIsViewOf(const Blob& other, const int offset) const;
 
  protected:
   shared_ptr<SyncedMemory> data_;
@@ -130,6 +158,10 @@ class Blob {
   int height_;
   int width_;
   int count_;
+  int capacity_;
+  shared_ptr<SyncedMemory> compact_data_;
+  bool compact_;
+  HalfFormat compact_format_;
 
   DISABLE_COPY_AND_ASSIGN(Blob);
 };  // class Blob
@@ -10,6 +10,8 @@
 #include <driver_types.h>  // cuda driver types
 #include <glog/logging.h>
 
+#include "caffe/util/host_allocator.hpp"
+
 // Disable the copy and assignment operator for a class.
 #define DISABLE_COPY_AND_ASSIGN(classname) \
 private:\
@@ -97,12 +99,22 @@ class Caffe {
     shared_ptr<Generator> generator_;
   };
 
+  // The per-thread state set up by InitThreadContext().
+  struct ThreadContext {
+    Brew mode;
+    Phase phase;
+    shared_ptr<RNG> random_generator;
+  };
+
   // Getters for boost rng, curand, and cublas handles
   inline static RNG& rng_stream() {
-    if (!Get().random_generator_) {
-      Get().random_generator_.reset(new RNG());
+    ThreadContext* context = thread_context();
+    shared_ptr<RNG>& generator =
+        context ? context->random_generator : Get().random_generator_;
+    if (!generator) {
+      generator.reset(new RNG());
     }
-    return *(Get().random_generator_);
+    return *generator;
   }
   inline static cublasHandle_t cublas_handle() { return Get().cublas_handle_; }
   inline static curandGenerator_t curand_generator() {
@@ -110,24 +122,63 @@ class Caffe {
   }
 
   // Returns the mode: running on CPU or GPU.
-  inline static Brew mode() { return Get().mode_; }
+  inline static Brew mode() {
+    ThreadContext* context = thread_context();
+    return context ? context->mode : Get().mode_;
+  }
   // Returns the phase: TRAIN or TEST.
-  inline static Phase phase() { return Get().phase_; }
+  inline static Phase phase() {
+    ThreadContext* context = thread_context();
+    return context ? context->phase : Get().phase_;
+  }
   // The setters for the variables
   // Sets the mode. It is recommended that you don't change the mode halfway
   // into the program since that may cause allocation of pinned memory being
   // freed in a non-pinned way, which may cause problems - I haven't verified
   // it personally but better to note it here in the header file.
-  inline static void set_mode(Brew mode) { Get().mode_ = mode; }
+  inline static void set_mode(Brew mode) {
+    ThreadContext* context = thread_context();
+    (context ? context->mode : Get().mode_) = mode;
+  }
   // Sets the phase.
-  inline static void set_phase(Phase phase) { Get().phase_ = phase; }
-  // Sets the random seed of both boost and curand
+  inline static void set_phase(Phase phase) {
+    ThreadContext* context = thread_context();
+    (context ? context->phase : Get().phase_) = phase;
+  }
+  // Sets the random seed of both boost and curand. On a thread with its own
+  // context only its boost rng is reseeded; curand stays shared.
   static void set_random_seed(const unsigned int seed);
+  // Gives the calling thread its own mode, phase and boost rng, so that
+  // threads running nets concurrently (data-parallel training, inference
+  // replicas) neither race on them nor see each other's settings. The
+  // context starts from the process-wide mode and phase and an unseeded rng;
+  // from then on the getters and setters above act on it alone, until the
+  // thread exits.
+  static void InitThreadContext();
+  // Whether the calling thread has called InitThreadContext().
+  inline static bool has_thread_context() { return thread_context() != NULL; }
   // Sets the device. Since we have cublas and curand stuff, set device also
   // requires us to reset those values.
   static void SetDevice(const int device_id);
   // Prints the current GPU status.
   static void DeviceQuery();
+  // Statistics of the host memory allocator behind every blob.
+  inline static HostMemoryStats host_memory_stats() {
+    return HostAllocator::Get().stats();
+  }
+  // Caps the freed host memory kept for reuse (1 GB by default).
+  inline static void set_host_cache_limit(const size_t bytes) {
+    HostAllocator::Get().set_cache_limit(bytes);
+  }
+  // Backs host blocks of at least kHostMapThreshold bytes allocated from now
+  // on with transparent huge pages, where the kernel supports them.
+  inline static void set_host_huge_pages(const bool enable) {
+    HostAllocator::Get().set_huge_pages(enable);
+  }
+  // Returns the cached host memory to the system.
+  inline static void ReleaseHostCache() {
+    HostAllocator::Get().ReleaseCached();
+  }
 
  protected:
   cublasHandle_t cublas_handle_;
@@ -138,6 +189,10 @@ class Caffe {
   Phase phase_;
   static shared_ptr<Caffe> singleton_;
 
+  // The context of the calling thread, or NULL if it uses the process-wide
+  // state.
+  static ThreadContext* thread_context();
+
  private:
   // The private constructor to avoid duplicate instantiation.
   Caffe();
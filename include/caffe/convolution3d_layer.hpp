@@ -40,6 +40,11 @@ class Convolution3DLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
+  virtual bool CompactWeights(const HalfFormat format);
+  virtual bool ReadsCompactBottom() const { return true; }
+  virtual bool WritesCompactTop() const { return true; }
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -64,7 +69,6 @@ class Convolution3DLayer : public Layer<Dtype> {
   int width_;
   int num_output_;
   int filter_group_;
-  Blob<Dtype> col_buffer_;
   shared_ptr<SyncedMemory> bias_multiplier_;
   bool bias_term_;
   int M_;
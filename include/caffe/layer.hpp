@@ -7,6 +7,7 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/workspace.hpp"
 
 using std::vector;
 
@@ -19,7 +20,7 @@ class Layer {
   // to SetUp(), where the dimensions of the bottom blobs are provided to the
   // layer.
   explicit Layer(const LayerParameter& param)
-    : layer_param_(param) {
+    : layer_param_(param), workspace_(NULL), workspace_bytes_(0) {
       // The only thing we do is to copy blobs if there are any.
       if (layer_param_.blobs_size() > 0) {
         blobs_.resize(layer_param_.blobs_size());
@@ -30,9 +31,17 @@ class Layer {
       }
     }
   virtual ~Layer() {}
-  // SetUp: your function should implement this.
+  // SetUp: your function should implement this. It performs the one-time
+  // layer set up (checking parameters, allocating and filling weights) and
+  // ends by calling Reshape().
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top) = 0;
+  // Reshape: adjust the top blobs and any internal buffers to the current
+  // shapes of the bottom blobs. It is called by SetUp() and again by
+  // Net::Reshape() whenever the input shapes change (e.g. a different batch
+  // size or clip length), so it must not touch the learned parameters.
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) = 0;
 
   // Forward and backward wrappers. You should implement the cpu and
   // gpu specific implementations instead, and should not change these
@@ -48,6 +57,24 @@ class Layer {
     return blobs_;
   }
 
+  // Stores the weights in compact 16-bit storage (see Blob::Compact) if the
+  // layer can run its CPU forward pass from them, and returns whether it did.
+  // A layer with compact weights can no longer run backward.
+  virtual bool CompactWeights(const HalfFormat format) { return false; }
+  // Whether the CPU forward pass can read its bottom, or write its top, in
+  // compact 16-bit storage. Net::CompactActivations keeps a blob compact only
+  // between layers that can.
+  virtual bool ReadsCompactBottom() const { return false; }
+  virtual bool WritesCompactTop() const { return false; }
+
+  // Points the layer at the scratch workspace it shares with the other layers
+  // of its net; Net sets it before SetUp(). A layer without one (e.g. in a
+  // test) allocates its own.
+  void set_workspace(Workspace* workspace) { workspace_ = workspace; }
+  // The scratch bytes the layer needs during Forward/Backward at its current
+  // shapes, as last passed to ReserveWorkspace().
+  size_t workspace_bytes() const { return workspace_bytes_; }
+
   // Returns the layer parameter
   const LayerParameter& layer_param() { return layer_param_; }
   // Writes the layer parameter to a protocol buffer
@@ -59,6 +86,22 @@ class Layer {
   // The vector that stores the parameters as a set of blobs.
   vector<shared_ptr<Blob<Dtype> > > blobs_;
 
+  // Declares, from Reshape(), the scratch bytes the layer will take from
+  // workspace() in each Forward/Backward call.
+  void ReserveWorkspace(size_t bytes) {
+    workspace_bytes_ = bytes;
+    workspace()->Reserve(bytes);
+  }
+  // The workspace for temporary buffers that do not outlive a Forward or
+  // Backward call.
+  Workspace* workspace() {
+    if (!workspace_) {
+      own_workspace_.reset(new Workspace());
+      workspace_ = own_workspace_.get();
+    }
+    return workspace_;
+  }
+
   // Forward functions: compute the layer output
   // (and loss layers return the loss; other layers return the dummy value 0.)
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -82,6 +125,11 @@ class Layer {
     Backward_cpu(top, propagate_down, bottom);
   }
 
+ private:
+  Workspace* workspace_;
+  shared_ptr<Workspace> own_workspace_;
+  size_t workspace_bytes_;
+
   DISABLE_COPY_AND_ASSIGN(Layer);
 };  // class Layer
 
@@ -18,7 +18,6 @@ using std::string;
 
 namespace caffe {
 
-
 template <typename Dtype>
 class Net {
  public:
@@ -39,6 +38,12 @@ class Net {
   // as a serialized BlobProtoVector
   string Forward(const string& input_blob_protos, Dtype* loss = NULL);
 
+  // Propagate the current input blob shapes through the net, reshaping every
+  // layer's top blobs and internal buffers. Call this after changing the
+  // shape of an input blob (e.g. batch size or clip length) and before
+  // ForwardPrefilled(); the learned parameters are left untouched.
+  void Reshape();
+
   // The network backward should take no input and output, since it solely
   // computes the gradient w.r.t the parameters, and the data has already
   // been provided during the forward pass.
@@ -56,15 +61,36 @@ class Net {
 
   // For an already initialized net, ShareTrainedLayersWith() implicitly copies
   // (i.e., using no additional memory) the already trained layers from another
-  // Net.
+  // Net. Such replicas may run Forward concurrently, one thread each, as long
+  // as nothing updates the shared weights meanwhile; each thread should call
+  // Caffe::InitThreadContext() first.
   void ShareTrainedLayersWith(Net* other);
   // For an already initialized net, CopyTrainedLayersFrom() copies the already
   // trained layers from another net parameter instance.
   void CopyTrainedLayersFrom(const NetParameter& param);
+  // Loads the trained layers from a binary NetParameter or, if the file is a
+  // flat weight file (see caffe/util/flat_weights.hpp), maps it into memory.
+  // A float net then uses the mapped tensors in place, without parsing or
+  // copying them.
   void CopyTrainedLayersFrom(const string trained_filename);
 
+  // Moves the weights of every layer that supports it (see
+  // Layer::CompactWeights) to compact 16-bit storage for CPU inference, and
+  // returns the number of bytes this frees. The net must be in CPU mode.
+  size_t CompactWeights(const HalfFormat format);
+  // Likewise moves to compact storage every intermediate blob that only
+  // layers handling compact activations write and read (see
+  // Layer::WritesCompactTop and Layer::ReadsCompactBottom), such as the
+  // outputs of convolutions and inner products, ReLU'd in place, feeding the
+  // next one. Net inputs and outputs stay full precision. Such a net can no
+  // longer run Backward.
+  size_t CompactActivations(const HalfFormat format);
+
   // Writes the net to a proto.
   void ToProto(NetParameter* param, bool write_diff = false);
+  // Writes the layer structure of the network like ToProto, but leaves out
+  // the layer blobs.
+  void StructureToProto(NetParameter* param);
 
   // returns the network name.
   inline const string& name() { return name_; }
@@ -92,6 +118,8 @@ class Net {
   inline vector<Blob<Dtype>*>& output_blobs() { return net_output_blobs_; }
   inline vector<int>& input_blob_indices() { return net_input_blob_indices_; }
   inline vector<int>& output_blob_indices() { return net_output_blob_indices_; }
+  // Bytes of scratch shared by the layers: the largest single requirement.
+  inline size_t workspace_size() { return workspace_.size(); }
   // has_blob and blob_by_name are inspired by
   // https://github.com/kencoken/caffe/commit/f36e71569455c9fbb4bf8a63c2d53224e32a4e7b
   // Access intermediary computation layers, testing with centre image only
@@ -104,6 +132,8 @@ class Net {
   // Function to get misc parameters, e.g. the learning rate multiplier and
   // weight decay.
   void GetLearningRateAndWeightDecay();
+  // Points the layer blobs at the tensors of a mapped flat weight file.
+  void CopyTrainedLayersFromFlat(const string& trained_filename);
 
   // Individual layers in the net
   vector<shared_ptr<Layer<Dtype> > > layers_;
@@ -136,6 +166,8 @@ class Net {
   vector<float> params_lr_;
   // the weight decay multipliers
   vector<float> params_weight_decay_;
+  // The scratch memory shared by all the layers (see Layer::workspace()).
+  Workspace workspace_;
   DISABLE_COPY_AND_ASSIGN(Net);
 };
 
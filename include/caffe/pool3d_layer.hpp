@@ -39,6 +39,8 @@ class Pooling3DLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -62,7 +64,6 @@ class Pooling3DLayer : public Layer<Dtype> {
   int pooled_length_;
   int pooled_height_;
   int pooled_width_;
-  Blob<Dtype> rand_idx_;
 };
 
 }
@@ -3,6 +3,8 @@
 #ifndef CAFFE_OPTIMIZATION_SOLVER_HPP_
 #define CAFFE_OPTIMIZATION_SOLVER_HPP_
 
+#include <pthread.h>
+
 #include <string>
 #include <vector>
 
@@ -18,7 +20,7 @@ class Solver {
   // in a non-zero iter number to resume training for a pre-trained net.
   virtual void Solve(const char* resume_file = NULL);
   inline void Solve(const string resume_file) { Solve(resume_file.c_str()); }
-  virtual ~Solver() {}
+  virtual ~Solver();
   inline shared_ptr<Net<Dtype> > net() { return net_; }
 
  protected:
@@ -31,9 +33,41 @@ class Solver {
   // that stores the learned net. You should implement the SnapshotSolverState()
   // function that produces a SolverState protocol buffer that needs to be
   // written to disk together with the learned net.
+  // Snapshot only copies the net and the solver state (see CopySolverState)
+  // to host memory; a background thread serializes and writes them. At most
+  // one snapshot is in flight: Snapshot first waits for the previous one.
   void Snapshot();
+  // Blocks until the snapshot in flight, if any, is on disk.
+  void WaitForSnapshot();
+  // Serializes and writes the copies taken by Snapshot.
+  void WriteSnapshot();
+  // Thread body of the snapshot writer.
+  static void* SnapshotThread(void* arg);
+  // Runs forward and backward on every data-parallel training replica and
+  // leaves the average of their gradients in the diffs of net_. Returns the
+  // average loss.
+  Dtype ParallelForwardBackward();
+  // Builds the data-parallel training replicas when train_num_threads > 1.
+  void InitTrainReplicas();
+  // Forward, backward and gradient reduction step of worker worker_id.
+  void TrainWorkerStep(const int worker_id);
+  // Thread body of training workers 1 ... train_num_threads - 1.
+  static void* TrainWorkerThread(void* arg);
   // The test routine
   void Test();
+  // Runs param_.test_iter() test batches, serially or on test_num_threads
+  // replicas, and returns the sum over batches of every test net output
+  // element in test_score and of the loss in *loss.
+  void TestScores(vector<Dtype>* test_score, Dtype* loss);
+  // Builds the feeder net and the replicas used when test_num_threads > 1.
+  void InitTestReplicas();
+  // Thread body of one test replica.
+  static void* TestReplicaThread(void* arg);
+  // Copies the state that SnapshotSolverState() writes, e.g. the SGD history,
+  // so that training can go on while the snapshot thread writes it.
+  // SnapshotSolverState() runs on the snapshot thread and must only read
+  // these copies.
+  virtual void CopySolverState() {}
   virtual void SnapshotSolverState(SolverState* state) = 0;
   // The Restore function implements how one should restore the solver to a
   // previously snapshotted state. You should implement the RestoreSolverState()
@@ -45,6 +79,36 @@ class Solver {
   int iter_;
   shared_ptr<Net<Dtype> > net_;
   shared_ptr<Net<Dtype> > test_net_;
+  // Data-parallel training: train_nets_[k] is the net of worker k, where
+  // train_nets_[0] is net_ and runs on the calling thread. All of them share
+  // the weights of net_ and keep their own diffs.
+  vector<shared_ptr<Net<Dtype> > > train_nets_;
+  vector<pthread_t> train_threads_;
+  // All workers meet at this barrier at the start of an iteration and
+  // between the levels of the gradient reduction.
+  pthread_barrier_t train_barrier_;
+  bool train_stop_;
+  vector<Dtype> train_loss_;
+  // Multi-threaded testing: test_feed_net_ holds only the leading data layers
+  // of the test net, and each replica takes the rest of the layers with the
+  // data layer tops as inputs. test_feed_blobs_[k] is the feeder blob that
+  // fills input k of every replica.
+  shared_ptr<Net<Dtype> > test_feed_net_;
+  vector<shared_ptr<Net<Dtype> > > test_replicas_;
+  vector<Blob<Dtype>*> test_feed_blobs_;
+  // Guards test_feed_net_ and test_next_iter_ while the replicas run.
+  pthread_mutex_t test_mutex_;
+  int test_next_iter_;
+  // Per-batch outputs and losses, merged in batch order after the run.
+  vector<vector<Dtype> > test_iter_scores_;
+  vector<Dtype> test_iter_loss_;
+  // The snapshot in flight: the iteration, the net without its blobs and
+  // host copies of the layer blobs in layer order.
+  pthread_t snapshot_thread_;
+  bool snapshot_running_;
+  int snapshot_iter_;
+  NetParameter snapshot_net_param_;
+  vector<shared_ptr<Blob<Dtype> > > snapshot_blobs_;
 
   DISABLE_COPY_AND_ASSIGN(Solver);
 };
@@ -62,10 +126,13 @@ class SGDSolver : public Solver<Dtype> {
   virtual void PreSolve();
   Dtype GetLearningRate();
   virtual void ComputeUpdateValue();
+  virtual void CopySolverState();
   virtual void SnapshotSolverState(SolverState * state);
   virtual void RestoreSolverState(const SolverState& state);
   // history maintains the historical momentum data.
   vector<shared_ptr<Blob<Dtype> > > history_;
+  // The copy of history_ taken for the snapshot in flight.
+  vector<shared_ptr<Blob<Dtype> > > history_snapshot_;
 
   DISABLE_COPY_AND_ASSIGN(SGDSolver);
 };
@@ -6,6 +6,7 @@
 #include <cstdlib>
 
 #include "caffe/common.hpp"
+#include "caffe/util/host_allocator.hpp"
 
 namespace caffe {
 
@@ -22,13 +23,18 @@ namespace caffe {
 // are constantly accessing them the memory pages almost always stays in
 // the physical memory (assuming we have large enough memory installed), and
 // does not seem to create a memory bottleneck here.
+//
+// The memory comes from the caching HostAllocator, aligned to
+// kHostAlignment bytes. CaffeMallocHost sets *zeroed to whether the block is
+// known to be zero-filled, and CaffeFreeHost takes back the size it was
+// allocated with.
 
-inline void CaffeMallocHost(void** ptr, size_t size) {
-  *ptr = malloc(size);
+inline void CaffeMallocHost(void** ptr, size_t size, bool* zeroed) {
+  *ptr = HostAllocator::Get().Allocate(size, zeroed);
 }
 
-inline void CaffeFreeHost(void* ptr) {
-  free(ptr);
+inline void CaffeFreeHost(void* ptr, size_t size) {
+  HostAllocator::Get().Free(ptr, size);
 }
 
 
@@ -36,19 +42,31 @@ class SyncedMemory {
  public:
   SyncedMemory()
       : cpu_ptr_(NULL), gpu_ptr_(NULL), size_(0), head_(UNINITIALIZED),
-        own_cpu_data_(false) {}
+        own_cpu_data_(false), offset_(0) {}
   explicit SyncedMemory(size_t size)
       : cpu_ptr_(NULL), gpu_ptr_(NULL), size_(size), head_(UNINITIALIZED),
-        own_cpu_data_(false) {}
+        own_cpu_data_(false), offset_(0) {}
+  // A view of size bytes of parent from byte offset on. It owns no memory:
+  // every access goes to the parent, which keeps the host and device copies
+  // of the whole block in sync.
+  SyncedMemory(const shared_ptr<SyncedMemory>& parent, size_t offset,
+      size_t size);
   ~SyncedMemory();
   const void* cpu_data();
   void set_cpu_data(void* data);
+  // Uses data, which owner keeps alive (e.g. a mapped file), and holds owner
+  // for as long as it does, so that the memory outlives every blob sharing
+  // it.
+  void set_cpu_data(void* data, const shared_ptr<void>& owner);
   const void* gpu_data();
   void* mutable_cpu_data();
   void* mutable_gpu_data();
   enum SyncedHead { UNINITIALIZED, HEAD_AT_CPU, HEAD_AT_GPU, SYNCED };
-  SyncedHead head() { return head_; }
+  SyncedHead head() { return parent_ ? parent_->head() : head_; }
   size_t size() { return size_; }
+  bool is_view() const { return parent_.get() != NULL; }
+  const shared_ptr<SyncedMemory>& parent() const { return parent_; }
+  size_t offset() const { return offset_; }
 
  private:
   void to_cpu();
@@ -58,6 +76,9 @@ class SyncedMemory {
   size_t size_;
   SyncedHead head_;
   bool own_cpu_data_;
+  shared_ptr<void> cpu_data_owner_;
+  shared_ptr<SyncedMemory> parent_;
+  size_t offset_;
 
   DISABLE_COPY_AND_ASSIGN(SyncedMemory);
 };  // class SyncedMemory
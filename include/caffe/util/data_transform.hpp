@@ -0,0 +1,42 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_UTIL_DATA_TRANSFORM_HPP_
+#define CAFFE_UTIL_DATA_TRANSFORM_HPP_
+
+#include <stdint.h>
+
+namespace caffe {
+
+// Writes (data - mean) * scale for one channels x length x height x width
+// uint8 datum into top_data, the datum's slot in the prefetch batch. If
+// crop_size > 0 only the crop_size x crop_size window at (h_off, w_off) of
+// every frame is kept, reversed along the width if mirror is set; otherwise
+// the whole datum is transformed. mean has the full, uncropped datum shape.
+// If show_buffer is not NULL it receives the cropped (and mirrored) raw
+// bytes in the same layout as top_data. 2-D Datum use length = 1.
+template <typename Dtype>
+void TransformVolumeData(const uint8_t* data, const Dtype* mean,
+    const int channels, const int length, const int height, const int width,
+    const int crop_size, const int h_off, const int w_off, const bool mirror,
+    const Dtype scale, Dtype* top_data, char* show_buffer);
+
+// Writes frame of a channels x length clip into top_data, the clip's slot in
+// the prefetch batch, straight from a decoded height x width image whose
+// pixels interleave the channels (e.g. BGR) and whose rows start row_stride
+// bytes apart. Crop, mirror, mean and scale are as in TransformVolumeData, so
+// transforming every frame of a clip this way gives the same top_data as
+// TransformVolumeData on the clip's planar datum.
+template <typename Dtype>
+void TransformInterleavedFrame(const uint8_t* pixels, const int row_stride,
+    const Dtype* mean, const int channels, const int length, const int frame,
+    const int height, const int width, const int crop_size, const int h_off,
+    const int w_off, const bool mirror, const Dtype scale, Dtype* top_data);
+
+// Writes (data - mean) * scale for a datum stored in float_data.
+template <typename Dtype>
+void TransformFloatData(const float* data, const Dtype* mean, const int size,
+    const Dtype scale, Dtype* top_data);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_DATA_TRANSFORM_HPP_
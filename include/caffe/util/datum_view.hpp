@@ -0,0 +1,73 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_UTIL_DATUM_VIEW_HPP_
+#define CAFFE_UTIL_DATUM_VIEW_HPP_
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+namespace caffe {
+
+// Reads a serialized VolumeDatum or Datum in place. ParseFromString on a
+// leveldb value copies the record into a string and then its bytes field
+// into the message; a view decodes only the header fields and points data()
+// into the serialized record itself, so the clip bytes are never copied.
+// The record must stay alive and unchanged while the view is used: for a
+// leveldb iterator, until it moves; for a mapped file, until it is unmapped.
+// float_data, which a record may store unpacked, is decoded into a buffer
+// the view keeps across parses.
+class DatumView {
+ public:
+  DatumView() { Clear(); }
+
+  // Parse a serialized VolumeDatum or Datum. Return false, leaving the view
+  // cleared, if the record is malformed.
+  bool ParseVolumeDatum(const void* record, const size_t size);
+  bool ParseDatum(const void* record, const size_t size);
+
+  int channels() const { return channels_; }
+  // Datum has no length; it reads as 1.
+  int length() const { return length_; }
+  int height() const { return height_; }
+  int width() const { return width_; }
+  int label() const { return label_; }
+  // The bytes field, pointing into the record; data_size() is 0 if unset.
+  const uint8_t* data() const { return data_; }
+  int data_size() const { return data_size_; }
+  const float* float_data() const {
+    return float_data_.empty() ? NULL : &float_data_[0];
+  }
+  int float_data_size() const { return float_data_.size(); }
+
+ private:
+  // The field numbers of one message type.
+  struct Fields {
+    int channels;
+    int length;
+    int height;
+    int width;
+    int data;
+    int label;
+    int float_data;
+  };
+
+  void Clear();
+  bool Parse(const Fields& fields, const uint8_t* record, const size_t size);
+
+  int channels_;
+  int length_;
+  int height_;
+  int width_;
+  int label_;
+  const uint8_t* data_;
+  int data_size_;
+  vector<float> float_data_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_DATUM_VIEW_HPP_
@@ -0,0 +1,71 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_UTIL_DB_HPP_
+#define CAFFE_UTIL_DB_HPP_
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <string>
+
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+using std::string;
+
+namespace caffe {
+
+// Reads the records of a database in key order, starting over after the last
+// one, as the data layers do. The cursor counts the records it has passed
+// in this endless sequence, so that several cursors can split it between
+// them: each one is moved forward to the indices it is responsible for.
+class DatabaseCursor {
+ public:
+  DatabaseCursor() : index_(0) {}
+  virtual ~DatabaseCursor() {}
+
+  // The position in the endless sequence; the cursor starts at record 0.
+  uint64_t index() const { return index_; }
+  // Moves forward to the record at index, which must not be behind the
+  // current one.
+  void SeekTo(const uint64_t index);
+  void Next() { SeekTo(index_ + 1); }
+
+  virtual string key() const = 0;
+  // The value of the current record. It is not copied out of the database,
+  // so it is only valid until the cursor moves.
+  virtual const void* value() const = 0;
+  virtual size_t value_size() const = 0;
+
+ protected:
+  // Moves to the first record of the database, which must not be empty.
+  virtual void SeekToFirstRecord() = 0;
+  // Moves to the next record, returning false past the last one.
+  virtual bool NextRecord() = 0;
+
+ private:
+  uint64_t index_;
+
+  DISABLE_COPY_AND_ASSIGN(DatabaseCursor);
+};
+
+// A database of serialized datums, opened read-only.
+class Database {
+ public:
+  Database() {}
+  virtual ~Database() {}
+
+  static Database* Open(const DataParameter_DB backend, const string& source);
+
+  // Returns a new cursor at the first record. Cursors are independent: an
+  // lmdb cursor holds its own read transaction, and each one may be used
+  // from a different thread than the others (though by one at a time).
+  virtual DatabaseCursor* NewCursor() = 0;
+
+ private:
+  DISABLE_COPY_AND_ASSIGN(Database);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_DB_HPP_
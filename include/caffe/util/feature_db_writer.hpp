@@ -0,0 +1,84 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_UTIL_FEATURE_DB_WRITER_HPP_
+#define CAFFE_UTIL_FEATURE_DB_WRITER_HPP_
+
+#include <leveldb/db.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+using std::string;
+using std::vector;
+
+namespace caffe {
+
+// The key of feature index in the databases of extract_features.
+string FeatureKey(const int index);
+
+// Writes extracted features to a new LevelDB from a pool of threads, so that
+// the thread running the net does not wait on serialization or storage.
+// Feature i is stored under FeatureKey(i) as a Datum of 1 x dim x 1 in
+// float_data. Write copies a batch of features into a bounded queue; the
+// threads turn each batch into a leveldb::WriteBatch and commit it.
+//
+// With bulk_load the batches are committed in the order they were queued.
+// Keys then reach the database sorted, as a fresh database fills with
+// non-overlapping runs that compaction moves down the levels rather than
+// merging, while serialization still runs in parallel.
+class FeatureDBWriter {
+ public:
+  FeatureDBWriter(const string& path, const int num_threads = 2,
+      const int queue_size = 8, const bool bulk_load = false);
+  ~FeatureDBWriter();
+
+  // Queues the num x dim features under the keys of first_index to
+  // first_index + num - 1. The data is copied, so the caller may reuse it as
+  // soon as Write returns; Write blocks only while the queue is full.
+  template <typename Dtype>
+  void Write(const int first_index, const int num, const int dim,
+      const Dtype* features);
+  // Waits for every queued batch to be committed and closes the database;
+  // called by the destructor.
+  void Close();
+  // Features committed so far.
+  int num_written();
+
+ private:
+  struct Batch {
+    int64_t sequence;
+    int first_index;
+    int num;
+    int dim;
+    vector<float> features;
+  };
+
+  static void* WriterThread(void* writer_pointer);
+  void CommitBatch(const Batch& batch);
+
+  leveldb::DB* db_;
+  bool bulk_load_;
+  int queue_size_;
+  vector<pthread_t> threads_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t not_empty_;
+  pthread_cond_t not_full_;
+  pthread_cond_t committed_;
+  std::deque<Batch*> queue_;
+  bool closing_;
+  int64_t next_sequence_;
+  // The sequence number of the next batch to commit with bulk_load.
+  int64_t next_commit_;
+  int num_written_;
+
+  DISABLE_COPY_AND_ASSIGN(FeatureDBWriter);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_FEATURE_DB_WRITER_HPP_
@@ -0,0 +1,114 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_UTIL_FEATURE_SHARD_HPP_
+#define CAFFE_UTIL_FEATURE_SHARD_HPP_
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace caffe {
+
+// Feature shards hold many extracted feature blobs in a few large
+// append-only files instead of one small file per clip and blob (see
+// save_blob_to_binary). Records go to <prefix>.shard-00000, -00001, ...,
+// starting a new shard once one grows past the size limit, and every record
+// appends an entry to <prefix>.index: a uint32 key length, the key, an int32
+// shard id, a uint64 offset, a uint32 stored size, five int32 dims (num,
+// channels, length, height, width), a uint8 FeatureStorage and a uint8
+// compressed flag. Records are float32 or float16, optionally compressed
+// with snappy. When a key is written twice, the later record wins.
+enum FeatureStorage {
+  FEATURE_FLOAT32 = 0,
+  FEATURE_FLOAT16 = 1
+};
+
+struct FeatureRecord {
+  int shard;
+  uint64_t offset;
+  uint32_t stored_size;
+  int num;
+  int channels;
+  int length;
+  int height;
+  int width;
+  FeatureStorage storage;
+  bool compressed;
+  int count() const { return num * channels * length * height * width; }
+};
+
+class FeatureShardWriter {
+ public:
+  FeatureShardWriter(const string& prefix, const FeatureStorage storage,
+      const bool compress, const uint64_t max_shard_size = 1 << 30);
+  ~FeatureShardWriter();
+
+  // Appends item num_index of blob under key, or the whole blob if
+  // num_index < 0, as save_blob_to_binary does.
+  template <typename Dtype>
+  void Write(const string& key, Blob<Dtype>* blob, const int num_index = -1);
+  // Flushes and closes the files; called by the destructor.
+  void Close();
+
+ private:
+  void Append(const string& key, const float* data, const int num,
+      const int channels, const int length, const int height, const int width);
+  void OpenShard();
+
+  string prefix_;
+  FeatureStorage storage_;
+  bool compress_;
+  uint64_t max_shard_size_;
+  FILE* index_file_;
+  FILE* shard_file_;
+  int shard_id_;
+  uint64_t shard_size_;
+  vector<float> float_buffer_;
+  vector<uint16_t> half_buffer_;
+  string compressed_buffer_;
+
+  DISABLE_COPY_AND_ASSIGN(FeatureShardWriter);
+};
+
+// Float blobs are appended straight from their data, without conversion.
+template <>
+void FeatureShardWriter::Write<float>(const string& key, Blob<float>* blob,
+    const int num_index);
+
+// Random access to the records of a feature shard set. The index is loaded
+// into memory and the shards are mapped, so a read touches only the pages of
+// its record.
+class FeatureShardReader {
+ public:
+  explicit FeatureShardReader(const string& prefix);
+  ~FeatureShardReader();
+
+  int size() const { return records_.size(); }
+  // Returns the record of key, or NULL if there is none.
+  const FeatureRecord* Find(const string& key) const;
+  // Reshapes blob to the record of key and fills it; returns false if there
+  // is no such record.
+  template <typename Dtype>
+  bool Read(const string& key, Blob<Dtype>* blob) const;
+
+ private:
+  map<string, FeatureRecord> records_;
+  vector<char*> shard_data_;
+  vector<size_t> shard_sizes_;
+
+  DISABLE_COPY_AND_ASSIGN(FeatureShardReader);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_FEATURE_SHARD_HPP_
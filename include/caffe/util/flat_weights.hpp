@@ -0,0 +1,85 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_UTIL_FLAT_WEIGHTS_HPP_
+#define CAFFE_UTIL_FLAT_WEIGHTS_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+using std::string;
+using std::vector;
+
+namespace caffe {
+
+// A flat weight file stores the parameter blobs of a trained net as raw
+// little-endian float32 tensors, each aligned to kFlatWeightsAlignment bytes,
+// followed by an index of (layer name, blob id, shape, offset). It is a
+// companion to the binary NetParameter: it can be mapped into memory and used
+// in place, with no parsing and no copy.
+//
+// Layout: a FlatWeightsHeader, the tensors, then the index. Every index entry
+// is a uint32 name length, the layer name, an int32 blob id, five int32 dims
+// (num, channels, length, height, width) and a uint64 tensor offset.
+const char kFlatWeightsMagic[8] = {'C', 'A', 'F', 'F', 'E', 'F', 'L', 'T'};
+const uint32_t kFlatWeightsVersion = 1;
+const int kFlatWeightsAlignment = 64;
+
+struct FlatWeightsHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_blobs;
+  uint64_t index_offset;
+  uint64_t index_size;
+};
+
+struct FlatWeightsEntry {
+  string layer_name;
+  int blob_id;
+  int num;
+  int channels;
+  int length;
+  int height;
+  int width;
+  uint64_t offset;
+  int count() const { return num * channels * length * height * width; }
+};
+
+// Writes every layer blob of param (e.g. a parsed .caffemodel) to filename.
+void WriteFlatWeightsFile(const NetParameter& param, const string& filename);
+
+// Returns true if filename starts with the flat weight file magic.
+bool IsFlatWeightsFile(const string& filename);
+
+// A read-only view of a flat weight file. The file is mapped privately
+// (copy-on-write): its clean pages are shared by all processes mapping it
+// and writes through data() never reach the file. The mapping lives as long
+// as this object.
+class FlatWeightsFile {
+ public:
+  explicit FlatWeightsFile(const string& filename);
+  ~FlatWeightsFile();
+
+  int num_blobs() const { return entries_.size(); }
+  const FlatWeightsEntry& entry(const int i) const { return entries_[i]; }
+  // The tensor of entry i, inside the mapping.
+  float* data(const int i) const {
+    return reinterpret_cast<float*>(base_ + entries_[i].offset);
+  }
+
+ private:
+  string filename_;
+  char* base_;
+  size_t size_;
+  vector<FlatWeightsEntry> entries_;
+
+  DISABLE_COPY_AND_ASSIGN(FlatWeightsFile);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_FLAT_WEIGHTS_HPP_
@@ -0,0 +1,41 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_UTIL_FLOAT16_HPP_
+#define CAFFE_UTIL_FLOAT16_HPP_
+
+#include <stdint.h>
+
+namespace caffe {
+
+// Conversions between float and IEEE 754 half precision (binary16), stored
+// as uint16_t. FloatToHalf rounds to nearest even; values beyond the half
+// range become infinity and NaNs stay NaN.
+uint16_t FloatToHalf(const float value);
+float HalfToFloat(const uint16_t value);
+
+void FloatToHalf(const int n, const float* x, uint16_t* y);
+void HalfToFloat(const int n, const uint16_t* x, float* y);
+
+// Conversions between float and bfloat16: the top 16 bits of a float, with
+// the full float range but only 8 significant bits. FloatToBfloat16 rounds
+// to nearest even.
+uint16_t FloatToBfloat16(const float value);
+float Bfloat16ToFloat(const uint16_t value);
+
+// The 16-bit formats of compact blob storage (see Blob::Compact).
+enum HalfFormat {
+  HALF_FLOAT16 = 0,
+  HALF_BFLOAT16 = 1
+};
+
+// Bulk conversions between Dtype and either 16-bit format. FromHalf, which
+// runs on every use of compact data, is vectorized with SSE2 for float.
+template <typename Dtype>
+void ToHalf(const HalfFormat format, const int n, const Dtype* x, uint16_t* y);
+template <typename Dtype>
+void FromHalf(const HalfFormat format, const int n, const uint16_t* x,
+    Dtype* y);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_FLOAT16_HPP_
@@ -0,0 +1,75 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_UTIL_HOST_ALLOCATOR_HPP_
+#define CAFFE_UTIL_HOST_ALLOCATOR_HPP_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace caffe {
+
+// Every host block is aligned to this many bytes (an AVX-512 register, and a
+// cache line).
+const size_t kHostAlignment = 64;
+// Blocks of at least this size are mapped straight from the kernel: they come
+// zero-filled and page aligned, and may be backed by huge pages.
+const size_t kHostMapThreshold = 2 << 20;
+
+struct HostMemoryStats {
+  // Bytes handed out and not yet returned, rounded up to their size class.
+  size_t in_use_bytes;
+  size_t peak_in_use_bytes;
+  // Bytes of returned blocks kept for reuse.
+  size_t cached_bytes;
+  // Allocation requests, and how many of them were served from the cache.
+  uint64_t allocations;
+  uint64_t cache_hits;
+};
+
+// A caching allocator for the host memory of SyncedMemory. Requests are
+// rounded up to size classes (four per power of two) and returned blocks are
+// kept in per-class free lists, so that reshaping a net or re-creating blobs
+// of the same sizes does not go back to the system. The cache holds at most
+// cache_limit() bytes; blocks that do not fit are released. Thread safe.
+class HostAllocator {
+ public:
+  static HostAllocator& Get();
+
+  // Returns a block of at least size bytes aligned to kHostAlignment. Sets
+  // *zeroed to whether the block is known to be zero-filled.
+  void* Allocate(size_t size, bool* zeroed);
+  // Returns a block from Allocate(size) to the cache.
+  void Free(void* ptr, size_t size);
+  // Releases every cached block to the system.
+  void ReleaseCached();
+
+  HostMemoryStats stats();
+  size_t cache_limit();
+  void set_cache_limit(size_t bytes);
+  // Asks the kernel for transparent huge pages (madvise) behind blocks of at
+  // least kHostMapThreshold bytes allocated from now on.
+  void set_huge_pages(bool enable);
+
+  // The size class a request of size bytes is rounded up to.
+  static size_t SizeClass(size_t size);
+
+ private:
+  HostAllocator();
+  static void CreateInstance();
+  static void* SystemAllocate(size_t size_class, bool huge_pages);
+  static void SystemFree(void* ptr, size_t size_class);
+
+  pthread_mutex_t mutex_;
+  std::map<size_t, std::vector<void*> > free_lists_;
+  HostMemoryStats stats_;
+  size_t cache_limit_;
+  bool huge_pages_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_HOST_ALLOCATOR_HPP_
@@ -20,6 +20,7 @@
 
 
 #include <string>
+#include <vector>
 
 #include "google/protobuf/message.h"
 #include "caffe/proto/caffe.pb.h"
@@ -51,6 +52,35 @@ inline bool ReadVideoToVolumeDatum(const char* filename, const int start_frm, co
 	return ReadVideoToVolumeDatum(filename, start_frm, label, length, 0, 0, sampling_rate, datum);
 }
 
+// Plans the clips of length frames that a video of frm_num frames (numbered
+// from 1) gives for num_segments segments: segments 0 to num_segments - 2
+// cover equal parts of the video and the last one all of it. Sets
+// (*segment_frames)[k] to the frame numbers of the clip of segment k.
+void PlanImageSequenceSegments(const int frm_num, const int length,
+		const int num_segments, const bool temporal_jitter,
+		std::vector<std::vector<int> >* segment_frames);
+
+// Reads a color image, resized to height x width unless they are 0. With
+// reduced_decode (OpenCV 3 and later) a JPEG is decoded at the smallest
+// power-of-two reduction that still covers the target before the resize;
+// this is faster, but not bit-identical to decoding at full size.
+bool ReadImageFrame(const char* filename, const int height, const int width,
+		const bool reduced_decode, cv::Mat* img);
+
+// Reads the frames frm_idx of img_dir, in order, into one volume.
+bool ReadImageFramesToVolumeDatum(const char* img_dir,
+		const std::vector<int>& frm_idx, const int label, const int height,
+		const int width, VolumeDatum* datum, const bool reduced_decode = false);
+
+// Reads the clips segment_frames of one video into (*datums)[k], decoding
+// each distinct frame once however many clips it appears in.
+bool ReadImageSegmentsToVolumeData(const char* img_dir,
+		const std::vector<std::vector<int> >& segment_frames, const int label,
+		const int height, const int width, std::vector<VolumeDatum>* datums,
+		const bool reduced_decode = false);
+
+// Reads the clip of segment seg_id of a 4-segment plan (three thirds and the
+// whole video).
 bool ReadImageSequenceToVolumeDatum(const char* img_dir, const int frm_num, const int label,
 		const int length, const int height, const int width, const int seg_id, const bool temporal_jitter, VolumeDatum* datum);
 
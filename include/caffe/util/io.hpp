@@ -60,6 +60,13 @@ inline void WriteProtoToBinaryFile(
   WriteProtoToBinaryFile(proto, filename.c_str());
 }
 
+// Like WriteProtoToBinaryFile, but returns only once the file is on disk.
+void WriteProtoToBinaryFileAndSync(const Message& proto, const char* filename);
+inline void WriteProtoToBinaryFileAndSync(
+    const Message& proto, const string& filename) {
+  WriteProtoToBinaryFileAndSync(proto, filename.c_str());
+}
+
 bool ReadImageToDatum(const string& filename, const int label,
     const int height, const int width, Datum* datum);
 
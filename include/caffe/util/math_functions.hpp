@@ -9,6 +9,7 @@
 
 #include "glog/logging.h"
 
+#include "caffe/util/float16.hpp"
 #include "caffe/util/mkl_alternate.hpp"
 
 namespace caffe {
@@ -21,6 +22,22 @@ void caffe_cpu_gemm(const CBLAS_TRANSPOSE TransA,
     const Dtype alpha, const Dtype* A, const Dtype* B, const Dtype beta,
     Dtype* C);
 
+// caffe_cpu_gemm with A or B in compact 16-bit storage (see Blob::Compact).
+// The compact operand is converted to Dtype one panel of the K dimension at
+// a time into a buffer small enough to stay in cache, and every panel goes
+// through the BLAS gemm, so the compact matrix is read at 16 bits per element.
+template <typename Dtype>
+void caffe_cpu_gemm(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const Dtype alpha, const uint16_t* A, const HalfFormat a_format,
+    const Dtype* B, const Dtype beta, Dtype* C);
+
+template <typename Dtype>
+void caffe_cpu_gemm(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const Dtype alpha, const Dtype* A, const uint16_t* B,
+    const HalfFormat b_format, const Dtype beta, Dtype* C);
+
 // Decaf gpu gemm provides an interface that is almost the same as the cpu
 // gemm function - following the c convention and calling the fortran-order
 // gpu code under the hood.
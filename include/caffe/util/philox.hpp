@@ -0,0 +1,49 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_UTIL_PHILOX_HPP_
+#define CAFFE_UTIL_PHILOX_HPP_
+
+#include <stdint.h>
+
+namespace caffe {
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3", SC 2011): a counter-based generator whose output is a pure function of
+// a 128-bit counter and a 64-bit key. Any part of a stream can be computed
+// independently, and four or more counters at once with SIMD.
+inline void Philox4x32(const uint32_t counter[4], const uint32_t key[2],
+    uint32_t out[4]) {
+  uint32_t x0 = counter[0], x1 = counter[1], x2 = counter[2], x3 = counter[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < 10; ++round) {
+    const uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * x0;
+    const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * x2;
+    x0 = static_cast<uint32_t>(p1 >> 32) ^ x1 ^ k0;
+    x1 = static_cast<uint32_t>(p1);
+    x2 = static_cast<uint32_t>(p0 >> 32) ^ x3 ^ k1;
+    x3 = static_cast<uint32_t>(p0);
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  out[0] = x0;
+  out[1] = x1;
+  out[2] = x2;
+  out[3] = x3;
+}
+
+// Number of 32-bit words of a bit mask over n elements.
+inline int BitMaskWords(const int n) {
+  return (n + 31) / 32;
+}
+
+// Draws the bit mask of a Bernoulli sample over n elements: bit i of
+// bits[i / 32] (least significant first) is set if the i-th 32-bit word of
+// the Philox stream of key is greater than threshold, i.e. with probability
+// 1 - threshold / 2^32. Word i of the stream is word (i % 16) / 4 of counter
+// 4 * (i / 16) + i % 4, which lets four counters run in SIMD lanes.
+void PhiloxBernoulliBits(const uint32_t key[2], const int n,
+    const uint32_t threshold, uint32_t* bits);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_PHILOX_HPP_
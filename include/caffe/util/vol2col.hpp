@@ -18,6 +18,9 @@
 #ifndef VOL2COL_HPP_
 #define VOL2COL_HPP_
 
+#include <stdint.h>
+
+#include "caffe/util/float16.hpp"
 
 namespace caffe {
 
@@ -26,6 +29,14 @@ void vol2col_cpu(const Dtype* data_im, const int channels, const int length,
     const int height, const int width, const int ksize, const int kdepth, const int pad,
     const int temporal_pad, const int stride, const int temporal_stride, Dtype* data_col);
 
+// vol2col_cpu for an image in compact 16-bit storage (see Blob::Compact),
+// converted one channel at a time on the way into the column buffer.
+template <typename Dtype>
+void vol2col_cpu(const uint16_t* data_im, const HalfFormat format,
+    const int channels, const int length, const int height, const int width,
+    const int ksize, const int kdepth, const int pad, const int temporal_pad,
+    const int stride, const int temporal_stride, Dtype* data_col);
+
 template <typename Dtype>
 void col2vol_cpu(const Dtype* data_col, const int channels, const int length,
     const int height, const int width, const int ksize, const int kdepth, const int pad,
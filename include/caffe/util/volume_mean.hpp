@@ -0,0 +1,71 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_UTIL_VOLUME_MEAN_HPP_
+#define CAFFE_UTIL_VOLUME_MEAN_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/datum_view.hpp"
+
+using std::vector;
+
+namespace caffe {
+
+// Accumulates the element-wise sum of many VolumeDatum of the same shape and
+// writes their mean as a BlobProto. uint8 data is summed into 32-bit integer
+// partial sums with widening adds and folded into doubles before they could
+// overflow, so the per-datum cost is a single pass over the bytes. Each
+// thread should own one accumulator; Merge() combines them at the end.
+class VolumeMeanAccumulator {
+ public:
+  VolumeMeanAccumulator()
+      : channels_(0), length_(0), height_(0), width_(0), size_(0), count_(0),
+        pending_(0) {}
+
+  // Sets the shape of the datums to be accumulated and clears the sums.
+  void Init(const int channels, const int length, const int height,
+      const int width);
+  void Init(const VolumeDatum& datum) {
+    Init(datum.channels(), datum.length(), datum.height(), datum.width());
+  }
+  void Init(const DatumView& datum) {
+    Init(datum.channels(), datum.length(), datum.height(), datum.width());
+  }
+
+  // Adds one datum, using its byte data if present and float_data otherwise.
+  void Add(const VolumeDatum& datum);
+  void Add(const DatumView& datum);
+  void AddBytes(const uint8_t* data, const int size);
+  void AddFloats(const float* data, const int size);
+
+  // Adds the sums and count of another accumulator of the same shape.
+  void Merge(const VolumeMeanAccumulator& other);
+
+  // Writes the mean volume as a 1 x C x L x H x W BlobProto.
+  void ToProto(BlobProto* proto) const;
+
+  int size() const { return size_; }
+  int count() const { return count_; }
+
+ private:
+  // Folds the integer partial sums into sum_.
+  void Flush();
+
+  int channels_;
+  int length_;
+  int height_;
+  int width_;
+  int size_;
+  int count_;
+  // Number of uint8 datums held in partial_ since the last Flush().
+  uint32_t pending_;
+  vector<uint32_t> partial_;
+  vector<double> sum_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_VOLUME_MEAN_HPP_
@@ -48,6 +48,8 @@ class VideoDataLayer : public Layer<Dtype> {
   virtual ~VideoDataLayer();
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -69,6 +71,8 @@ class VideoDataLayer : public Layer<Dtype> {
   vector<int> label_list_;
   vector<int> shuffle_index_;
   int lines_id_;
+  // Clips read per video.
+  int num_segments_;
 
   int datum_channels_;
   int datum_length_;
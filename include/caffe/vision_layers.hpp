@@ -21,6 +21,11 @@ namespace caffe {
 ConcatLayer
   Takes at least two blobs and concatenates them along either num or
   channel dim, outputting the result.
+
+  A bottom can instead be a view of its part of the top (see
+  set_bottom_views), so that the layer producing it writes the top in place
+  and neither pass copies it. The parts are contiguous, and the views made,
+  when concatenating along num, or along channels for a single volume.
 */
 template <typename Dtype>
 class ConcatLayer : public Layer<Dtype> {
@@ -29,6 +34,14 @@ class ConcatLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
+  // Makes bottom i a view of the top where bottom_views[i] is set. That is
+  // only safe if the layer producing bottom i writes the memory of the blob
+  // in place, which Net::Init checks. Takes effect at the next Reshape.
+  void set_bottom_views(const vector<bool>& bottom_views) {
+    bottom_views_ = bottom_views;
+  }
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -41,6 +54,7 @@ class ConcatLayer : public Layer<Dtype> {
       const bool propagate_down, vector<Blob<Dtype>*>* bottom);
 
   Blob<Dtype> col_bob_;
+  vector<bool> bottom_views_;
   int count_;
   int num_;
   int channels_;
@@ -59,6 +73,8 @@ class ConvolutionLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -79,7 +95,6 @@ class ConvolutionLayer : public Layer<Dtype> {
   int width_;
   int num_output_;
   int group_;
-  Blob<Dtype> col_buffer_;
   shared_ptr<SyncedMemory> bias_multiplier_;
   bool bias_term_;
   int M_;
@@ -96,6 +111,8 @@ class EltwiseProductLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -115,6 +132,8 @@ class FlattenLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -138,6 +157,8 @@ class Im2colLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -166,6 +187,11 @@ class InnerProductLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
+  virtual bool CompactWeights(const HalfFormat format);
+  virtual bool ReadsCompactBottom() const { return true; }
+  virtual bool WritesCompactTop() const { return true; }
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -198,6 +224,8 @@ class LRNLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -264,10 +292,13 @@ class MemoryDataLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
   // Reset should accept const pointers, but can't, because the memory
   //  will be given to Blob, which is mutable
   void Reset(Dtype* data, Dtype* label, int n);
   int datum_channels() { return datum_channels_; }
+  int datum_length() { return datum_length_; }
   int datum_height() { return datum_height_; }
   int datum_width() { return datum_width_; }
   int batch_size() { return batch_size_; }
@@ -283,6 +314,7 @@ class MemoryDataLayer : public Layer<Dtype> {
   Dtype* data_;
   Dtype* labels_;
   int datum_channels_;
+  int datum_length_;
   int datum_height_;
   int datum_width_;
   int datum_size_;
@@ -298,6 +330,8 @@ class PoolingLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -329,6 +363,8 @@ class SoftmaxLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -342,12 +378,13 @@ class SoftmaxLayer : public Layer<Dtype> {
 
   // sum_multiplier is just used to carry out sum using blas
   Blob<Dtype> sum_multiplier_;
-  // scale is an intermediate blob to hold temporary results.
-  Blob<Dtype> scale_;
 };
 
 /* SoftmaxWithLossLayer
-  Implements softmax and computes the loss.
+  Implements softmax and computes the loss. The log-softmax is fused into
+  the loss and the probabilities are never stored: in the TRAIN phase the
+  Forward pass that computes them leaves the gradient, (prob - 1 at the
+  label) / num, in the bottom diff, and Backward has nothing left to do.
 
   It is preferred over separate softmax + multinomiallogisticloss
   layers due to more numerically stable gradients.
@@ -358,9 +395,11 @@ template <typename Dtype>
 class SoftmaxWithLossLayer : public Layer<Dtype> {
  public:
   explicit SoftmaxWithLossLayer(const LayerParameter& param)
-      : Layer<Dtype>(param), softmax_layer_(new SoftmaxLayer<Dtype>(param)) {}
+      : Layer<Dtype>(param), diff_ready_(false) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -372,12 +411,12 @@ class SoftmaxWithLossLayer : public Layer<Dtype> {
   virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
      const bool propagate_down, vector<Blob<Dtype>*>* bottom);
 
-  shared_ptr<SoftmaxLayer<Dtype> > softmax_layer_;
-  // prob stores the output probability of the layer.
-  Blob<Dtype> prob_;
-  // Vector holders to call the underlying softmax layer forward and backward.
-  vector<Blob<Dtype>*> softmax_bottom_vec_;
-  vector<Blob<Dtype>*> softmax_top_vec_;
+  // The log of the softmax normalizer of every row, max + log(sum(exp(x -
+  // max))), from which Backward recomputes the probabilities if Forward ran
+  // outside the TRAIN phase.
+  Blob<Dtype> log_norm_;
+  // Whether the last Forward wrote the gradient to the bottom diff.
+  bool diff_ready_;
 };
 
 /* SplitLayer
@@ -389,6 +428,8 @@ class SplitLayer : public Layer<Dtype> {
       : Layer<Dtype>(param) {}
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
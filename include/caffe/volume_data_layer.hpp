@@ -22,7 +22,6 @@
 #include <utility>
 #include <vector>
 
-#include "leveldb/db.h"
 #include "pthread.h"
 #include "hdf5.h"
 #include "boost/scoped_ptr.hpp"
@@ -31,16 +30,21 @@
 #include "caffe/common.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/db.hpp"
 
 namespace caffe {
 
 template <typename Dtype>
 void* VolumeDataLayerPrefetch(void* layer_pointer);
+template <typename Dtype>
+void* VolumeDataLayerRead(void* args_pointer);
 
 template <typename Dtype>
 class VolumeDataLayer : public Layer<Dtype> {
   // The function used to perform prefetching.
   friend void* VolumeDataLayerPrefetch<Dtype>(void* layer_pointer);
+  // The function each reader thread of a prefetch runs.
+  friend void* VolumeDataLayerRead<Dtype>(void* args_pointer);
 
  public:
   explicit VolumeDataLayer(const LayerParameter& param)
@@ -48,6 +52,8 @@ class VolumeDataLayer : public Layer<Dtype> {
   virtual ~VolumeDataLayer();
   virtual void SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top);
 
  protected:
   virtual Dtype Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -64,8 +70,11 @@ class VolumeDataLayer : public Layer<Dtype> {
   virtual unsigned int PrefetchRand();
 
   shared_ptr<Caffe::RNG> prefetch_rng_;
-  shared_ptr<leveldb::DB> db_;
-  shared_ptr<leveldb::Iterator> iter_;
+  shared_ptr<Database> db_;
+  // One cursor per reader thread.
+  vector<shared_ptr<DatabaseCursor> > cursors_;
+  // The index of the first record of the next batch.
+  uint64_t next_record_;
   int datum_channels_;
   int datum_length_;
   int datum_height_;
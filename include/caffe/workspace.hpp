@@ -0,0 +1,51 @@
+// Copyright 2014 BVLC and contributors.
+
+#ifndef CAFFE_WORKSPACE_HPP_
+#define CAFFE_WORKSPACE_HPP_
+
+#include <cstddef>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+// Scratch memory that the layers of a net share for their temporary buffers
+// (im2col/vol2col columns, padded copies, per-row sums...). The contents are
+// only valid during the Forward or Backward call that requested them, so one
+// workspace sized to the largest request serves every layer of the net.
+//
+// Layers declare what they need with Reserve() when they are reshaped, and
+// take the memory in Forward/Backward with mutable_cpu_data() or
+// mutable_gpu_data(). Unlike SyncedMemory there is no synchronization
+// between the host and device buffers, and neither is ever zero-filled.
+class Workspace {
+ public:
+  Workspace()
+      : cpu_ptr_(NULL), gpu_ptr_(NULL), cpu_size_(0), gpu_size_(0),
+        size_(0) {}
+  ~Workspace();
+
+  // Grows the size the buffers are allocated with to at least size bytes.
+  // Nothing is allocated until the buffers are first requested.
+  void Reserve(size_t size);
+  // Return at least size bytes of host or device memory. Growing a buffer
+  // invalidates the pointers returned before, so a layer should take all the
+  // scratch it needs in one request per call and divide it up itself.
+  void* mutable_cpu_data(size_t size);
+  void* mutable_gpu_data(size_t size);
+  // The reserved size in bytes.
+  size_t size() const { return size_; }
+
+ private:
+  void* cpu_ptr_;
+  void* gpu_ptr_;
+  size_t cpu_size_;
+  size_t gpu_size_;
+  size_t size_;
+
+  DISABLE_COPY_AND_ASSIGN(Workspace);
+};  // class Workspace
+
+}  // namespace caffe
+
+#endif  // CAFFE_WORKSPACE_HPP_
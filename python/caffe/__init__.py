@@ -1,4 +1,5 @@
 from .pycaffe import Net, SGDSolver
+from ._caffe import init_thread_context
 from .classifier import Classifier
 from .detector import Detector
 import io
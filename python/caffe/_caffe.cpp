@@ -45,6 +45,18 @@ static void CheckFile(const string& filename) {
     f.close();
 }
 
+// Releases the GIL for the lifetime of the object, so that other Python
+// threads (e.g. ones decoding the next clips) keep running while a net
+// computes. Nothing in its scope may touch Python objects.
+class ScopedGILRelease {
+ public:
+  ScopedGILRelease() { state_ = PyEval_SaveThread(); }
+  ~ScopedGILRelease() { PyEval_RestoreThread(state_); }
+
+ private:
+  PyThreadState* state_;
+};
+
 // wrap shared_ptr<Blob<float> > in a class that we construct in C++ and pass
 // to Python
 class CaffeBlob {
@@ -55,6 +67,7 @@ class CaffeBlob {
   string name() const { return name_; }
   int num() const { return blob_->num(); }
   int channels() const { return blob_->channels(); }
+  int length() const { return blob_->length(); }
   int height() const { return blob_->height(); }
   int width() const { return blob_->width(); }
   int count() const { return blob_->count(); }
@@ -79,22 +92,29 @@ class CaffeBlobWrap : public CaffeBlob {
       : CaffeBlob(blob), self_(p) {}
 
   object get_data() {
-      npy_intp dims[] = {num(), channels(), height(), width()};
-
-      PyObject *obj = PyArray_SimpleNewFromData(4, dims, NPY_FLOAT32,
-                                                blob_->mutable_cpu_data());
-      PyArray_SetBaseObject(reinterpret_cast<PyArrayObject *>(obj), self_);
-      Py_INCREF(self_);
-      handle<> h(obj);
-
-      return object(h);
+      return as_array(blob_->mutable_cpu_data());
   }
 
   object get_diff() {
-      npy_intp dims[] = {num(), channels(), height(), width()};
+      return as_array(blob_->mutable_cpu_diff());
+  }
 
-      PyObject *obj = PyArray_SimpleNewFromData(4, dims, NPY_FLOAT32,
-                                                blob_->mutable_cpu_diff());
+ private:
+  // Views the blob memory as an ndarray without copying it. Blobs of clips
+  // are (num, channels, length, height, width); blobs of single frames keep
+  // the (num, channels, height, width) shape that image code expects.
+  object as_array(float* data) {
+      npy_intp dims[5];
+      int ndim = 0;
+      dims[ndim++] = num();
+      dims[ndim++] = channels();
+      if (length() != 1) {
+        dims[ndim++] = length();
+      }
+      dims[ndim++] = height();
+      dims[ndim++] = width();
+
+      PyObject *obj = PyArray_SimpleNewFromData(ndim, dims, NPY_FLOAT32, data);
       PyArray_SetBaseObject(reinterpret_cast<PyArrayObject *>(obj), self_);
       Py_INCREF(self_);
       handle<> h(obj);
@@ -102,7 +122,6 @@ class CaffeBlobWrap : public CaffeBlob {
       return object(h);
   }
 
- private:
   PyObject *self_;
 };
 
@@ -159,13 +178,17 @@ struct CaffeNet {
   virtual ~CaffeNet() {}
 
   // Generate Python exceptions for badly shaped or discontiguous arrays.
+  // Arrays are 5-d (N x C x L x H x W); when the length is 1 the 4-d
+  // (N x C x H x W) form is accepted as well.
   inline void check_contiguous_array(PyArrayObject* arr, string name,
-      int channels, int height, int width) {
+      int channels, int length, int height, int width) {
     if (!(PyArray_FLAGS(arr) & NPY_ARRAY_C_CONTIGUOUS)) {
       throw std::runtime_error(name + " must be C contiguous");
     }
-    if (PyArray_NDIM(arr) != 4) {
-      throw std::runtime_error(name + " must be 4-d");
+    const int ndim = PyArray_NDIM(arr);
+    if (ndim != 5 && !(ndim == 4 && length == 1)) {
+      throw std::runtime_error(name + (length == 1 ? " must be 4-d or 5-d"
+          : " must be 5-d"));
     }
     if (PyArray_TYPE(arr) != NPY_FLOAT32) {
       throw std::runtime_error(name + " must be float32");
@@ -173,19 +196,26 @@ struct CaffeNet {
     if (PyArray_DIMS(arr)[1] != channels) {
       throw std::runtime_error(name + " has wrong number of channels");
     }
-    if (PyArray_DIMS(arr)[2] != height) {
+    if (ndim == 5 && PyArray_DIMS(arr)[2] != length) {
+      throw std::runtime_error(name + " has wrong length");
+    }
+    if (PyArray_DIMS(arr)[ndim - 2] != height) {
       throw std::runtime_error(name + " has wrong height");
     }
-    if (PyArray_DIMS(arr)[3] != width) {
+    if (PyArray_DIMS(arr)[ndim - 1] != width) {
       throw std::runtime_error(name + " has wrong width");
     }
   }
 
+  // The passes run without the GIL. Other Python threads may run meanwhile,
+  // but must leave this net's blobs and input arrays alone until they return.
   void Forward() {
+    ScopedGILRelease release;
     net_->ForwardPrefilled();
   }
 
   void Backward() {
+    ScopedGILRelease release;
     net_->Backward();
   }
 
@@ -204,8 +234,9 @@ struct CaffeNet {
     PyArrayObject* labels_arr =
         reinterpret_cast<PyArrayObject*>(labels_obj.ptr());
     check_contiguous_array(data_arr, "data array", md_layer->datum_channels(),
-        md_layer->datum_height(), md_layer->datum_width());
-    check_contiguous_array(labels_arr, "labels array", 1, 1, 1);
+        md_layer->datum_length(), md_layer->datum_height(),
+        md_layer->datum_width());
+    check_contiguous_array(labels_arr, "labels array", 1, 1, 1, 1);
     if (PyArray_DIMS(data_arr)[0] != PyArray_DIMS(labels_arr)[0]) {
       throw std::runtime_error("data and labels must have the same first"
           " dimension");
@@ -224,6 +255,13 @@ struct CaffeNet {
         PyArray_DIMS(data_arr)[0]);
   }
 
+  // Shares the weights of other instead of holding a copy, e.g. to run
+  // replicas of a net from several Python threads. Each thread should call
+  // caffe.init_thread_context() before it uses its replica.
+  void share_with(shared_ptr<CaffeNet> other) {
+    net_->ShareTrainedLayersWith(other->net_.get());
+  }
+
   // save the network weights to binary proto for net surgeries.
   void save(string filename) {
     NetParameter net_param;
@@ -323,6 +361,7 @@ BOOST_PYTHON_MODULE(_caffe) {
       .add_property("inputs",   &CaffeNet::inputs)
       .add_property("outputs",  &CaffeNet::outputs)
       .def("_set_input_arrays", &CaffeNet::set_input_arrays)
+      .def("share_with",        &CaffeNet::share_with)
       .def("save",              &CaffeNet::save);
 
   boost::python::class_<CaffeBlob, CaffeBlobWrap>(
@@ -330,6 +369,7 @@ BOOST_PYTHON_MODULE(_caffe) {
       .add_property("name",     &CaffeBlob::name)
       .add_property("num",      &CaffeBlob::num)
       .add_property("channels", &CaffeBlob::channels)
+      .add_property("length",   &CaffeBlob::length)
       .add_property("height",   &CaffeBlob::height)
       .add_property("width",    &CaffeBlob::width)
       .add_property("count",    &CaffeBlob::count)
@@ -353,5 +393,7 @@ BOOST_PYTHON_MODULE(_caffe) {
   boost::python::class_<vector<CaffeLayer> >("LayerVec")
       .def(vector_indexing_suite<vector<CaffeLayer>, true>());
 
+  boost::python::def("init_thread_context", &Caffe::InitThreadContext);
+
   import_array();
 }
@@ -59,8 +59,9 @@ def _Net_forward(self, blobs=None, **kwargs):
         for in_, blob in kwargs.iteritems():
             if blob.shape[0] != self.blobs[in_].num:
                 raise Exception('Input is not batch sized')
-            if blob.ndim != 4:
-                raise Exception('{} blob is not 4-d'.format(in_))
+            if blob.ndim != self.blobs[in_].data.ndim:
+                raise Exception('{} blob is not {}-d'.format(
+                    in_, self.blobs[in_].data.ndim))
             self.blobs[in_].data[...] = blob
 
     self._forward()
@@ -93,8 +94,9 @@ def _Net_backward(self, diffs=None, **kwargs):
         for top, diff in kwargs.iteritems():
             if diff.shape[0] != self.blobs[top].num:
                 raise Exception('Diff is not batch sized')
-            if diff.ndim != 4:
-                raise Exception('{} diff is not 4-d'.format(top))
+            if diff.ndim != self.blobs[top].diff.ndim:
+                raise Exception('{} diff is not {}-d'.format(
+                    top, self.blobs[top].diff.ndim))
             self.blobs[top].diff[...] = diff
 
     self._backward()
@@ -297,6 +299,12 @@ def _Net_set_input_arrays(self, data, labels):
     """
     Set input arrays of the in-memory MemoryDataLayer.
     (Note: this is only for networks declared with the memory data layer.)
+
+    Take
+    data: (N x K x H x W) images, or (N x K x L x H x W) clips when the
+          layer's length is above 1, as C-contiguous float32. The array is
+          not copied, so it must stay unchanged while the net reads it.
+    labels: N labels.
     """
     if labels.ndim == 1:
         labels = np.ascontiguousarray(labels[:, np.newaxis, np.newaxis,
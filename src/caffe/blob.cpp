@@ -18,18 +18,24 @@ void Blob<Dtype>::Reshape(const int num, const int channels, const int length, c
   CHECK_GE(length, 0);
   CHECK_GE(height, 0);
   CHECK_GE(width, 0);
+  const int old_count = count_;
   num_ = num;
   channels_ = channels;
   length_ = length;
   height_ = height;
   width_ = width;
   count_ = num_ * channels_ * length_ * height_ * width_;
-  if (count_) {
-    data_.reset(new SyncedMemory(count_ * sizeof(Dtype)));
-    diff_.reset(new SyncedMemory(count_ * sizeof(Dtype)));
-  } else {
-    data_.reset(reinterpret_cast<SyncedMemory*>(NULL));
-    diff_.reset(reinterpret_cast<SyncedMemory*>(NULL));
+  // A view cannot grow or shrink within the blob it views.
+  if (count_ > capacity_ || (data_ && data_->is_view() &&
+      data_->size() != count_ * sizeof(Dtype))) {
+    capacity_ = count_;
+    data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+    diff_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+  }
+  // A compact blob (e.g. an activation the next forward pass rewrites) gets
+  // compact storage of the new size; like a grown blob, it loses its data.
+  if (compact_ && count_ != old_count) {
+    compact_data_.reset(new SyncedMemory(count_ * sizeof(uint16_t)));
   }
 }
 
@@ -49,14 +55,16 @@ void Blob<Dtype>::ReshapeLike(const Blob<Dtype>& other) {
 
 template <typename Dtype>
 Blob<Dtype>::Blob(const int num, const int channels, const int length, const int height,
-    const int width) {
+    const int width)
+    : capacity_(0), compact_(false) {
   Reshape(num, channels, length, height, width);
 }
 
 // for backward compatibility
 template <typename Dtype>
 Blob<Dtype>::Blob(const int num, const int channels, const int height,
-    const int width) {
+    const int width)
+    : capacity_(0), compact_(false) {
 	if (num ==0 && channels == 0 && height ==0 && width == 0)
 		Reshape(num, channels, 0, height, width);
 	else
@@ -65,18 +73,28 @@ Blob<Dtype>::Blob(const int num, const int channels, const int height,
 
 template <typename Dtype>
 const Dtype* Blob<Dtype>::cpu_data() const {
+  CHECK(!compact_) << "Blob data is in compact storage.";
   CHECK(data_);
   return (const Dtype*)data_->cpu_data();
 }
 
 template <typename Dtype>
 void Blob<Dtype>::set_cpu_data(Dtype* data) {
+  CHECK(!compact_) << "Blob data is in compact storage.";
   CHECK(data);
   data_->set_cpu_data(data);
 }
 
+template <typename Dtype>
+void Blob<Dtype>::set_cpu_data(Dtype* data, const shared_ptr<void>& owner) {
+  CHECK(!compact_) << "Blob data is in compact storage.";
+  CHECK(data);
+  data_->set_cpu_data(data, owner);
+}
+
 template <typename Dtype>
 const Dtype* Blob<Dtype>::gpu_data() const {
+  CHECK(!compact_) << "Blob data is in compact storage.";
   CHECK(data_);
   return (const Dtype*)data_->gpu_data();
 }
@@ -95,12 +113,14 @@ const Dtype* Blob<Dtype>::gpu_diff() const {
 
 template <typename Dtype>
 Dtype* Blob<Dtype>::mutable_cpu_data() {
+  CHECK(!compact_) << "Blob data is in compact storage.";
   CHECK(data_);
   return reinterpret_cast<Dtype*>(data_->mutable_cpu_data());
 }
 
 template <typename Dtype>
 Dtype* Blob<Dtype>::mutable_gpu_data() {
+  CHECK(!compact_) << "Blob data is in compact storage.";
   CHECK(data_);
   return reinterpret_cast<Dtype*>(data_->mutable_gpu_data());
 }
@@ -120,13 +140,50 @@ Dtype* Blob<Dtype>::mutable_gpu_diff() {
 template <typename Dtype>
 void Blob<Dtype>::ShareData(const Blob& other) {
   CHECK_EQ(count_, other.count());
+  CHECK(!other.compact()) << "Cannot share the data of a compact blob.";
   data_ = other.data();
+  // The shared memory may be smaller than what this blob held before, so a
+  // later Reshape may only grow within what both data_ and diff_ hold.
+  capacity_ = count_;
 }
 
 template <typename Dtype>
 void Blob<Dtype>::ShareDiff(const Blob& other) {
   CHECK_EQ(count_, other.count());
   diff_ = other.diff();
+  capacity_ = count_;
+}
+
+template <typename Dtype>
+void Blob<Dtype>::ShareView(const Blob& other, const int offset) {
+  CHECK_GE(offset, 0);
+  CHECK_LE(offset + count_, other.count());
+  CHECK(!compact_ && !other.compact()) << "Cannot view a compact blob.";
+  if (!DataIsViewOf(other, offset)) {
+    data_.reset(new SyncedMemory(other.data(), offset * sizeof(Dtype),
+        count_ * sizeof(Dtype)));
+  }
+  if (!DiffIsViewOf(other, offset)) {
+    diff_.reset(new SyncedMemory(other.diff(), offset * sizeof(Dtype),
+        count_ * sizeof(Dtype)));
+  }
+  capacity_ = count_;
+}
+
+static bool IsViewOf(const shared_ptr<SyncedMemory>& memory,
+    const shared_ptr<SyncedMemory>& parent, const size_t offset) {
+  return memory && memory->is_view() && memory->parent() == parent &&
+      memory->offset() == offset;
+}
+
+template <typename Dtype>
+bool Blob<Dtype>::DataIsViewOf(const Blob& other, const int offset) const {
+  return IsViewOf(data_, other.data_, offset * sizeof(Dtype));
+}
+
+template <typename Dtype>
+bool Blob<Dtype>::DiffIsViewOf(const Blob& other, const int offset) const {
+  return IsViewOf(diff_, other.diff_, offset * sizeof(Dtype));
 }
 
 template <typename Dtype>
@@ -213,9 +270,15 @@ void Blob<Dtype>::ToProto(BlobProto* proto, bool write_diff) const {
   proto->set_width(width_);
   proto->clear_data();
   proto->clear_diff();
-  const Dtype* data_vec = cpu_data();
-  for (int i = 0; i < count_; ++i) {
-    proto->add_data(data_vec[i]);
+  if (compact_) {
+    proto->mutable_data()->Resize(count_, 0);
+    FromHalf(compact_format_, count_, cpu_compact_data(),
+        proto->mutable_data()->mutable_data());
+  } else {
+    const Dtype* data_vec = cpu_data();
+    for (int i = 0; i < count_; ++i) {
+      proto->add_data(data_vec[i]);
+    }
   }
   if (write_diff) {
     const Dtype* diff_vec = cpu_diff();
@@ -225,6 +288,38 @@ void Blob<Dtype>::ToProto(BlobProto* proto, bool write_diff) const {
   }
 }
 
+template <typename Dtype>
+void Blob<Dtype>::Compact(const HalfFormat format) {
+  CHECK(!compact_) << "Blob is already compact.";
+  compact_data_.reset(new SyncedMemory(count_ * sizeof(uint16_t)));
+  ToHalf(format, count_, cpu_data(),
+      static_cast<uint16_t*>(compact_data_->mutable_cpu_data()));
+  // A fresh SyncedMemory allocates nothing until it is used.
+  data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+  compact_ = true;
+  compact_format_ = format;
+}
+
+template <typename Dtype>
+void Blob<Dtype>::Expand() {
+  const uint16_t* compact_data = cpu_compact_data();
+  compact_ = false;
+  FromHalf(compact_format_, count_, compact_data, mutable_cpu_data());
+  compact_data_.reset();
+}
+
+template <typename Dtype>
+const uint16_t* Blob<Dtype>::cpu_compact_data() const {
+  CHECK(compact_) << "Blob is not compact.";
+  return static_cast<const uint16_t*>(compact_data_->cpu_data());
+}
+
+template <typename Dtype>
+uint16_t* Blob<Dtype>::mutable_cpu_compact_data() {
+  CHECK(compact_) << "Blob is not compact.";
+  return static_cast<uint16_t*>(compact_data_->mutable_cpu_data());
+}
+
 INSTANTIATE_CLASS(Blob);
 
 }  // namespace caffe
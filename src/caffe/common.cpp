@@ -1,5 +1,7 @@
 // Copyright 2014 BVLC and contributors.
 
+#include <pthread.h>
+
 #include <cstdio>
 #include <ctime>
 
@@ -47,6 +49,11 @@ Caffe::~Caffe() {
 }
 
 void Caffe::set_random_seed(const unsigned int seed) {
+  ThreadContext* context = thread_context();
+  if (context) {
+    context->random_generator.reset(new RNG(seed));
+    return;
+  }
   // Curand seed
   // Yangqing's note: simply setting the generator seed does not seem to
   // work on the tesla K20s, so I wrote the ugly reset thing below.
@@ -63,6 +70,31 @@ void Caffe::set_random_seed(const unsigned int seed) {
   Get().random_generator_.reset(new RNG(seed));
 }
 
+static pthread_key_t thread_context_key;
+static pthread_once_t thread_context_key_once = PTHREAD_ONCE_INIT;
+
+static void DeleteThreadContext(void* context) {
+  delete static_cast<Caffe::ThreadContext*>(context);
+}
+
+static void CreateThreadContextKey() {
+  CHECK(!pthread_key_create(&thread_context_key, DeleteThreadContext));
+}
+
+void Caffe::InitThreadContext() {
+  ThreadContext* context = new ThreadContext;
+  context->mode = Get().mode_;
+  context->phase = Get().phase_;
+  pthread_once(&thread_context_key_once, CreateThreadContextKey);
+  delete thread_context();
+  CHECK(!pthread_setspecific(thread_context_key, context));
+}
+
+Caffe::ThreadContext* Caffe::thread_context() {
+  pthread_once(&thread_context_key_once, CreateThreadContextKey);
+  return static_cast<ThreadContext*>(pthread_getspecific(thread_context_key));
+}
+
 void Caffe::SetDevice(const int device_id) {
   int current_device;
   CUDA_CHECK(cudaGetDevice(&current_device));
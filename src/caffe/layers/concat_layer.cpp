@@ -21,7 +21,12 @@ void ConcatLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
     "concat_dim should be >= 0";
   CHECK_LE(concat_dim_, 1) <<
     "For now concat_dim <=1, it can only concat num and channels";
+  Reshape(bottom, top);
+}
 
+template <typename Dtype>
+void ConcatLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
   // Initialize with the first blob.
   count_ = bottom[0]->count();
   num_ = bottom[0]->num();
@@ -45,6 +50,17 @@ void ConcatLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   }
   (*top)[0]->Reshape(num_, channels_, length_, height_, width_);
   CHECK_EQ(count_, (*top)[0]->count());
+  if (bottom_views_.empty() || (concat_dim_ == 1 && num_ > 1)) {
+    return;
+  }
+  CHECK_EQ(bottom_views_.size(), bottom.size());
+  int offset = 0;
+  for (int i = 0; i < bottom.size(); ++i) {
+    if (bottom_views_[i]) {
+      bottom[i]->ShareView(*(*top)[0], offset);
+    }
+    offset += bottom[i]->count();
+  }
 }
 
 template <typename Dtype>
@@ -54,22 +70,30 @@ Dtype ConcatLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   if (concat_dim_== 0) {
     int offset_num = 0;
     for (int i = 0; i < bottom.size(); ++i) {
+      const int offset = (*top)[0]->offset(offset_num);
+      offset_num += bottom[i]->num();
+      if (bottom[i]->DataIsViewOf(*(*top)[0], offset)) {
+        continue;
+      }
       const Dtype* bottom_data = bottom[i]->cpu_data();
       int num_elem = bottom[i]->count();
-      caffe_copy(num_elem, bottom_data, top_data+(*top)[0]->offset(offset_num));
-      offset_num += bottom[i]->num();
+      caffe_copy(num_elem, bottom_data, top_data + offset);
     }
   } else if (concat_dim_ == 1) {
     int offset_channel = 0;
     for (int i = 0; i < bottom.size(); ++i) {
+      const int offset = (*top)[0]->offset(0, offset_channel);
+      offset_channel += bottom[i]->channels();
+      if (bottom[i]->DataIsViewOf(*(*top)[0], offset)) {
+        continue;
+      }
       const Dtype* bottom_data = bottom[i]->cpu_data();
-      int num_elem =
-        bottom[i]->channels()*bottom[i]->height()*bottom[i]->width();
+      int num_elem = bottom[i]->channels() * bottom[i]->length() *
+          bottom[i]->height() * bottom[i]->width();
       for (int n = 0; n < num_; ++n) {
         caffe_copy(num_elem, bottom_data+bottom[i]->offset(n),
-          top_data+(*top)[0]->offset(n, offset_channel));
+          top_data + offset + (*top)[0]->offset(n));
       }
-      offset_channel += bottom[i]->channels();
     }  // concat_dim_ is guaranteed to be 0 or 1 by SetUp.
   }
   return Dtype(0.);
@@ -83,22 +107,30 @@ void ConcatLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     int offset_num = 0;
     for (int i = 0; i < bottom->size(); ++i) {
       Blob<Dtype>* blob = (*bottom)[i];
-      Dtype* bottom_diff = blob->mutable_cpu_diff();
-      caffe_copy(blob->count(),
-        top_diff+top[0]->offset(offset_num), bottom_diff);
+      const int offset = top[0]->offset(offset_num);
       offset_num += blob->num();
+      if (blob->DiffIsViewOf(*top[0], offset)) {
+        continue;
+      }
+      Dtype* bottom_diff = blob->mutable_cpu_diff();
+      caffe_copy(blob->count(), top_diff + offset, bottom_diff);
     }
   } else if (concat_dim_ == 1) {
     int offset_channel = 0;
     for (int i = 0; i < bottom->size(); ++i) {
       Blob<Dtype>* blob = (*bottom)[i];
+      const int offset = top[0]->offset(0, offset_channel);
+      offset_channel += blob->channels();
+      if (blob->DiffIsViewOf(*top[0], offset)) {
+        continue;
+      }
       Dtype* bottom_diff = blob->mutable_cpu_diff();
-      int num_elem = blob->channels()*blob->height()*blob->width();
+      int num_elem = blob->channels() * blob->length() * blob->height() *
+          blob->width();
       for (int n = 0; n < num_; ++n) {
-        caffe_copy(num_elem, top_diff+top[0]->offset(n, offset_channel),
+        caffe_copy(num_elem, top_diff + offset + top[0]->offset(n),
           bottom_diff+blob->offset(n));
       }
-      offset_channel += blob->channels();
     }
   }  // concat_dim_ is guaranteed to be 0 or 1 by SetUp.
 }
@@ -15,22 +15,29 @@ Dtype ConcatLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
   if (concat_dim_ == 0) {
     int offset_num = 0;
     for (int i = 0; i < bottom.size(); ++i) {
-      const Dtype* bottom_data = bottom[i]->gpu_data();
-      caffe_gpu_copy(bottom[i]->count(), bottom_data,
-        top_data + (*top)[0]->offset(offset_num));
+      const int offset = (*top)[0]->offset(offset_num);
       offset_num += bottom[i]->num();
+      if (bottom[i]->DataIsViewOf(*(*top)[0], offset)) {
+        continue;
+      }
+      const Dtype* bottom_data = bottom[i]->gpu_data();
+      caffe_gpu_copy(bottom[i]->count(), bottom_data, top_data + offset);
     }
   } else if (concat_dim_ == 1) {
     int offset_channel = 0;
     for (int i = 0; i < bottom.size(); ++i) {
+      const int offset = (*top)[0]->offset(0, offset_channel);
+      offset_channel += bottom[i]->channels();
+      if (bottom[i]->DataIsViewOf(*(*top)[0], offset)) {
+        continue;
+      }
       const Dtype* bottom_data = bottom[i]->gpu_data();
-      int num_elem =
-        bottom[i]->channels() * bottom[i]->height() * bottom[i]->width();
+      int num_elem = bottom[i]->channels() * bottom[i]->length() *
+          bottom[i]->height() * bottom[i]->width();
       for (int n = 0; n < num_; ++n) {
         caffe_gpu_copy(num_elem, bottom_data+bottom[i]->offset(n),
-          top_data + (*top)[0]->offset(n, offset_channel));
+          top_data + offset + (*top)[0]->offset(n));
       }
-      offset_channel += bottom[i]->channels();
     }
   } else {
     LOG(FATAL) << "concat_dim along dim" << concat_dim_ <<
@@ -47,22 +54,30 @@ void ConcatLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top,
     int offset_num = 0;
     for (int i = 0; i < bottom->size(); ++i) {
       Blob<Dtype>* blob = (*bottom)[i];
-      Dtype* bottom_diff = blob->mutable_gpu_diff();
-      caffe_gpu_copy(blob->count(),
-        top_diff + top[0]->offset(offset_num), bottom_diff);
+      const int offset = top[0]->offset(offset_num);
       offset_num += blob->num();
+      if (blob->DiffIsViewOf(*top[0], offset)) {
+        continue;
+      }
+      Dtype* bottom_diff = blob->mutable_gpu_diff();
+      caffe_gpu_copy(blob->count(), top_diff + offset, bottom_diff);
     }
   } else if (concat_dim_ == 1) {
     int offset_channel = 0;
     for (int i = 0; i < bottom->size(); ++i) {
       Blob<Dtype>* blob = (*bottom)[i];
+      const int offset = top[0]->offset(0, offset_channel);
+      offset_channel += blob->channels();
+      if (blob->DiffIsViewOf(*top[0], offset)) {
+        continue;
+      }
       Dtype* bottom_diff = blob->mutable_gpu_diff();
-      int num_elem = blob->channels()*blob->height()*blob->width();
+      int num_elem = blob->channels() * blob->length() * blob->height() *
+          blob->width();
       for (int n = 0; n < num_; ++n) {
-        caffe_gpu_copy(num_elem, top_diff + top[0]->offset(n, offset_channel),
+        caffe_gpu_copy(num_elem, top_diff + offset + top[0]->offset(n),
           bottom_diff + blob->offset(n));
       }
-      offset_channel += blob->channels();
     }
   } else {
     LOG(FATAL) << "concat_dim along dim" << concat_dim_ <<
@@ -19,19 +19,10 @@ void ConvolutionLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   stride_ = this->layer_param_.convolution_param().stride();
   group_ = this->layer_param_.convolution_param().group();
   pad_ = this->layer_param_.convolution_param().pad();
-  num_ = bottom[0]->num();
   channels_ = bottom[0]->channels();
-  height_ = bottom[0]->height();
-  width_ = bottom[0]->width();
   num_output_ = this->layer_param_.convolution_param().num_output();
   CHECK_GT(num_output_, 0);
   CHECK_EQ(channels_ % group_, 0);
-  // The im2col result buffer would only hold one image at a time to avoid
-  // overly large memory usage.
-  int height_out = (height_ + 2 * pad_ - kernel_size_) / stride_ + 1;
-  int width_out = (width_ + 2 * pad_ - kernel_size_) / stride_ + 1;
-  col_buffer_.Reshape(
-      1, channels_ * kernel_size_ * kernel_size_, 1, height_out, width_out);
   // Set the parameters
   CHECK_EQ(num_output_ % group_, 0)
       << "Number of output should be multiples of group.";
@@ -39,8 +30,6 @@ void ConvolutionLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   // Figure out the dimensions for individual gemms.
   M_ = num_output_ / group_;
   K_ = channels_ * kernel_size_ * kernel_size_ / group_;
-  N_ = height_out * width_out;
-  (*top)[0]->Reshape(bottom[0]->num(), num_output_, 1, height_out, width_out);
   // Check if we need to set up the weights
   if (this->blobs_.size() > 0) {
     LOG(INFO) << "Skipping parameter initialization";
@@ -65,8 +54,28 @@ void ConvolutionLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
       bias_filler->Fill(this->blobs_[1].get());
     }
   }
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  CHECK_EQ(bottom[0]->channels(), channels_)
+      << "Input channels cannot change after SetUp.";
+  num_ = bottom[0]->num();
+  height_ = bottom[0]->height();
+  width_ = bottom[0]->width();
+  // The im2col result buffer would only hold one image at a time to avoid
+  // overly large memory usage. Like that of Convolution3DLayer it comes from
+  // the workspace of the net, shared by all its convolutions.
+  int height_out = (height_ + 2 * pad_ - kernel_size_) / stride_ + 1;
+  int width_out = (width_ + 2 * pad_ - kernel_size_) / stride_ + 1;
+  N_ = height_out * width_out;
+  this->ReserveWorkspace(group_ * K_ * N_ * sizeof(Dtype));
+  (*top)[0]->Reshape(num_, num_output_, 1, height_out, width_out);
   // Set up the bias filler
-  if (bias_term_) {
+  if (bias_term_ && (!bias_multiplier_ ||
+      bias_multiplier_->size() != N_ * sizeof(Dtype))) {
     bias_multiplier_.reset(new SyncedMemory(N_ * sizeof(Dtype)));
     Dtype* bias_multiplier_data =
         reinterpret_cast<Dtype*>(bias_multiplier_->mutable_cpu_data());
@@ -82,7 +91,8 @@ Dtype ConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top) {
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = (*top)[0]->mutable_cpu_data();
-  Dtype* col_data = col_buffer_.mutable_cpu_data();
+  Dtype* col_data = static_cast<Dtype*>(
+      this->workspace()->mutable_cpu_data(group_ * K_ * N_ * sizeof(Dtype)));
   const Dtype* weight = this->blobs_[0]->cpu_data();
   int weight_offset = M_ * K_;
   int col_offset = K_ * N_;
@@ -116,8 +126,11 @@ void ConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
   Dtype* weight_diff = this->blobs_[0]->mutable_cpu_diff();
   const Dtype* bottom_data = (*bottom)[0]->cpu_data();
   Dtype* bottom_diff = (*bottom)[0]->mutable_cpu_diff();
-  Dtype* col_data = col_buffer_.mutable_cpu_data();
-  Dtype* col_diff = col_buffer_.mutable_cpu_diff();
+  // The columns are no longer needed once the weight gradient has them, so
+  // their gradient overwrites them in the same scratch.
+  Dtype* col_data = static_cast<Dtype*>(
+      this->workspace()->mutable_cpu_data(group_ * K_ * N_ * sizeof(Dtype)));
+  Dtype* col_diff = col_data;
   // bias gradient if necessary
   Dtype* bias_diff = NULL;
 
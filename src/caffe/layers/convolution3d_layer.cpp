@@ -37,11 +37,7 @@ void Convolution3DLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   temporal_stride_ = this->layer_param_.convolution_param().temporal_stride();
   pad_ = this->layer_param_.convolution_param().pad();
   temporal_pad_ = this->layer_param_.convolution_param().temporal_pad();
-  num_ = bottom[0]->num();
   channels_ = bottom[0]->channels();
-  length_ = bottom[0]->length();
-  height_ = bottom[0]->height();
-  width_ = bottom[0]->width();
   num_output_ = this->layer_param_.convolution_param().num_output();
   filter_group_ = this->layer_param_.convolution_param().filter_group();
   CHECK_GT(num_output_, 0);
@@ -49,27 +45,12 @@ void Convolution3DLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   // number of output filters must be divided by filter_group
   CHECK_EQ(num_output_ % filter_group_, 0);
 
-  // The vol2col result buffer would only hold one image at a time to avoid
-  // overly large memory usage.
-
-  int height_out = (height_ + 2 * pad_ - kernel_size_) / stride_ + 1;
-  int width_out = (width_ + 2 * pad_ - kernel_size_) / stride_ + 1;
-  int length_out = (length_ + 2 * temporal_pad_ - kernel_depth_) / temporal_stride_ + 1;
-
-  // buffer for one image
-  col_buffer_.Reshape(
-      1, channels_ * kernel_depth_ * kernel_size_ * kernel_size_, length_out, height_out, width_out);
-
-
   bias_term_ = this->layer_param_.convolution_param().bias_term();
 
-  // Figure out the dimensions for individual gemms.
+  // Figure out the dimensions for individual gemms which do not depend on
+  // the input volume; N_ is set in Reshape().
   M_ = num_output_ / filter_group_; // doing convolution filter_group_ times per volume
   K_ = channels_ * kernel_depth_ * kernel_size_ * kernel_size_;
-  N_ = length_out * height_out * width_out;
-
-  // output size
-  (*top)[0]->Reshape(bottom[0]->num(), num_output_, length_out, height_out, width_out);
 
   // Check if we need to set up the weights
   if (this->blobs_.size() > 0) {
@@ -98,8 +79,42 @@ void Convolution3DLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
 
   }
 
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void Convolution3DLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  // The weights are sized by the input channels, so only the batch size and
+  // the spatio-temporal extent of the clip may change here.
+  CHECK_EQ(bottom[0]->channels(), channels_)
+      << "Input channels cannot change after SetUp.";
+  num_ = bottom[0]->num();
+  length_ = bottom[0]->length();
+  height_ = bottom[0]->height();
+  width_ = bottom[0]->width();
+
+  int height_out = (height_ + 2 * pad_ - kernel_size_) / stride_ + 1;
+  int width_out = (width_ + 2 * pad_ - kernel_size_) / stride_ + 1;
+  int length_out = (length_ + 2 * temporal_pad_ - kernel_depth_) / temporal_stride_ + 1;
+  CHECK_GT(length_out, 0) << "Clip length " << length_
+      << " is shorter than the temporal kernel.";
+
+  N_ = length_out * height_out * width_out;
+
+  // The vol2col result buffer would only hold one image at a time to avoid
+  // overly large memory usage. It lives in the workspace shared with the
+  // other layers, as it is only used within one Forward/Backward call. A
+  // compact top also takes the output of one image there.
+  const int top_image_count = (*top)[0]->compact() ? num_output_ * N_ : 0;
+  this->ReserveWorkspace((K_ * N_ + top_image_count) * sizeof(Dtype));
+
+  // output size
+  (*top)[0]->Reshape(num_, num_output_, length_out, height_out, width_out);
+
   // Set up the bias filler
-  if (bias_term_) {
+  if (bias_term_ && (!bias_multiplier_ ||
+      bias_multiplier_->size() != N_ * sizeof(Dtype))) {
     bias_multiplier_.reset(new SyncedMemory(N_ * sizeof(Dtype)));
     Dtype* bias_multiplier_data =
         reinterpret_cast<Dtype*>(bias_multiplier_->mutable_cpu_data());
@@ -110,34 +125,66 @@ void Convolution3DLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
 }
 
 
+template <typename Dtype>
+bool Convolution3DLayer<Dtype>::CompactWeights(const HalfFormat format) {
+  this->blobs_[0]->Compact(format);
+  return true;
+}
+
 template <typename Dtype>
 Dtype Convolution3DLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top) {
-  const Dtype* bottom_data = bottom[0]->cpu_data();
-  Dtype* top_data = (*top)[0]->mutable_cpu_data();
-  Dtype* col_data = col_buffer_.mutable_cpu_data();
-  const Dtype* weight = this->blobs_[0]->cpu_data();
+  Blob<Dtype>* top_blob = (*top)[0];
+  // A compact top is computed one image at a time in the workspace, after
+  // the columns, and stored compact.
+  const bool compact_top = top_blob->compact();
+  const int top_image_count = num_output_ * N_;
+  Dtype* col_data = static_cast<Dtype*>(this->workspace()->mutable_cpu_data(
+      (K_ * N_ + (compact_top ? top_image_count : 0)) * sizeof(Dtype)));
+  Dtype* top_data = compact_top ? NULL : top_blob->mutable_cpu_data();
+  const Blob<Dtype>& weight = *this->blobs_[0];
 
   int weight_offset = M_ * K_;
   int top_offset = M_ * N_;
 
   for (int n = 0; n < num_; ++n) {
-	// First, im2col
-    vol2col_cpu(bottom_data + bottom[0]->offset(n), channels_, length_, height_,
-	    		  width_, kernel_size_, kernel_depth_, pad_, temporal_pad_, stride_, temporal_stride_, col_data);
+	// First, im2col. Compact bottoms are converted on the way.
+    if (bottom[0]->compact()) {
+      vol2col_cpu(bottom[0]->cpu_compact_data() + bottom[0]->offset(n),
+          bottom[0]->compact_format(), channels_, length_, height_, width_,
+          kernel_size_, kernel_depth_, pad_, temporal_pad_, stride_,
+          temporal_stride_, col_data);
+    } else {
+      vol2col_cpu(bottom[0]->cpu_data() + bottom[0]->offset(n), channels_,
+          length_, height_, width_, kernel_size_, kernel_depth_, pad_,
+          temporal_pad_, stride_, temporal_stride_, col_data);
+    }
+    Dtype* image_top = compact_top ? col_data + K_ * N_ :
+        top_data + top_blob->offset(n);
 
     // Second, inner-product without filter groups
 	for (int g=0 ; g < filter_group_; ++g) {
-      caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, K_,
-	    (Dtype)1., weight + g * weight_offset, col_data,
-	    (Dtype)0., top_data + (*top)[0]->offset(n) + g * top_offset);
+      if (weight.compact()) {
+        caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, K_,
+            (Dtype)1., weight.cpu_compact_data() + g * weight_offset,
+            weight.compact_format(), col_data,
+            (Dtype)0., image_top + g * top_offset);
+      } else {
+        caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, K_,
+            (Dtype)1., weight.cpu_data() + g * weight_offset, col_data,
+            (Dtype)0., image_top + g * top_offset);
+      }
 	}
       // third, add bias
 	if (bias_term_) {
 	  caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, num_output_,
 	   N_, 1, (Dtype)1., this->blobs_[1]->cpu_data(),
 	   reinterpret_cast<const Dtype*>(bias_multiplier_->cpu_data()),
-	   (Dtype)1., top_data + (*top)[0]->offset(n));
+	   (Dtype)1., image_top);
+    }
+    if (compact_top) {
+      ToHalf(top_blob->compact_format(), top_image_count, image_top,
+          top_blob->mutable_cpu_compact_data() + top_blob->offset(n));
     }
 
   }
@@ -152,8 +199,11 @@ void Convolution3DLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
   Dtype* weight_diff = this->blobs_[0]->mutable_cpu_diff();
   const Dtype* bottom_data = (*bottom)[0]->cpu_data();
   Dtype* bottom_diff = (*bottom)[0]->mutable_cpu_diff();
-  Dtype* col_data = col_buffer_.mutable_cpu_data();
-  Dtype* col_diff = col_buffer_.mutable_cpu_diff();
+  // The columns are no longer needed once the weight gradient has them, so
+  // their gradient overwrites them in the same scratch.
+  Dtype* col_data = static_cast<Dtype*>(
+      this->workspace()->mutable_cpu_data(K_ * N_ * sizeof(Dtype)));
+  Dtype* col_diff = col_data;
   // bias gradient if necessary
   Dtype* bias_diff = NULL;
 
@@ -29,7 +29,8 @@ Dtype Convolution3DLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top) {
   const Dtype* bottom_data = bottom[0]->gpu_data();
   Dtype* top_data = (*top)[0]->mutable_gpu_data();
-  Dtype* col_data = col_buffer_.mutable_gpu_data();
+  Dtype* col_data = static_cast<Dtype*>(
+      this->workspace()->mutable_gpu_data(K_ * N_ * sizeof(Dtype)));
   const Dtype* weight = this->blobs_[0]->gpu_data();
 
   int weight_offset = M_ * K_;
@@ -64,8 +65,11 @@ void Convolution3DLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top,
   Dtype* weight_diff = this->blobs_[0]->mutable_gpu_diff();
   const Dtype* bottom_data = (*bottom)[0]->gpu_data();
   Dtype* bottom_diff = (*bottom)[0]->mutable_gpu_diff();
-  Dtype* col_data = col_buffer_.mutable_gpu_data();
-  Dtype* col_diff = col_buffer_.mutable_gpu_diff();
+  // The columns are no longer needed once the weight gradient has them, so
+  // their gradient overwrites them in the same scratch.
+  Dtype* col_data = static_cast<Dtype*>(
+      this->workspace()->mutable_gpu_data(K_ * N_ * sizeof(Dtype)));
+  Dtype* col_diff = col_data;
   // bias gradient if necessary
   Dtype* bias_diff = NULL;
 
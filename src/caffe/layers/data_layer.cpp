@@ -1,13 +1,15 @@
 // Copyright 2014 BVLC and contributors.
 
 #include <stdint.h>
-#include <leveldb/db.h>
 #include <pthread.h>
 
 #include <string>
 #include <vector>
 
 #include "caffe/layer.hpp"
+#include "caffe/util/data_transform.hpp"
+#include "caffe/util/db.hpp"
+#include "caffe/util/datum_view.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/math_functions.hpp"
 #include "caffe/util/rng.hpp"
@@ -22,7 +24,7 @@ void* DataLayerPrefetch(void* layer_pointer) {
   CHECK(layer_pointer);
   DataLayer<Dtype>* layer = static_cast<DataLayer<Dtype>*>(layer_pointer);
   CHECK(layer);
-  Datum datum;
+  DatumView datum;
   CHECK(layer->prefetch_data_);
   Dtype* top_data = layer->prefetch_data_->mutable_cpu_data();
   Dtype* top_label;
@@ -44,15 +46,19 @@ void* DataLayerPrefetch(void* layer_pointer) {
   const int width = layer->datum_width_;
   const int size = layer->datum_size_;
   const Dtype* mean = layer->data_mean_.cpu_data();
+  const int top_size =
+      crop_size ? channels * crop_size * crop_size : size;
   for (int item_id = 0; item_id < batch_size; ++item_id) {
     // get a blob
-    CHECK(layer->iter_);
-    CHECK(layer->iter_->Valid());
-    datum.ParseFromString(layer->iter_->value().ToString());
-    const string& data = datum.data();
+    CHECK(layer->cursor_);
+    CHECK(datum.ParseDatum(layer->cursor_->value(),
+        layer->cursor_->value_size())) << "Failed to parse the datum at "
+        << layer->cursor_->key();
+    int h_off = 0;
+    int w_off = 0;
+    bool do_mirror = false;
     if (crop_size) {
-      CHECK(data.size()) << "Image cropping only support uint8 data";
-      int h_off, w_off;
+      CHECK(datum.data_size()) << "Image cropping only support uint8 data";
       // We only do random crop when we do training.
       if (layer->phase_ == Caffe::TRAIN) {
         h_off = layer->PrefetchRand() % (height - crop_size);
@@ -61,61 +67,23 @@ void* DataLayerPrefetch(void* layer_pointer) {
         h_off = (height - crop_size) / 2;
         w_off = (width - crop_size) / 2;
       }
-      if (mirror && layer->PrefetchRand() % 2) {
-        // Copy mirrored version
-        for (int c = 0; c < channels; ++c) {
-          for (int h = 0; h < crop_size; ++h) {
-            for (int w = 0; w < crop_size; ++w) {
-              int top_index = ((item_id * channels + c) * crop_size + h)
-                              * crop_size + (crop_size - 1 - w);
-              int data_index = (c * height + h + h_off) * width + w + w_off;
-              Dtype datum_element =
-                  static_cast<Dtype>(static_cast<uint8_t>(data[data_index]));
-              top_data[top_index] = (datum_element - mean[data_index]) * scale;
-            }
-          }
-        }
-      } else {
-        // Normal copy
-        for (int c = 0; c < channels; ++c) {
-          for (int h = 0; h < crop_size; ++h) {
-            for (int w = 0; w < crop_size; ++w) {
-              int top_index = ((item_id * channels + c) * crop_size + h)
-                              * crop_size + w;
-              int data_index = (c * height + h + h_off) * width + w + w_off;
-              Dtype datum_element =
-                  static_cast<Dtype>(static_cast<uint8_t>(data[data_index]));
-              top_data[top_index] = (datum_element - mean[data_index]) * scale;
-            }
-          }
-        }
-      }
+      do_mirror = mirror && layer->PrefetchRand() % 2;
+    }
+    // we will prefer to use data() first, and then try float_data()
+    if (datum.data_size()) {
+      TransformVolumeData(datum.data(), mean,
+          channels, 1, height, width, crop_size, h_off, w_off, do_mirror,
+          scale, top_data + item_id * top_size, NULL);
     } else {
-      // we will prefer to use data() first, and then try float_data()
-      if (data.size()) {
-        for (int j = 0; j < size; ++j) {
-          Dtype datum_element =
-              static_cast<Dtype>(static_cast<uint8_t>(data[j]));
-          top_data[item_id * size + j] = (datum_element - mean[j]) * scale;
-        }
-      } else {
-        for (int j = 0; j < size; ++j) {
-          top_data[item_id * size + j] =
-              (datum.float_data(j) - mean[j]) * scale;
-        }
-      }
+      TransformFloatData(datum.float_data(), mean, size, scale,
+          top_data + item_id * size);
     }
 
     if (layer->output_labels_) {
       top_label[item_id] = datum.label();
     }
-    // go to the next iter
-    layer->iter_->Next();
-    if (!layer->iter_->Valid()) {
-      // We have reached the end. Restart from the first.
-      DLOG(INFO) << "Restarting data prefetching from start.";
-      layer->iter_->SeekToFirst();
-    }
+    // go to the next record, restarting from the first after the last
+    layer->cursor_->Next();
   }
 
   return static_cast<void*>(NULL);
@@ -137,35 +105,21 @@ void DataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   } else {
     output_labels_ = true;
   }
-  // Initialize the leveldb
-  leveldb::DB* db_temp;
-  leveldb::Options options;
-  options.create_if_missing = false;
-  options.max_open_files = 100;
-  LOG(INFO) << "Opening leveldb " << this->layer_param_.data_param().source();
-  leveldb::Status status = leveldb::DB::Open(
-      options, this->layer_param_.data_param().source(), &db_temp);
-  CHECK(status.ok()) << "Failed to open leveldb "
-      << this->layer_param_.data_param().source() << std::endl
-      << status.ToString();
-  db_.reset(db_temp);
-  iter_.reset(db_->NewIterator(leveldb::ReadOptions()));
-  iter_->SeekToFirst();
+  // Initialize the database
+  db_.reset(Database::Open(this->layer_param_.data_param().backend(),
+      this->layer_param_.data_param().source()));
+  cursor_.reset(db_->NewCursor());
   // Check if we would need to randomly skip a few data points
   if (this->layer_param_.data_param().rand_skip()) {
     unsigned int skip = caffe_rng_rand() %
                         this->layer_param_.data_param().rand_skip();
     LOG(INFO) << "Skipping first " << skip << " data points.";
-    while (skip-- > 0) {
-      iter_->Next();
-      if (!iter_->Valid()) {
-        iter_->SeekToFirst();
-      }
-    }
+    cursor_->SeekTo(skip);
   }
   // Read a data point, and use it to initialize the top blob.
-  Datum datum;
-  datum.ParseFromString(iter_->value().ToString());
+  DatumView datum;
+  CHECK(datum.ParseDatum(cursor_->value(), cursor_->value_size()))
+      << "Failed to parse the datum at " << cursor_->key();
   // image
   int crop_size = this->layer_param_.data_param().crop_size();
   if (crop_size > 0) {
@@ -226,6 +180,18 @@ void DataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   DLOG(INFO) << "Initializing prefetch";
   CreatePrefetchThread();
   DLOG(INFO) << "Prefetch initialized.";
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void DataLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  // The batch shape is fixed by the layer parameters; the tops simply mirror
+  // the prefetch buffers that Forward copies from.
+  (*top)[0]->ReshapeLike(*prefetch_data_);
+  if (output_labels_) {
+    (*top)[1]->ReshapeLike(*prefetch_label_);
+  }
 }
 
 template <typename Dtype>
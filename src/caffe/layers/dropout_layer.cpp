@@ -2,22 +2,84 @@
 
 // TODO (sergeyk): effect should not be dependent on phase. wasted memcpy.
 
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <vector>
 
 #include "caffe/common.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/philox.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/syncedmem.hpp"
 #include "caffe/vision_layers.hpp"
 
 namespace caffe {
 
+// out[i] = in[i] * scale where bit i of bits is set, and 0 elsewhere.
+template <typename Dtype>
+static void ApplyBitMask(const int n, const uint32_t* bits, const Dtype scale,
+    const Dtype* in, Dtype* out) {
+  for (int i = 0; i < n; ++i) {
+    out[i] = ((bits[i / 32] >> (i % 32)) & 1) ? in[i] * scale : Dtype(0);
+  }
+}
+
+#if defined(__SSE2__)
+template <>
+void ApplyBitMask<float>(const int n, const uint32_t* bits, const float scale,
+    const float* in, float* out) {
+  // The lane masks of every 4-bit pattern.
+  static const int kLanes[16][4] __attribute__((aligned(16))) = {
+    { 0,  0,  0,  0}, {-1,  0,  0,  0}, { 0, -1,  0,  0}, {-1, -1,  0,  0},
+    { 0,  0, -1,  0}, {-1,  0, -1,  0}, { 0, -1, -1,  0}, {-1, -1, -1,  0},
+    { 0,  0,  0, -1}, {-1,  0,  0, -1}, { 0, -1,  0, -1}, {-1, -1,  0, -1},
+    { 0,  0, -1, -1}, {-1,  0, -1, -1}, { 0, -1, -1, -1}, {-1, -1, -1, -1}};
+  const __m128 scale4 = _mm_set1_ps(scale);
+  const int simd_end = n / 32 * 32;
+  for (int i = 0; i < simd_end; i += 32) {
+    const uint32_t word = bits[i / 32];
+    for (int j = 0; j < 32; j += 4) {
+      const __m128 lanes = _mm_load_ps(
+          reinterpret_cast<const float*>(kLanes[(word >> j) & 0xF]));
+      _mm_storeu_ps(out + i + j, _mm_and_ps(
+          _mm_mul_ps(_mm_loadu_ps(in + i + j), scale4), lanes));
+    }
+  }
+  for (int i = simd_end; i < n; ++i) {
+    out[i] = ((bits[i / 32] >> (i % 32)) & 1) ? in[i] * scale : 0.f;
+  }
+}
+
+template <>
+void ApplyBitMask<double>(const int n, const uint32_t* bits,
+    const double scale, const double* in, double* out) {
+  static const int64_t kLanes[4][2] __attribute__((aligned(16))) = {
+    {0, 0}, {-1, 0}, {0, -1}, {-1, -1}};
+  const __m128d scale2 = _mm_set1_pd(scale);
+  const int simd_end = n / 32 * 32;
+  for (int i = 0; i < simd_end; i += 32) {
+    const uint32_t word = bits[i / 32];
+    for (int j = 0; j < 32; j += 2) {
+      const __m128d lanes = _mm_load_pd(
+          reinterpret_cast<const double*>(kLanes[(word >> j) & 0x3]));
+      _mm_storeu_pd(out + i + j, _mm_and_pd(
+          _mm_mul_pd(_mm_loadu_pd(in + i + j), scale2), lanes));
+    }
+  }
+  for (int i = simd_end; i < n; ++i) {
+    out[i] = ((bits[i / 32] >> (i % 32)) & 1) ? in[i] * scale : 0.;
+  }
+}
+#endif
+
 template <typename Dtype>
 void DropoutLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top) {
   NeuronLayer<Dtype>::SetUp(bottom, top);
-  // Set up the cache for random number generation
-  rand_vec_.reset(new SyncedMemory(bottom[0]->count() * sizeof(int)));
   threshold_ = this->layer_param_.dropout_param().dropout_ratio();
   DCHECK(threshold_ > 0.);
   DCHECK(threshold_ < 1.);
@@ -25,19 +87,35 @@ void DropoutLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   uint_thres_ = static_cast<unsigned int>(UINT_MAX * threshold_);
 }
 
+template <typename Dtype>
+void DropoutLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  NeuronLayer<Dtype>::Reshape(bottom, top);
+  // Set up the cache for random number generation; only grow it.
+  const size_t mask_size = bottom[0]->count() * sizeof(int);
+  if (!rand_vec_ || rand_vec_->size() < mask_size) {
+    rand_vec_.reset(new SyncedMemory(mask_size));
+  }
+  // The CPU keeps one bit per element instead.
+  const size_t bits_size = BitMaskWords(bottom[0]->count()) * sizeof(uint32_t);
+  if (!mask_bits_ || mask_bits_->size() < bits_size) {
+    mask_bits_.reset(new SyncedMemory(bits_size));
+  }
+}
+
 template <typename Dtype>
 Dtype DropoutLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     vector<Blob<Dtype>*>* top) {
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = (*top)[0]->mutable_cpu_data();
-  int* mask = reinterpret_cast<int*>(rand_vec_->mutable_cpu_data());
   const int count = bottom[0]->count();
   if (Caffe::phase() == Caffe::TRAIN) {
-    // Create random numbers
-    caffe_rng_bernoulli(count, 1. - threshold_, mask);
-    for (int i = 0; i < count; ++i) {
-      top_data[i] = bottom_data[i] * mask[i] * scale_;
-    }
+    // A fresh Philox key from the Caffe rng per pass, so that the masks
+    // follow random_seed.
+    uint32_t* mask = static_cast<uint32_t*>(mask_bits_->mutable_cpu_data());
+    const uint32_t key[2] = {caffe_rng_rand(), caffe_rng_rand()};
+    PhiloxBernoulliBits(key, count, uint_thres_, mask);
+    ApplyBitMask(count, mask, scale_, bottom_data, top_data);
   } else {
     caffe_copy(bottom[0]->count(), bottom_data, top_data);
   }
@@ -52,11 +130,9 @@ void DropoutLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
   if (propagate_down) {
     const Dtype* top_diff = top[0]->cpu_diff();
     Dtype* bottom_diff = (*bottom)[0]->mutable_cpu_diff();
-    const int* mask = reinterpret_cast<const int*>(rand_vec_->cpu_data());
-    const int count = (*bottom)[0]->count();
-    for (int i = 0; i < count; ++i) {
-      bottom_diff[i] = top_diff[i] * mask[i] * scale_;
-    }
+    const uint32_t* mask =
+        static_cast<const uint32_t*>(mask_bits_->cpu_data());
+    ApplyBitMask((*bottom)[0]->count(), mask, scale_, top_diff, bottom_diff);
   }
 }
 
@@ -15,17 +15,25 @@ void EltwiseProductLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
       "Eltwise Product Layer takes at least 2 blobs as input.";
   CHECK_EQ(top->size(), 1) <<
       "Eltwise Product Layer takes a single blob as output.";
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void EltwiseProductLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
   const int num = bottom[0]->num();
   const int channels = bottom[0]->channels();
+  const int length = bottom[0]->length();
   const int height = bottom[0]->height();
   const int width = bottom[0]->width();
   for (int i = 1; i < bottom.size(); ++i) {
     CHECK_EQ(num, bottom[i]->num());
     CHECK_EQ(channels, bottom[i]->channels());
+    CHECK_EQ(length, bottom[i]->length());
     CHECK_EQ(height, bottom[i]->height());
     CHECK_EQ(width, bottom[i]->width());
   }
-  (*top)[0]->Reshape(num, channels, 1, height, width);
+  (*top)[0]->Reshape(num, channels, length, height, width);
 }
 
 template <typename Dtype>
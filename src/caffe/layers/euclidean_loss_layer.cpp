@@ -20,8 +20,14 @@ void EuclideanLossLayer<Dtype>::FurtherSetUp(
   CHECK_EQ(bottom[0]->channels(), bottom[1]->channels());
   CHECK_EQ(bottom[0]->height(), bottom[1]->height());
   CHECK_EQ(bottom[0]->width(), bottom[1]->width());
-  diff_.Reshape(bottom[0]->num(), bottom[0]->channels(), 1,
-      bottom[0]->height(), bottom[0]->width());
+}
+
+template <typename Dtype>
+void EuclideanLossLayer<Dtype>::Reshape(
+  const vector<Blob<Dtype>*>& bottom, vector<Blob<Dtype>*>* top) {
+  LossLayer<Dtype>::Reshape(bottom, top);
+  CHECK_EQ(bottom[0]->count(), bottom[1]->count());
+  diff_.ReshapeLike(*bottom[0]);
 }
 
 template <typename Dtype>
@@ -13,8 +13,14 @@ void FlattenLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top) {
   CHECK_EQ(bottom.size(), 1) << "Flatten Layer takes a single blob as input.";
   CHECK_EQ(top->size(), 1) << "Flatten Layer takes a single blob as output.";
-  int channels_out = bottom[0]->channels() * bottom[0]->height()
-      * bottom[0]->width();
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void FlattenLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  int channels_out = bottom[0]->channels() * bottom[0]->length()
+      * bottom[0]->height() * bottom[0]->width();
   (*top)[0]->Reshape(bottom[0]->num(), channels_out, 1, 1, 1);
   count_ = bottom[0]->num() * channels_out;
   CHECK_EQ(count_, bottom[0]->count());
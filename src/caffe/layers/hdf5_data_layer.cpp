@@ -58,24 +58,37 @@ void HDF5DataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   // Read the source to parse the filenames.
   const string& source = this->layer_param_.hdf5_data_param().source();
   LOG(INFO) << "Loading filename from " << source;
+  const int num_shards = this->layer_param_.hdf5_data_param().num_shards();
+  const int shard_id = this->layer_param_.hdf5_data_param().shard_id();
+  CHECK_GE(num_shards, 1);
+  CHECK_LT(shard_id, num_shards);
   hdf_filenames_.clear();
   std::ifstream source_file(source.c_str());
   if (source_file.is_open()) {
     std::string line;
+    int line_id = 0;
     while (source_file >> line) {
-      hdf_filenames_.push_back(line);
+      // Keep only the files of this layer's shard.
+      if (line_id++ % num_shards == shard_id) {
+        hdf_filenames_.push_back(line);
+      }
     }
   }
   source_file.close();
   num_files_ = hdf_filenames_.size();
+  CHECK_GT(num_files_, 0) << "No HDF5 files in shard " << shard_id;
   current_file_ = 0;
   LOG(INFO) << "Number of files: " << num_files_;
 
   // Load the first HDF5 file and initialize the line counter.
   LoadHDF5FileData(hdf_filenames_[current_file_].c_str());
   current_row_ = 0;
+  Reshape(bottom, top);
+}
 
-  // Reshape blobs.
+template <typename Dtype>
+void HDF5DataLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
   const int batch_size = this->layer_param_.hdf5_data_param().batch_size();
   (*top)[0]->Reshape(batch_size, data_blob_.channels(), 1,
                      data_blob_.width(), data_blob_.height());
@@ -49,6 +49,12 @@ void HDF5OutputLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   CHECK_EQ(top->size(), 0) << "HDF5OutputLayer takes no output blobs.";
 }
 
+template <typename Dtype>
+void HDF5OutputLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  // Nothing to do: data_blob_ and label_blob_ are sized in every Forward.
+}
+
 template <typename Dtype>
 Dtype HDF5OutputLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top) {
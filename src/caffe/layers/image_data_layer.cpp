@@ -11,6 +11,7 @@
 #include <utility>
 
 #include "caffe/layer.hpp"
+#include "caffe/util/data_transform.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/math_functions.hpp"
 #include "caffe/util/rng.hpp"
@@ -51,6 +52,8 @@ void* ImageDataLayerPrefetch(void* layer_pointer) {
   const int size = layer->datum_size_;
   const int lines_size = layer->shuffle_index_.size();
   const Dtype* mean = layer->data_mean_.cpu_data();
+  const int top_size =
+      crop_size ? channels * crop_size * crop_size : size;
   for (int item_id = 0; item_id < batch_size; ++item_id) {
     // get a blob
     CHECK_GT(lines_size, layer->lines_id_);
@@ -61,9 +64,11 @@ void* ImageDataLayerPrefetch(void* layer_pointer) {
       continue;
     }
     const string& data = datum.data();
+    int h_off = 0;
+    int w_off = 0;
+    bool do_mirror = false;
     if (crop_size) {
       CHECK(data.size()) << "Image cropping only support uint8 data";
-      int h_off, w_off;
       // We only do random crop when we do training.
       if (layer->phase_ == Caffe::TRAIN) {
         h_off = layer->PrefetchRand() % (height - crop_size);
@@ -72,49 +77,16 @@ void* ImageDataLayerPrefetch(void* layer_pointer) {
         h_off = (height - crop_size) / 2;
         w_off = (width - crop_size) / 2;
       }
-      if (mirror && layer->PrefetchRand() % 2) {
-        // Copy mirrored version
-        for (int c = 0; c < channels; ++c) {
-          for (int h = 0; h < crop_size; ++h) {
-            for (int w = 0; w < crop_size; ++w) {
-              int top_index = ((item_id * channels + c) * crop_size + h)
-                              * crop_size + (crop_size - 1 - w);
-              int data_index = (c * height + h + h_off) * width + w + w_off;
-              Dtype datum_element =
-                  static_cast<Dtype>(static_cast<uint8_t>(data[data_index]));
-              top_data[top_index] = (datum_element - mean[data_index]) * scale;
-            }
-          }
-        }
-      } else {
-        // Normal copy
-        for (int c = 0; c < channels; ++c) {
-          for (int h = 0; h < crop_size; ++h) {
-            for (int w = 0; w < crop_size; ++w) {
-              int top_index = ((item_id * channels + c) * crop_size + h)
-                              * crop_size + w;
-              int data_index = (c * height + h + h_off) * width + w + w_off;
-              Dtype datum_element =
-                  static_cast<Dtype>(static_cast<uint8_t>(data[data_index]));
-              top_data[top_index] = (datum_element - mean[data_index]) * scale;
-            }
-          }
-        }
-      }
+      do_mirror = mirror && layer->PrefetchRand() % 2;
+    }
+    // we will prefer to use data() first, and then try float_data()
+    if (data.size()) {
+      TransformVolumeData(reinterpret_cast<const uint8_t*>(data.data()), mean,
+          channels, 1, height, width, crop_size, h_off, w_off, do_mirror,
+          scale, top_data + item_id * top_size, NULL);
     } else {
-      // Just copy the whole data
-      if (data.size()) {
-        for (int j = 0; j < size; ++j) {
-          Dtype datum_element =
-              static_cast<Dtype>(static_cast<uint8_t>(data[j]));
-          top_data[item_id * size + j] = (datum_element - mean[j]) * scale;
-        }
-      } else {
-        for (int j = 0; j < size; ++j) {
-          top_data[item_id * size + j] =
-              (datum.float_data(j) - mean[j]) * scale;
-        }
-      }
+      TransformFloatData(datum.float_data().data(), mean, size, scale,
+          top_data + item_id * size);
     }
 
     top_label[item_id] = datum.label();
@@ -156,9 +128,18 @@ void ImageDataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   string filename;
   int label;
 
+  const int num_shards = this->layer_param_.image_data_param().num_shards();
+  const int shard_id = this->layer_param_.image_data_param().shard_id();
+  CHECK_GE(num_shards, 1);
+  CHECK_LT(shard_id, num_shards);
   int c = 0;
+  int line_id = 0;
   if (use_label_){
 	  while (infile >> filename >> label) {
+		  // Keep only the lines of this layer's shard.
+		  if (line_id++ % num_shards != shard_id) {
+			  continue;
+		  }
 		  //lines_.push_back(std::make_pair(filename, label));
 		  fn_list_.push_back(filename);
 		  label_list_.push_back(label);
@@ -167,6 +148,9 @@ void ImageDataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
 	  }
   }else{
 	  while (infile >> filename) {
+		  if (line_id++ % num_shards != shard_id) {
+			  continue;
+		  }
 		  //lines_.push_back(std::make_pair(filename, label));
 		  fn_list_.push_back(filename);
 		  label_list_.push_back(0);
@@ -256,6 +240,14 @@ void ImageDataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   DLOG(INFO) << "Initializing prefetch";
   CreatePrefetchThread();
   DLOG(INFO) << "Prefetch initialized.";
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void ImageDataLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  (*top)[0]->ReshapeLike(*prefetch_data_);
+  (*top)[1]->ReshapeLike(*prefetch_label_);
 }
 
 template <typename Dtype>
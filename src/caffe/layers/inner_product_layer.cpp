@@ -19,10 +19,8 @@ void InnerProductLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   const int num_output = this->layer_param_.inner_product_param().num_output();
   bias_term_ = this->layer_param_.inner_product_param().bias_term();
   // Figure out the dimensions
-  M_ = bottom[0]->num();
   K_ = bottom[0]->count() / bottom[0]->num();
   N_ = num_output;
-  (*top)[0]->Reshape(bottom[0]->num(), num_output, 1, 1, 1);
   // Check if we need to set up the weights
   if (this->blobs_.size() > 0) {
     LOG(INFO) << "Skipping parameter initialization";
@@ -46,8 +44,25 @@ void InnerProductLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
       bias_filler->Fill(this->blobs_[1].get());
     }
   }  // parameter initialization
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void InnerProductLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  CHECK_EQ(bottom[0]->count() / bottom[0]->num(), K_)
+      << "Input size incompatible with inner product parameters.";
+  M_ = bottom[0]->num();
+  (*top)[0]->Reshape(M_, N_, 1, 1, 1);
+  // Compact activations are converted in the workspace: the bottom when the
+  // weights are compact too, and the top.
+  const bool expand_bottom = bottom[0]->compact() && this->blobs_.size() &&
+      this->blobs_[0]->compact();
+  this->ReserveWorkspace(((expand_bottom ? M_ * K_ : 0) +
+      ((*top)[0]->compact() ? M_ * N_ : 0)) * sizeof(Dtype));
   // Setting up the bias multiplier
-  if (bias_term_) {
+  if (bias_term_ && (!bias_multiplier_ ||
+      bias_multiplier_->size() != M_ * sizeof(Dtype))) {
     bias_multiplier_.reset(new SyncedMemory(M_ * sizeof(Dtype)));
     Dtype* bias_multiplier_data =
         reinterpret_cast<Dtype*>(bias_multiplier_->mutable_cpu_data());
@@ -57,19 +72,59 @@ void InnerProductLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   }
 }
 
+template <typename Dtype>
+bool InnerProductLayer<Dtype>::CompactWeights(const HalfFormat format) {
+  this->blobs_[0]->Compact(format);
+  return true;
+}
+
 template <typename Dtype>
 Dtype InnerProductLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     vector<Blob<Dtype>*>* top) {
-  const Dtype* bottom_data = bottom[0]->cpu_data();
-  Dtype* top_data = (*top)[0]->mutable_cpu_data();
-  const Dtype* weight = this->blobs_[0]->cpu_data();
-  caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, M_, N_, K_, (Dtype)1.,
-      bottom_data, weight, (Dtype)0., top_data);
+  const Blob<Dtype>& weight = *this->blobs_[0];
+  Blob<Dtype>* top_blob = (*top)[0];
+  const bool compact_bottom = bottom[0]->compact();
+  const bool compact_top = top_blob->compact();
+  // The gemm converts one compact operand as it loads it, so a compact
+  // bottom is expanded first only when the weights are compact as well.
+  const bool expand_bottom = compact_bottom && weight.compact();
+  Dtype* scratch = NULL;
+  if (expand_bottom || compact_top) {
+    scratch = static_cast<Dtype*>(this->workspace()->mutable_cpu_data(
+        ((expand_bottom ? M_ * K_ : 0) + (compact_top ? M_ * N_ : 0)) *
+        sizeof(Dtype)));
+  }
+  const Dtype* bottom_data = NULL;
+  if (expand_bottom) {
+    FromHalf(bottom[0]->compact_format(), M_ * K_,
+        bottom[0]->cpu_compact_data(), scratch);
+    bottom_data = scratch;
+  } else if (!compact_bottom) {
+    bottom_data = bottom[0]->cpu_data();
+  }
+  Dtype* top_data = compact_top ? scratch + (expand_bottom ? M_ * K_ : 0) :
+      top_blob->mutable_cpu_data();
+  if (compact_bottom && !expand_bottom) {
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, M_, N_, K_, (Dtype)1.,
+        bottom[0]->cpu_compact_data(), bottom[0]->compact_format(),
+        weight.cpu_data(), (Dtype)0., top_data);
+  } else if (weight.compact()) {
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, M_, N_, K_, (Dtype)1.,
+        bottom_data, weight.cpu_compact_data(), weight.compact_format(),
+        (Dtype)0., top_data);
+  } else {
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, M_, N_, K_, (Dtype)1.,
+        bottom_data, weight.cpu_data(), (Dtype)0., top_data);
+  }
   if (bias_term_) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, 1, (Dtype)1.,
         reinterpret_cast<const Dtype*>(bias_multiplier_->cpu_data()),
         this->blobs_[1]->cpu_data(), (Dtype)1., top_data);
   }
+  if (compact_top) {
+    ToHalf(top_blob->compact_format(), M_ * N_, top_data,
+        top_blob->mutable_cpu_compact_data());
+  }
   return Dtype(0);
 }
 
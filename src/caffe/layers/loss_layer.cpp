@@ -19,13 +19,19 @@ void LossLayer<Dtype>::SetUp(
     const vector<Blob<Dtype>*>& bottom, vector<Blob<Dtype>*>* top) {
   CHECK_EQ(bottom.size(), 2) << "Loss Layer takes two blobs as input.";
   CHECK_LE(top->size(), 1) << "Loss Layer takes no more than one output.";
+  FurtherSetUp(bottom, top);
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void LossLayer<Dtype>::Reshape(
+    const vector<Blob<Dtype>*>& bottom, vector<Blob<Dtype>*>* top) {
+  CHECK_EQ(bottom[0]->num(), bottom[1]->num())
+      << "The data and label should have the same number.";
   if (top->size() == 1) {
    // Layers should copy the loss in the top blob
    (*top)[0]->Reshape(1, 1, 1, 1, 1);
   }
-  CHECK_EQ(bottom[0]->num(), bottom[1]->num())
-      << "The data and label should have the same number.";
-  FurtherSetUp(bottom, top);
 }
 
 INSTANTIATE_CLASS(LossLayer);
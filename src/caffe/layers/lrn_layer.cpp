@@ -26,8 +26,6 @@ void LRNLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   beta_ = this->layer_param_.lrn_param().beta();
   switch (this->layer_param_.lrn_param().norm_region()) {
   case LRNParameter_NormRegion_ACROSS_CHANNELS:
-    (*top)[0]->Reshape(num_, channels_, length_, height_, width_);
-    scale_.Reshape(num_, channels_, length_, height_, width_);
     break;
   case LRNParameter_NormRegion_WITHIN_CHANNEL:
     {
@@ -101,6 +99,39 @@ void LRNLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   default:
     LOG(FATAL) << "Unknown normalization region.";
   }
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void LRNLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  num_ = bottom[0]->num();
+  channels_ = bottom[0]->channels();
+  length_ = bottom[0]->length();
+  height_ = bottom[0]->height();
+  width_ = bottom[0]->width();
+  switch (this->layer_param_.lrn_param().norm_region()) {
+  case LRNParameter_NormRegion_ACROSS_CHANNELS:
+    (*top)[0]->Reshape(num_, channels_, length_, height_, width_);
+    scale_.Reshape(num_, channels_, length_, height_, width_);
+    // The CPU passes take the padded channels and, in backward, the
+    // accumulated ratio and its product with the bottom from the workspace.
+    this->ReserveWorkspace((channels_ + size_ + 1) * length_ * height_ *
+        width_ * sizeof(Dtype));
+    break;
+  case LRNParameter_NormRegion_WITHIN_CHANNEL:
+    // Propagate the new shape through the sublayers in the order they run.
+    split_top_vec_[0] = bottom[0];
+    split_layer_->Reshape(bottom, &split_top_vec_);
+    square_layer_->Reshape(square_bottom_vec_, &square_top_vec_);
+    pool_layer_->Reshape(square_top_vec_, &pool_top_vec_);
+    power_layer_->Reshape(pool_top_vec_, &power_top_vec_);
+    product_bottom_vec_[0] = bottom[0];
+    product_layer_->Reshape(product_bottom_vec_, top);
+    break;
+  default:
+    LOG(FATAL) << "Unknown normalization region.";
+  }
 }
 
 template <typename Dtype>
@@ -127,20 +158,26 @@ Dtype LRNLayer<Dtype>::CrossChannelForward_cpu(
   for (int i = 0; i < scale_.count(); ++i) {
     scale_data[i] = 1.;
   }
-  Blob<Dtype> padded_square(1, channels_ + size_ - 1, length_, height_, width_);
-  Dtype* padded_square_data = padded_square.mutable_cpu_data();
-  memset(padded_square_data, 0, sizeof(Dtype) * padded_square.count());
+  // Only the padding channels need zeros: the others are overwritten with
+  // the squares of each volume below.
+  const int volume = length_ * height_ * width_;
+  Dtype* padded_square_data = static_cast<Dtype*>(
+      this->workspace()->mutable_cpu_data(
+          (channels_ + size_ - 1) * volume * sizeof(Dtype)));
+  memset(padded_square_data, 0, sizeof(Dtype) * pre_pad_ * volume);
+  memset(padded_square_data + (pre_pad_ + channels_) * volume, 0,
+      sizeof(Dtype) * (size_ - 1 - pre_pad_) * volume);
   Dtype alpha_over_size = alpha_ / size_;
   // go through the images
   for (int n = 0; n < num_; ++n) {
     // compute the padded square
     caffe_sqr(channels_ * length_ * height_ * width_,
         bottom_data + bottom[0]->offset(n),
-        padded_square_data + padded_square.offset(0, pre_pad_));
+        padded_square_data + pre_pad_ * volume);
     // Create the first channel scale
     for (int c = 0; c < size_; ++c) {
       caffe_axpy<Dtype>(length_ * height_ * width_, alpha_over_size,
-          padded_square_data + padded_square.offset(0, c),
+          padded_square_data + c * volume,
           scale_data + scale_.offset(n, 0));
     }
     for (int c = 1; c < channels_; ++c) {
@@ -150,11 +187,11 @@ Dtype LRNLayer<Dtype>::CrossChannelForward_cpu(
           scale_data + scale_.offset(n, c));
       // add head
       caffe_axpy<Dtype>(length_ * height_ * width_, alpha_over_size,
-          padded_square_data + padded_square.offset(0, c + size_ - 1),
+          padded_square_data + (c + size_ - 1) * volume,
           scale_data + scale_.offset(n, c));
       // subtract tail
       caffe_axpy<Dtype>(length_ * height_ * width_, -alpha_over_size,
-          padded_square_data + padded_square.offset(0, c - 1),
+          padded_square_data + (c - 1) * volume,
           scale_data + scale_.offset(n, c));
     }
   }
@@ -201,39 +238,43 @@ void LRNLayer<Dtype>::CrossChannelBackward_cpu(
   const Dtype* bottom_data = (*bottom)[0]->cpu_data();
   const Dtype* scale_data = scale_.cpu_data();
   Dtype* bottom_diff = (*bottom)[0]->mutable_cpu_diff();
-  Blob<Dtype> padded_ratio(1, channels_ + size_ - 1, length_, height_, width_);
-  Blob<Dtype> accum_ratio(1, 1, length_, height_, width_);
-  Dtype* padded_ratio_data = padded_ratio.mutable_cpu_data();
-  Dtype* accum_ratio_data = accum_ratio.mutable_cpu_data();
-  // We hack a little bit by using the diff() to store an additional result
-  Dtype* accum_ratio_times_bottom = accum_ratio.mutable_cpu_diff();
-  memset(padded_ratio_data, 0, sizeof(Dtype) * padded_ratio.count());
+  // inverse_pre_pad channels of zeros lead the padded ratios, and the rest
+  // of the padding trails them.
+  const int volume = length_ * height_ * width_;
+  int inverse_pre_pad = size_ - (size_ + 1) / 2;
+  Dtype* padded_ratio_data = static_cast<Dtype*>(
+      this->workspace()->mutable_cpu_data(
+          (channels_ + size_ + 1) * volume * sizeof(Dtype)));
+  Dtype* accum_ratio_data = padded_ratio_data + (channels_ + size_ - 1) * volume;
+  Dtype* accum_ratio_times_bottom = accum_ratio_data + volume;
+  memset(padded_ratio_data, 0, sizeof(Dtype) * inverse_pre_pad * volume);
+  memset(padded_ratio_data + (inverse_pre_pad + channels_) * volume, 0,
+      sizeof(Dtype) * (size_ - 1 - inverse_pre_pad) * volume);
   Dtype cache_ratio_value = 2. * alpha_ * beta_ / size_;
 
   caffe_powx<Dtype>(scale_.count(), scale_data, -beta_, bottom_diff);
   caffe_mul<Dtype>(scale_.count(), top_diff, bottom_diff, bottom_diff);
 
   // go through individual data
-  int inverse_pre_pad = size_ - (size_ + 1) / 2;
   for (int n = 0; n < num_; ++n) {
     int block_offset = scale_.offset(n);
     // first, compute diff_i * y_i / s_i
     caffe_mul<Dtype>(channels_ * length_ * height_ * width_,
         top_diff + block_offset, top_data + block_offset,
-        padded_ratio_data + padded_ratio.offset(0, inverse_pre_pad));
+        padded_ratio_data + inverse_pre_pad * volume);
     caffe_div<Dtype>(channels_ * length_ * height_ * width_,
-        padded_ratio_data + padded_ratio.offset(0, inverse_pre_pad),
+        padded_ratio_data + inverse_pre_pad * volume,
         scale_data + block_offset,
-        padded_ratio_data + padded_ratio.offset(0, inverse_pre_pad));
+        padded_ratio_data + inverse_pre_pad * volume);
     // Now, compute the accumulated ratios and the bottom diff
-    memset(accum_ratio_data, 0, sizeof(Dtype) * accum_ratio.count());
+    memset(accum_ratio_data, 0, sizeof(Dtype) * volume);
     for (int c = 0; c < size_ - 1; ++c) {
       caffe_axpy<Dtype>(length_ * height_ * width_, 1.,
-          padded_ratio_data + padded_ratio.offset(0, c), accum_ratio_data);
+          padded_ratio_data + c * volume, accum_ratio_data);
     }
     for (int c = 0; c < channels_; ++c) {
       caffe_axpy<Dtype>(length_ * height_ * width_, 1.,
-          padded_ratio_data + padded_ratio.offset(0, c + size_ - 1),
+          padded_ratio_data + (c + size_ - 1) * volume,
           accum_ratio_data);
       // compute bottom diff
       caffe_mul<Dtype>(length_ * height_ * width_,
@@ -242,7 +283,7 @@ void LRNLayer<Dtype>::CrossChannelBackward_cpu(
       caffe_axpy<Dtype>(length_ * height_ * width_, -cache_ratio_value,
           accum_ratio_times_bottom, bottom_diff + top[0]->offset(n, c));
       caffe_axpy<Dtype>(length_ * height_ * width_, -1.,
-          padded_ratio_data + padded_ratio.offset(0, c), accum_ratio_data);
+          padded_ratio_data + c * volume, accum_ratio_data);
     }
   }
 }
@@ -12,11 +12,16 @@ void NeuronLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top) {
   CHECK_EQ(bottom.size(), 1) << "Neuron Layer takes a single blob as input.";
   CHECK_EQ(top->size(), 1) << "Neuron Layer takes a single blob as output.";
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void NeuronLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
   // NeuronLayer allows in-place computations. If the computation is not
-  // in-place, we will need to initialize the top blob.
+  // in-place, we will need to shape the top blob like the bottom one.
   if ((*top)[0] != bottom[0]) {
-    (*top)[0]->Reshape(bottom[0]->num(), bottom[0]->channels(), 1,
-        bottom[0]->height(), bottom[0]->width());
+    (*top)[0]->ReshapeLike(*bottom[0]);
   }
 }
 
@@ -45,6 +45,12 @@ void Pooling3DLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
              PoolingParameter_PoolMethod_AVE)
         << "Padding implemented only for average pooling.";
   }
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void Pooling3DLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
   channels_ = bottom[0]->channels();
   length_ = bottom[0]->length();
   height_ = bottom[0]->height();
@@ -57,13 +63,6 @@ void Pooling3DLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
 	      length_ - kernel_depth_) / temporal_stride_)) + 1;
   (*top)[0]->Reshape(bottom[0]->num(), channels_, pooled_length_, pooled_height_,
       pooled_width_);
-
-  // If stochastic pooling, we will initialize the random index part.
-  if (this->layer_param_.pooling_param().pool() ==
-      PoolingParameter_PoolMethod_STOCHASTIC) {
-    rand_idx_.Reshape(bottom[0]->num(), channels_, pooled_length_, pooled_height_,
-      pooled_width_);
-  }
 }
 
 template <typename Dtype>
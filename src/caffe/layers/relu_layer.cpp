@@ -10,9 +10,40 @@ using std::max;
 
 namespace caffe {
 
+// Both 16-bit formats keep the sign in the top bit, so a compact ReLU just
+// zeroes the negative values.
+static void CompactReLU(const int count, const uint16_t* x, uint16_t* y) {
+  for (int i = 0; i < count; ++i) {
+    y[i] = (x[i] & 0x8000) ? 0 : x[i];
+  }
+}
+
 template <typename Dtype>
 Dtype ReLULayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     vector<Blob<Dtype>*>* top) {
+  Blob<Dtype>* top_blob = (*top)[0];
+  if (bottom[0]->compact() || top_blob->compact()) {
+    const int count = bottom[0]->count();
+    if (!top_blob->compact()) {
+      FromHalf(bottom[0]->compact_format(), count,
+          bottom[0]->cpu_compact_data(), top_blob->mutable_cpu_data());
+      Dtype* top_data = top_blob->mutable_cpu_data();
+      for (int i = 0; i < count; ++i) {
+        top_data[i] = max(top_data[i], Dtype(0));
+      }
+    } else if (!bottom[0]->compact()) {
+      uint16_t* top_compact = top_blob->mutable_cpu_compact_data();
+      ToHalf(top_blob->compact_format(), count, bottom[0]->cpu_data(),
+          top_compact);
+      CompactReLU(count, top_compact, top_compact);
+    } else {
+      CHECK_EQ(bottom[0]->compact_format(), top_blob->compact_format())
+          << "ReLU cannot change the compact format.";
+      CompactReLU(count, bottom[0]->cpu_compact_data(),
+          top_blob->mutable_cpu_compact_data());
+    }
+    return Dtype(0);
+  }
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = (*top)[0]->mutable_cpu_data();
   const int count = bottom[0]->count();
@@ -11,6 +11,12 @@ void ReshapeLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   CHECK_EQ(top->size(), 1) << "Reshape Layer takes a single blob as output.";
   CHECK_EQ(this->layer_param_.reshape_param().shape_size(), 5) 
   	<< "Reshape Layer takes 5-dimensional reshape.";
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void ReshapeLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+    vector<Blob<Dtype>*>* top) {
   vector<int> top_shape(5, 0);
   int dim_to_infer = -1;
   for (int i = 0; i < 5; i++) {
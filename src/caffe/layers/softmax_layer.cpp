@@ -16,16 +16,21 @@ void SoftmaxLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top) {
   CHECK_EQ(bottom.size(), 1) << "Softmax Layer takes a single blob as input.";
   CHECK_EQ(top->size(), 1) << "Softmax Layer takes a single blob as output.";
-  (*top)[0]->Reshape(bottom[0]->num(), bottom[0]->channels(), 1,
-      bottom[0]->height(), bottom[0]->width());
-  sum_multiplier_.Reshape(1, bottom[0]->channels(), 1,
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void SoftmaxLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  (*top)[0]->ReshapeLike(*bottom[0]);
+  sum_multiplier_.Reshape(1, bottom[0]->channels(), bottom[0]->length(),
       bottom[0]->height(), bottom[0]->width());
   Dtype* multiplier_data = sum_multiplier_.mutable_cpu_data();
   for (int i = 0; i < sum_multiplier_.count(); ++i) {
     multiplier_data[i] = 1.;
   }
-  scale_.Reshape(bottom[0]->num(), 1, 1, 1, 1);
-
+  // The per-row maxima, sums and dot products.
+  this->ReserveWorkspace(bottom[0]->num() * sizeof(Dtype));
 }
 
 template <typename Dtype>
@@ -33,8 +38,9 @@ Dtype SoftmaxLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     vector<Blob<Dtype>*>* top) {
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = (*top)[0]->mutable_cpu_data();
-  Dtype* scale_data = scale_.mutable_cpu_data();
   int num = bottom[0]->num();
+  Dtype* scale_data = static_cast<Dtype*>(
+      this->workspace()->mutable_cpu_data(num * sizeof(Dtype)));
   int dim = bottom[0]->count() / bottom[0]->num();
   memcpy(top_data, bottom_data, sizeof(Dtype) * bottom[0]->count());
   // we need to subtract the max to avoid numerical issues, compute the exp,
@@ -67,8 +73,9 @@ void SoftmaxLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
   const Dtype* top_diff = top[0]->cpu_diff();
   const Dtype* top_data = top[0]->cpu_data();
   Dtype* bottom_diff = (*bottom)[0]->mutable_cpu_diff();
-  Dtype* scale_data = scale_.mutable_cpu_data();
   int num = top[0]->num();
+  Dtype* scale_data = static_cast<Dtype*>(
+      this->workspace()->mutable_cpu_data(num * sizeof(Dtype)));
   int dim = top[0]->count() / top[0]->num();
   memcpy(bottom_diff, top_diff, sizeof(Dtype) * top[0]->count());
   // Compute inner1d(top_diff, top_data) and subtract them from the bottom diff
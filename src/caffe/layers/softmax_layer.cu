@@ -47,8 +47,9 @@ Dtype SoftmaxLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
     vector<Blob<Dtype>*>* top) {
   const Dtype* bottom_data = bottom[0]->gpu_data();
   Dtype* top_data = (*top)[0]->mutable_gpu_data();
-  Dtype* scale_data = scale_.mutable_gpu_data();
   int num = bottom[0]->num();
+  Dtype* scale_data = static_cast<Dtype*>(
+      this->workspace()->mutable_gpu_data(num * sizeof(Dtype)));
   int dim = bottom[0]->count() / bottom[0]->num();
   CUDA_CHECK(cudaMemcpy(top_data, bottom_data,
       sizeof(Dtype) * bottom[0]->count(), cudaMemcpyDeviceToDevice));
@@ -92,7 +93,8 @@ void SoftmaxLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top,
   // mode
   CUBLAS_CHECK(cublasSetPointerMode(Caffe::cublas_handle(),
       CUBLAS_POINTER_MODE_DEVICE));
-  Dtype* scale_data = scale_.mutable_gpu_data();
+  Dtype* scale_data = static_cast<Dtype*>(
+      this->workspace()->mutable_gpu_data(num * sizeof(Dtype)));
   for (int i = 0; i < num; ++i) {
     caffe_gpu_dot<Dtype>(dim, top_diff + i * dim,
         top_data + i * dim, scale_data + i);
@@ -101,7 +103,7 @@ void SoftmaxLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top,
       CUBLAS_POINTER_MODE_HOST));
   // subtraction
   caffe_gpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, num, dim, 1, -1.,
-      scale_.gpu_data(), sum_multiplier_.gpu_data(), 1., bottom_diff);
+      scale_data, sum_multiplier_.gpu_data(), 1., bottom_diff);
   // elementwise multiplication
   caffe_gpu_mul<Dtype>(top[0]->count(), bottom_diff, top_data, bottom_diff);
 }
@@ -2,41 +2,141 @@
 
 #include <algorithm>
 #include <cfloat>
+#include <cmath>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "caffe/layer.hpp"
 #include "caffe/vision_layers.hpp"
 #include "caffe/util/math_functions.hpp"
 
 using std::max;
+using std::min;
 
 namespace caffe {
 
+// Returns the sum of exp(x[j] - shift) over the n elements of a row, and
+// writes the terms to y unless it is NULL.
+template <typename Dtype>
+static inline Dtype ExpRowSum(const Dtype* x, const int n, const Dtype shift,
+    Dtype* y) {
+  Dtype sum = 0;
+  for (int j = 0; j < n; ++j) {
+    const Dtype e = exp(x[j] - shift);
+    if (y) {
+      y[j] = e;
+    }
+    sum += e;
+  }
+  return sum;
+}
+
+#if defined(__SSE2__)
+// exp of four floats with the range reduction and polynomial of the Cephes
+// expf, within 2 ulp of expf. The arguments here are at most 0; those below
+// -87 are taken as -87, where exp is still a normal float near FLT_MIN.
+static inline __m128 Exp4(__m128 x) {
+  x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.f)), _mm_set1_ps(88.f));
+  // n = floor(x * log2(e) + 0.5), so that |x - n * ln(2)| <= ln(2) / 2.
+  const __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)),
+      _mm_set1_ps(0.5f));
+  __m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+  n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, fx), _mm_set1_ps(1.f)));
+  // ln(2) in two parts, so that x - n * ln(2) is exact.
+  x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(-2.12194440e-4f)));
+  __m128 y = _mm_set1_ps(1.9875691500e-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+  y = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, x), x),
+      _mm_add_ps(x, _mm_set1_ps(1.f)));
+  // Times 2^n, built in the exponent bits.
+  const __m128i pow2n = _mm_slli_epi32(
+      _mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(pow2n));
+}
+
+template <>
+inline float ExpRowSum<float>(const float* x, const int n, const float shift,
+    float* y) {
+  const __m128 shift4 = _mm_set1_ps(shift);
+  __m128 sum4 = _mm_setzero_ps();
+  int j = 0;
+  for (; j + 4 <= n; j += 4) {
+    const __m128 e = Exp4(_mm_sub_ps(_mm_loadu_ps(x + j), shift4));
+    if (y) {
+      _mm_storeu_ps(y + j, e);
+    }
+    sum4 = _mm_add_ps(sum4, e);
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, sum4);
+  float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; j < n; ++j) {
+    const float e = exp(x[j] - shift);
+    if (y) {
+      y[j] = e;
+    }
+    sum += e;
+  }
+  return sum;
+}
+#endif
+
 template <typename Dtype>
 void SoftmaxWithLossLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
       vector<Blob<Dtype>*>* top) {
   CHECK_EQ(bottom.size(), 2) << "SoftmaxLoss Layer takes two blobs as input.";
   CHECK_EQ(top->size(), 0) << "SoftmaxLoss Layer takes no blob as output.";
-  softmax_bottom_vec_.clear();
-  softmax_bottom_vec_.push_back(bottom[0]);
-  softmax_top_vec_.push_back(&prob_);
-  softmax_layer_->SetUp(softmax_bottom_vec_, &softmax_top_vec_);
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void SoftmaxWithLossLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  CHECK_EQ(bottom[0]->num(), bottom[1]->num())
+      << "The data and label should have the same number.";
+  log_norm_.Reshape(bottom[0]->num(), 1, 1, 1, 1);
 }
 
 template <typename Dtype>
 Dtype SoftmaxWithLossLayer<Dtype>::Forward_cpu(
     const vector<Blob<Dtype>*>& bottom, vector<Blob<Dtype>*>* top) {
-  // The forward pass computes the softmax prob values.
-  softmax_bottom_vec_[0] = bottom[0];
-  softmax_layer_->Forward(softmax_bottom_vec_, &softmax_top_vec_);
-  const Dtype* prob_data = prob_.cpu_data();
+  const Dtype* bottom_data = bottom[0]->cpu_data();
   const Dtype* label = bottom[1]->cpu_data();
-  int num = prob_.num();
-  int dim = prob_.count() / num;
+  Dtype* log_norm = log_norm_.mutable_cpu_data();
+  const int num = bottom[0]->num();
+  const int dim = bottom[0]->count() / num;
+  // The gradient is only needed in training; test nets leave the diff alone.
+  diff_ready_ = (Caffe::phase() == Caffe::TRAIN);
+  Dtype* bottom_diff = diff_ready_ ? bottom[0]->mutable_cpu_diff() : NULL;
+  // The loss of a row, -log(prob[label]), is log_norm - x[label]. It is
+  // capped where prob[label] would fall below FLT_MIN, as before.
+  const Dtype max_loss = -log(Dtype(FLT_MIN));
   Dtype loss = 0;
   for (int i = 0; i < num; ++i) {
-    loss += -log(max(prob_data[i * dim + static_cast<int>(label[i])],
-                     Dtype(FLT_MIN)));
+    const Dtype* x = bottom_data + i * dim;
+    // Subtracting the max keeps every exp in (0, 1].
+    Dtype x_max = x[0];
+    for (int j = 1; j < dim; ++j) {
+      x_max = max(x_max, x[j]);
+    }
+    // exp(x - max) goes to the diff on the way, which one more pass over the
+    // row, still in cache, turns into the gradient.
+    Dtype* diff = bottom_diff ? bottom_diff + i * dim : NULL;
+    const Dtype sum = ExpRowSum(x, dim, x_max, diff);
+    if (diff) {
+      caffe_scal(dim, Dtype(1) / (sum * num), diff);
+      diff[static_cast<int>(label[i])] -= Dtype(1) / num;
+    }
+    log_norm[i] = x_max + log(sum);
+    loss += min(log_norm[i] - x[static_cast<int>(label[i])], max_loss);
   }
   return loss / num;
 }
@@ -45,21 +145,25 @@ template <typename Dtype>
 void SoftmaxWithLossLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     const bool propagate_down,
     vector<Blob<Dtype>*>* bottom) {
-  // Compute the diff
+  if (diff_ready_) {
+    return;
+  }
+  const Dtype* bottom_data = (*bottom)[0]->cpu_data();
   Dtype* bottom_diff = (*bottom)[0]->mutable_cpu_diff();
-  const Dtype* prob_data = prob_.cpu_data();
-  memcpy(bottom_diff, prob_data, sizeof(Dtype) * prob_.count());
   const Dtype* label = (*bottom)[1]->cpu_data();
-  int num = prob_.num();
-  int dim = prob_.count() / num;
+  const Dtype* log_norm = log_norm_.cpu_data();
+  const int num = (*bottom)[0]->num();
+  const int dim = (*bottom)[0]->count() / num;
+  // prob / num is exp(x - log_norm - log(num)).
+  const Dtype log_num = log(Dtype(num));
   for (int i = 0; i < num; ++i) {
-    bottom_diff[i * dim + static_cast<int>(label[i])] -= 1;
+    const Dtype* x = bottom_data + i * dim;
+    Dtype* diff = bottom_diff + i * dim;
+    ExpRowSum(x, dim, log_norm[i] + log_num, diff);
+    diff[static_cast<int>(label[i])] -= Dtype(1) / num;
   }
-  // Scale down gradient
-  caffe_scal(prob_.count(), Dtype(1) / num, bottom_diff);
 }
 
-
 INSTANTIATE_CLASS(SoftmaxWithLossLayer);
 
 
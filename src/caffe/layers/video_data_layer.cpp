@@ -19,7 +19,9 @@
 #include <stdint.h>
 #include <pthread.h>
 
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 #include <iostream>
 #include <fstream>
@@ -33,6 +35,7 @@
 
 
 #include "caffe/layer.hpp"
+#include "caffe/util/data_transform.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/image_io.hpp"
 #include "caffe/util/math_functions.hpp"
@@ -43,7 +46,50 @@ using std::string;
 
 namespace caffe {
 
-const int seg_cnt = 4;
+// Decodes the clips segment_frames of one video straight into their slots of
+// the prefetch batch, which start at top_data and are top_size apart. Each
+// distinct frame is decoded once, and every clip position that uses it is
+// cropped at (h_offs[k], w_offs[k]), mirrored if mirrors[k], and mean
+// subtracted from the decoded rows, so no VolumeDatum is staged in between.
+template <typename Dtype>
+static bool ReadImageSegmentsToBatch(const char* img_dir,
+    const std::vector<std::vector<int> >& segment_frames, const int new_height,
+    const int new_width, const bool reduced_decode, const Dtype* mean,
+    const int channels, const int height, const int width, const int crop_size,
+    const std::vector<int>& h_offs, const std::vector<int>& w_offs,
+    const std::vector<bool>& mirrors, const Dtype scale, const int top_size,
+    Dtype* top_data) {
+  const int length = segment_frames[0].size();
+  // (frame, clip position) pairs, in decoding order.
+  std::vector<std::pair<int, int> > uses;
+  for (int k = 0; k < segment_frames.size(); ++k) {
+    CHECK_EQ(segment_frames[k].size(), length);
+    for (int l = 0; l < length; ++l) {
+      uses.push_back(std::make_pair(segment_frames[k][l], k * length + l));
+    }
+  }
+  std::sort(uses.begin(), uses.end());
+  char fn_im[256];
+  cv::Mat img;
+  for (int i = 0; i < uses.size(); ++i) {
+    if (i == 0 || uses[i].first != uses[i - 1].first) {
+      sprintf(fn_im, "%s/%06d.jpg", img_dir, uses[i].first);
+      if (!ReadImageFrame(fn_im, new_height, new_width, reduced_decode, &img)) {
+        LOG(ERROR) << "Could not open or find file " << fn_im;
+        return false;
+      }
+      CHECK_EQ(img.channels(), channels);
+      CHECK_EQ(img.rows, height) << "Frame size differs in " << fn_im;
+      CHECK_EQ(img.cols, width) << "Frame size differs in " << fn_im;
+    }
+    const int k = uses[i].second / length;
+    const int l = uses[i].second % length;
+    TransformInterleavedFrame(img.ptr<uchar>(0), static_cast<int>(img.step),
+        mean, channels, length, l, height, width, crop_size, h_offs[k],
+        w_offs[k], mirrors[k], scale, top_data + k * top_size);
+  }
+  return true;
+}
 
 template <typename Dtype>
 void* VideoDataLayerPrefetch(void* layer_pointer) {
@@ -69,6 +115,7 @@ void* VideoDataLayerPrefetch(void* layer_pointer) {
   const int sampling_rate = layer->layer_param_.image_data_param().sampling_rate();
   const bool use_temporal_jitter = layer->layer_param_.image_data_param().use_temporal_jitter();
   const bool use_pyramid_input = layer->layer_param_.image_data_param().use_pyramid_input();
+  const bool reduced_decode = layer->layer_param_.image_data_param().reduced_decode();
 
   if (mirror && crop_size == 0) {
     LOG(FATAL) << "Current implementation requires mirror and crop_size to be "
@@ -82,153 +129,142 @@ void* VideoDataLayerPrefetch(void* layer_pointer) {
   const int size = layer->datum_size_;
   const int chunks_size = layer->shuffle_index_.size();
   const Dtype* mean = layer->data_mean_.cpu_data();
+  const int top_size =
+      crop_size ? channels * length * crop_size * crop_size : size;
   const int show_data = layer->layer_param_.image_data_param().show_data();
   char *data_buffer;
   if (show_data)
 	  data_buffer = new char[size];
-  for (int item_id = 0; item_id < batch_size*seg_cnt; ++item_id) {
-    // get a blob
-	int seg_id = item_id % seg_cnt;
+  const int num_segments = layer->num_segments_;
+  // Frames are written from the decoder straight into the batch unless they
+  // are also shown, which needs the raw bytes of the clip.
+  const bool direct_decode = use_image && !show_data;
+  // The clips of every segment of a video, planned and decoded together so
+  // that frames shared by several segments are decoded once.
+  std::vector<std::vector<int> > segment_frames;
+  std::vector<VolumeDatum> segment_datums;
+  std::vector<int> h_offs(num_segments, 0);
+  std::vector<int> w_offs(num_segments, 0);
+  std::vector<bool> mirrors(num_segments, false);
+  for (int video_id = 0; video_id < batch_size; ++video_id) {
     CHECK_GT(chunks_size, layer->lines_id_);
-    bool read_status;
+    bool read_status = true;
     int id = layer->shuffle_index_[layer->lines_id_];
-    if (!use_image){
-		read_status = ReadVideoToVolumeDatum(layer->file_list_[id].c_str(), layer->frm_list_[id],
-				layer->label_list_[id], new_length, new_height, new_width, sampling_rate, &datum);
-	}
-    else {
-		read_status = ReadImageSequenceToVolumeDatum(layer->file_list_[id].c_str(), layer->frm_list_[id],
-				layer->label_list_[id], new_length, new_height, new_width, seg_id, use_temporal_jitter, &datum);
+    // The crops are chosen before decoding: every clip has the datum shape
+    // known since SetUp.
+    if (crop_size) {
+      for (int seg_id = 0; seg_id < num_segments; ++seg_id) {
+        // We only do random crop when we do training.
+        if (layer->phase_ == Caffe::TRAIN) {
+          h_offs[seg_id] = layer->PrefetchRand() % (height - crop_size);
+          w_offs[seg_id] = layer->PrefetchRand() % (width - crop_size);
+        } else {
+          h_offs[seg_id] = (height - crop_size) / 2;
+          w_offs[seg_id] = (width - crop_size) / 2;
+        }
+        mirrors[seg_id] = mirror && layer->PrefetchRand() % 2;
+      }
     }
-
-    if (layer->phase_ == Caffe::TEST){
-    	CHECK(read_status) << "Testing must not miss any example";
+    if (use_image) {
+      PlanImageSequenceSegments(layer->frm_list_[id], new_length, num_segments,
+          use_temporal_jitter, &segment_frames);
     }
-
-    if (!read_status) {
-    	//LOG(ERROR) << "cannot read " << layer->file_list_[id];
-        layer->lines_id_++;
-        if (layer->lines_id_ >= chunks_size) {
-          // We have reached the end. Restart from the first.
-          DLOG(INFO) << "Restarting data prefetching from start.";
-          layer->lines_id_ = 0;
-          if (layer->layer_param_.image_data_param().shuffle()){
-        	  std::random_shuffle(layer->shuffle_index_.begin(), layer->shuffle_index_.end());
+    if (direct_decode) {
+      read_status = ReadImageSegmentsToBatch(layer->file_list_[id].c_str(),
+          segment_frames, new_height, new_width, reduced_decode, mean,
+          channels, height, width, crop_size, h_offs, w_offs, mirrors, scale,
+          top_size, top_data + video_id * num_segments * top_size);
+      if (read_status && layer->output_labels_) {
+        const Dtype label = layer->label_list_[id];
+        if (use_pyramid_input) {
+          top_label[video_id] = label;
+        } else {
+          for (int seg_id = 0; seg_id < num_segments; ++seg_id) {
+            top_label[video_id * num_segments + seg_id] = label;
           }
         }
-        item_id--;
-        continue;
-    }
-    //LOG(INFO) << "--> " << item_id;
-    //LOG(INFO) << "label " << datum.label();
-    const string& data = datum.data();
-    if (crop_size) {
-      CHECK(data.size()) << "Image cropping only support uint8 data";
-      int h_off, w_off;
-      // We only do random crop when we do training.
-      if (layer->phase_ == Caffe::TRAIN) {
-        h_off = layer->PrefetchRand() % (height - crop_size);
-        w_off = layer->PrefetchRand() % (width - crop_size);
-      } else {
-        h_off = (height - crop_size) / 2;
-        w_off = (width - crop_size) / 2;
       }
-      if (mirror && layer->PrefetchRand() % 2) {
-        // Copy mirrored version
-        for (int c = 0; c < channels; ++c) {
-          for (int l = 0; l < length; ++l) {
-            for (int h = 0; h < crop_size; ++h) {
-              for (int w = 0; w < crop_size; ++w) {
-                int top_index = (((item_id * channels + c) * length + l) * crop_size + h)
-                              * crop_size + (crop_size - 1 - w);
-                int data_index = ((c * length + l) * height + h + h_off) * width + w + w_off;
-                Dtype datum_element =
-                  static_cast<Dtype>(static_cast<uint8_t>(data[data_index]));
-                top_data[top_index] = (datum_element - mean[data_index]) * scale;
-                if (show_data)
-                	data_buffer[((c * length + l) * crop_size + h)
-                                * crop_size + (crop_size - 1 - w)] = static_cast<uint8_t>(data[data_index]);
-              }
-            }
-          }
-        }
-      } else {
-        // Normal copy
-        for (int c = 0; c < channels; ++c) {
-          for (int l = 0; l < length; ++l) {
-            for (int h = 0; h < crop_size; ++h) {
-              for (int w = 0; w < crop_size; ++w) {
-                int top_index = (((item_id * channels + c) * length + l) * crop_size + h)
-                              * crop_size + w;
-                int data_index = ((c * length + l) * height + h + h_off) * width + w + w_off;
-                Dtype datum_element =
-                  static_cast<Dtype>(static_cast<uint8_t>(data[data_index]));
-                top_data[top_index] = (datum_element - mean[data_index]) * scale;
-                if (show_data)
-                	data_buffer[((c * length + l) * crop_size + h)
-                                * crop_size + w] = static_cast<uint8_t>(data[data_index]);
-              }
-            }
-          }
+    } else if (use_image) {
+      read_status = ReadImageSegmentsToVolumeData(
+          layer->file_list_[id].c_str(), segment_frames,
+          layer->label_list_[id], new_height, new_width, &segment_datums,
+          reduced_decode);
+    }
+    for (int seg_id = 0; seg_id < num_segments && read_status &&
+         !direct_decode; ++seg_id) {
+      const int item_id = video_id * num_segments + seg_id;
+      if (!use_image) {
+        read_status = ReadVideoToVolumeDatum(layer->file_list_[id].c_str(),
+            layer->frm_list_[id], layer->label_list_[id], new_length,
+            new_height, new_width, sampling_rate, &datum);
+        if (!read_status) {
+          break;
         }
       }
-    } else {
+      const VolumeDatum& clip = use_image ? segment_datums[seg_id] : datum;
+      const string& data = clip.data();
+      const int h_off = h_offs[seg_id];
+      const int w_off = w_offs[seg_id];
+      const bool do_mirror = mirrors[seg_id];
+      if (crop_size) {
+        CHECK(data.size()) << "Image cropping only support uint8 data";
+      }
       // we will prefer to use data() first, and then try float_data()
       if (data.size()) {
-        for (int j = 0; j < size; ++j) {
-          Dtype datum_element =
-              static_cast<Dtype>(static_cast<uint8_t>(data[j]));
-          top_data[item_id * size + j] = (datum_element - mean[j]) * scale;
-          if (show_data)
-        	  data_buffer[j] = static_cast<uint8_t>(data[j]);
-        }
+        TransformVolumeData(reinterpret_cast<const uint8_t*>(data.data()),
+            mean, channels, length, height, width, crop_size, h_off, w_off,
+            do_mirror, scale, top_data + item_id * top_size,
+            show_data ? data_buffer : NULL);
       } else {
-        for (int j = 0; j < size; ++j) {
-          top_data[item_id * size + j] =
-              (datum.float_data(j) - mean[j]) * scale;
+        TransformFloatData(clip.float_data().data(), mean, size, scale,
+            top_data + item_id * size);
+      }
+
+      if (show_data > 0) {
+        int image_size, channel_size;
+        if (crop_size) {
+          image_size = crop_size * crop_size;
+        } else {
+          image_size = height * width;
         }
+        channel_size = length * image_size;
+        for (int l = 0; l < length; ++l) {
+          for (int c = 0; c < channels; ++c) {
+            cv::Mat img;
+            char ch_name[64];
+            if (crop_size)
+              BufferToGrayImage(data_buffer + c * channel_size + l * image_size, crop_size, crop_size, &img);
+            else
+              BufferToGrayImage(data_buffer + c * channel_size + l * image_size, height, width, &img);
+            sprintf(ch_name, "Channel %d", c);
+            cv::namedWindow(ch_name, CV_WINDOW_AUTOSIZE);
+            cv::imshow( ch_name, img);
+          }
+          cv::waitKey(100);
+        }
+      }
+      if (layer->output_labels_) {
+        if (use_pyramid_input)
+          top_label[video_id] = clip.label();
+        else
+          top_label[item_id] = clip.label();
       }
     }
 
-    if (show_data>0){
-    	int image_size, channel_size;
-    	if (crop_size){
-    		image_size = crop_size * crop_size;
-    	}else{
-    		image_size = height * width;
-    	}
-    	channel_size = length * image_size;
-    	for (int l = 0; l < length; ++l) {
-    		for (int c = 0; c < channels; ++c) {
-    			cv::Mat img;
-    			char ch_name[64];
-    			if (crop_size)
-    				BufferToGrayImage(data_buffer + c * channel_size + l * image_size, crop_size, crop_size, &img);
-    			else
-    				BufferToGrayImage(data_buffer + c * channel_size + l * image_size, height, width, &img);
-    			sprintf(ch_name, "Channel %d", c);
-    			cv::namedWindow(ch_name, CV_WINDOW_AUTOSIZE);
-    			cv::imshow( ch_name, img);
-    		}
-    		cv::waitKey(100);
-    	}
+    if (layer->phase_ == Caffe::TEST){
+      CHECK(read_status) << "Testing must not miss any example";
     }
-    if (layer->output_labels_) {
-		if (use_pyramid_input)
-			top_label[item_id/seg_cnt] = datum.label();
-		else
-			top_label[item_id] = datum.label();
-		// LOG(INFO) << "fetching label" << datum.label() << std::endl;
+    if (!read_status) {
+      // Fill this slot again from the next video.
+      video_id--;
     }
-
-	if ((item_id+1)%seg_cnt == 0)
-    	layer->lines_id_++;
+    layer->lines_id_++;
     if (layer->lines_id_ >= chunks_size) {
       // We have reached the end. Restart from the first.
       DLOG(INFO) << "Restarting data prefetching from start.";
       layer->lines_id_ = 0;
       if (layer->layer_param_.image_data_param().shuffle()){
-    	  std::random_shuffle(layer->shuffle_index_.begin(), layer->shuffle_index_.end());
+        std::random_shuffle(layer->shuffle_index_.begin(), layer->shuffle_index_.end());
       }
     }
   }
@@ -267,13 +303,24 @@ void VideoDataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   const bool use_temporal_jitter = this->layer_param_.image_data_param().use_temporal_jitter();
   const bool use_pyramid_input = this->layer_param_.image_data_param().use_pyramid_input();
   const bool use_image = this->layer_param_.image_data_param().use_image();
+  num_segments_ = this->layer_param_.image_data_param().num_segments();
+  CHECK_GE(num_segments_, 1) << "num_segments must be positive";
   LOG(INFO) << "Opening file " << source;
   std::ifstream infile(source.c_str());
+  const int num_shards = this->layer_param_.image_data_param().num_shards();
+  const int shard_id = this->layer_param_.image_data_param().shard_id();
+  CHECK_GE(num_shards, 1);
+  CHECK_LT(shard_id, num_shards);
   int count = 0;
+  int line_id = 0;
   string filename;
   int frm, label;
 
   while (infile >> filename >> frm >> label) {
+	  // Keep only the lines of this layer's shard.
+	  if (line_id++ % num_shards != shard_id) {
+		  continue;
+	  }
 	  file_list_.push_back(filename);
 	  frm_list_.push_back(frm);
 	  label_list_.push_back(label);
@@ -313,24 +360,29 @@ void VideoDataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   }
   else{
 	  LOG(INFO) << "read video from " << file_list_[id].c_str();
-	  CHECK(ReadImageSequenceToVolumeDatum(file_list_[id].c_str(), frm_list_[id], label_list_[id],
-	                             new_length, new_height, new_width, 3, use_temporal_jitter, &datum));
+	  // The clip of the whole video, the last segment.
+	  std::vector<std::vector<int> > segment_frames;
+	  PlanImageSequenceSegments(frm_list_[id], new_length, num_segments_,
+			  use_temporal_jitter, &segment_frames);
+	  CHECK(ReadImageFramesToVolumeDatum(file_list_[id].c_str(), segment_frames.back(),
+			  label_list_[id], new_height, new_width, &datum,
+			  this->layer_param_.image_data_param().reduced_decode()));
   }
 
   // image
   int crop_size = this->layer_param_.image_data_param().crop_size();
   if (crop_size > 0) {
-    (*top)[0]->Reshape(this->layer_param_.image_data_param().batch_size()*seg_cnt,
+    (*top)[0]->Reshape(this->layer_param_.image_data_param().batch_size()*num_segments_,
                        datum.channels(), datum.length(), crop_size, crop_size);
     prefetch_data_.reset(new Blob<Dtype>(
-        this->layer_param_.image_data_param().batch_size()*seg_cnt, datum.channels(), datum.length(),
+        this->layer_param_.image_data_param().batch_size()*num_segments_, datum.channels(), datum.length(),
         crop_size, crop_size));
   } else {
     (*top)[0]->Reshape(
-        this->layer_param_.image_data_param().batch_size()*seg_cnt, datum.channels(), datum.length(),
+        this->layer_param_.image_data_param().batch_size()*num_segments_, datum.channels(), datum.length(),
         datum.height(), datum.width());
     prefetch_data_.reset(new Blob<Dtype>(
-        this->layer_param_.image_data_param().batch_size()*seg_cnt, datum.channels(), datum.length(),
+        this->layer_param_.image_data_param().batch_size()*num_segments_, datum.channels(), datum.length(),
         datum.height(), datum.width()));
   }
   LOG(INFO) << "output data size: " << (*top)[0]->num() << ","
@@ -343,9 +395,9 @@ void VideoDataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
 		prefetch_label_.reset(
 				new Blob<Dtype>(this->layer_param_.image_data_param().batch_size(), 1, 1, 1, 1));
 	} else {
-		(*top)[1]->Reshape(this->layer_param_.image_data_param().batch_size()*seg_cnt, 1, 1, 1, 1);
+		(*top)[1]->Reshape(this->layer_param_.image_data_param().batch_size()*num_segments_, 1, 1, 1, 1);
 		prefetch_label_.reset(
-				new Blob<Dtype>(this->layer_param_.image_data_param().batch_size()*seg_cnt, 1, 1, 1, 1));
+				new Blob<Dtype>(this->layer_param_.image_data_param().batch_size()*num_segments_, 1, 1, 1, 1));
 	}
   }
 
@@ -392,6 +444,16 @@ void VideoDataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   DLOG(INFO) << "Initializing prefetch";
   CreatePrefetchThread();
   DLOG(INFO) << "Prefetch initialized.";
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void VideoDataLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  (*top)[0]->ReshapeLike(*prefetch_data_);
+  if (output_labels_) {
+    (*top)[1]->ReshapeLike(*prefetch_label_);
+  }
 }
 
 template <typename Dtype>
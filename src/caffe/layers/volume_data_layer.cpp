@@ -18,7 +18,6 @@
 
 
 #include <stdint.h>
-#include <leveldb/db.h>
 #include <pthread.h>
 
 #include <string>
@@ -31,6 +30,9 @@
 
 
 #include "caffe/layer.hpp"
+#include "caffe/util/data_transform.hpp"
+#include "caffe/util/db.hpp"
+#include "caffe/util/datum_view.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/image_io.hpp"
 #include "caffe/util/math_functions.hpp"
@@ -42,26 +44,29 @@ using std::string;
 namespace caffe {
 
 template <typename Dtype>
-void* VolumeDataLayerPrefetch(void* layer_pointer) {
-  CHECK(layer_pointer);
-  VolumeDataLayer<Dtype>* layer = static_cast<VolumeDataLayer<Dtype>*>(layer_pointer);
-  CHECK(layer);
-  VolumeDatum datum;
-  CHECK(layer->prefetch_data_);
-  Dtype* top_data = layer->prefetch_data_->mutable_cpu_data();
+struct VolumeReaderArgs {
+  VolumeDataLayer<Dtype>* layer;
+  int reader_id;
+  Dtype* top_data;
   Dtype* top_label;
-  if (layer->output_labels_) {
-    top_label = layer->prefetch_label_->mutable_cpu_data();
-  }
+  // The crop offsets and mirroring of each item of the batch.
+  const vector<int>* h_off;
+  const vector<int>* w_off;
+  const vector<int>* do_mirror;
+};
+
+// Fills the items reader_id, reader_id + num_readers, ... of the batch being
+// prefetched, reading them with the reader's own cursor.
+template <typename Dtype>
+void* VolumeDataLayerRead(void* args_pointer) {
+  const VolumeReaderArgs<Dtype>& args =
+      *static_cast<VolumeReaderArgs<Dtype>*>(args_pointer);
+  VolumeDataLayer<Dtype>* layer = args.layer;
+  DatabaseCursor* cursor = layer->cursors_[args.reader_id].get();
+  const int num_readers = layer->cursors_.size();
   const Dtype scale = layer->layer_param_.data_param().scale();
   const int batch_size = layer->layer_param_.data_param().batch_size();
   const int crop_size = layer->layer_param_.data_param().crop_size();
-  const bool mirror = layer->layer_param_.data_param().mirror();
-
-  if (mirror && crop_size == 0) {
-    LOG(FATAL) << "Current implementation requires mirror and crop_size to be "
-        << "set at the same time.";
-  }
   // datum scales
   const int channels = layer->datum_channels_;
   const int length = layer->datum_length_;
@@ -69,82 +74,32 @@ void* VolumeDataLayerPrefetch(void* layer_pointer) {
   const int width = layer->datum_width_;
   const int size = layer->datum_size_;
   const Dtype* mean = layer->data_mean_.cpu_data();
+  const int top_size =
+      crop_size ? channels * length * crop_size * crop_size : size;
   const int show_data = layer->layer_param_.data_param().show_data();
   char *data_buffer;
   if (show_data)
 	  data_buffer = new char[size];
-  for (int item_id = 0; item_id < batch_size; ++item_id) {
+  DatumView datum;
+  for (int item_id = args.reader_id; item_id < batch_size;
+       item_id += num_readers) {
     // get a blob
-    CHECK(layer->iter_);
-    CHECK(layer->iter_->Valid());
-    datum.ParseFromString(layer->iter_->value().ToString());
-    const string& data = datum.data();
+    cursor->SeekTo(layer->next_record_ + item_id);
+    CHECK(datum.ParseVolumeDatum(cursor->value(), cursor->value_size()))
+        << "Failed to parse the datum at " << cursor->key();
     if (crop_size) {
-      CHECK(data.size()) << "Image cropping only support uint8 data";
-      int h_off, w_off;
-      // We only do random crop when we do training.
-      if (layer->phase_ == Caffe::TRAIN) {
-        h_off = layer->PrefetchRand() % (height - crop_size);
-        w_off = layer->PrefetchRand() % (width - crop_size);
-      } else {
-        h_off = (height - crop_size) / 2;
-        w_off = (width - crop_size) / 2;
-      }
-      if (mirror && layer->PrefetchRand() % 2) {
-        // Copy mirrored version
-        for (int c = 0; c < channels; ++c) {
-          for (int l = 0; l < length; ++l) {
-            for (int h = 0; h < crop_size; ++h) {
-              for (int w = 0; w < crop_size; ++w) {
-                int top_index = (((item_id * channels + c) * length + l) * crop_size + h)
-                              * crop_size + (crop_size - 1 - w);
-                int data_index = ((c * length + l) * height + h + h_off) * width + w + w_off;
-                Dtype datum_element =
-                  static_cast<Dtype>(static_cast<uint8_t>(data[data_index]));
-                top_data[top_index] = (datum_element - mean[data_index]) * scale;
-                if (show_data)
-                	data_buffer[((c * length + l) * crop_size + h)
-                                * crop_size + (crop_size - 1 - w)] = static_cast<uint8_t>(data[data_index]);
-              }
-            }
-          }
-        }
-      } else {
-        // Normal copy
-        for (int c = 0; c < channels; ++c) {
-          for (int l = 0; l < length; ++l) {
-            for (int h = 0; h < crop_size; ++h) {
-              for (int w = 0; w < crop_size; ++w) {
-                int top_index = (((item_id * channels + c) * length + l) * crop_size + h)
-                              * crop_size + w;
-                int data_index = ((c * length + l) * height + h + h_off) * width + w + w_off;
-                Dtype datum_element =
-                  static_cast<Dtype>(static_cast<uint8_t>(data[data_index]));
-                top_data[top_index] = (datum_element - mean[data_index]) * scale;
-                if (show_data)
-                	data_buffer[((c * length + l) * crop_size + h)
-                                * crop_size + w] = static_cast<uint8_t>(data[data_index]);
-              }
-            }
-          }
-        }
-      }
+      CHECK(datum.data_size()) << "Image cropping only support uint8 data";
+    }
+    // we will prefer to use data() first, and then try float_data()
+    if (datum.data_size()) {
+      TransformVolumeData(datum.data(), mean, channels, length, height, width,
+          crop_size, (*args.h_off)[item_id], (*args.w_off)[item_id],
+          (*args.do_mirror)[item_id], scale,
+          args.top_data + item_id * top_size,
+          show_data ? data_buffer : NULL);
     } else {
-      // we will prefer to use data() first, and then try float_data()
-      if (data.size()) {
-        for (int j = 0; j < size; ++j) {
-          Dtype datum_element =
-              static_cast<Dtype>(static_cast<uint8_t>(data[j]));
-          top_data[item_id * size + j] = (datum_element - mean[j]) * scale;
-          if (show_data)
-        	  data_buffer[j] = static_cast<uint8_t>(data[j]);
-        }
-      } else {
-        for (int j = 0; j < size; ++j) {
-          top_data[item_id * size + j] =
-              (datum.float_data(j) - mean[j]) * scale;
-        }
-      }
+      TransformFloatData(datum.float_data(), mean, size, scale,
+          args.top_data + item_id * size);
     }
 
     if (show_data>0){
@@ -171,14 +126,7 @@ void* VolumeDataLayerPrefetch(void* layer_pointer) {
     	}
     }
     if (layer->output_labels_) {
-      top_label[item_id] = datum.label();
-    }
-    // go to the next iteration
-    layer->iter_->Next();
-    if (!layer->iter_->Valid()) {
-      // We have reached the end. Restart from the first.
-      DLOG(INFO) << "Restarting data prefetching from start.";
-      layer->iter_->SeekToFirst();
+      args.top_label[item_id] = datum.label();
     }
   }
   if (show_data & data_buffer!=NULL)
@@ -186,6 +134,69 @@ void* VolumeDataLayerPrefetch(void* layer_pointer) {
   return static_cast<void*>(NULL);
 }
 
+template <typename Dtype>
+void* VolumeDataLayerPrefetch(void* layer_pointer) {
+  CHECK(layer_pointer);
+  VolumeDataLayer<Dtype>* layer = static_cast<VolumeDataLayer<Dtype>*>(layer_pointer);
+  CHECK(layer);
+  CHECK(layer->prefetch_data_);
+  Dtype* top_data = layer->prefetch_data_->mutable_cpu_data();
+  Dtype* top_label = NULL;
+  if (layer->output_labels_) {
+    top_label = layer->prefetch_label_->mutable_cpu_data();
+  }
+  const int batch_size = layer->layer_param_.data_param().batch_size();
+  const int crop_size = layer->layer_param_.data_param().crop_size();
+  const bool mirror = layer->layer_param_.data_param().mirror();
+
+  if (mirror && crop_size == 0) {
+    LOG(FATAL) << "Current implementation requires mirror and crop_size to be "
+        << "set at the same time.";
+  }
+  const int height = layer->datum_height_;
+  const int width = layer->datum_width_;
+  // Draw the crops and mirroring in item order, so that a batch does not
+  // depend on the number of readers.
+  vector<int> h_off(batch_size, 0);
+  vector<int> w_off(batch_size, 0);
+  vector<int> do_mirror(batch_size, 0);
+  if (crop_size) {
+    for (int item_id = 0; item_id < batch_size; ++item_id) {
+      // We only do random crop when we do training.
+      if (layer->phase_ == Caffe::TRAIN) {
+        h_off[item_id] = layer->PrefetchRand() % (height - crop_size);
+        w_off[item_id] = layer->PrefetchRand() % (width - crop_size);
+      } else {
+        h_off[item_id] = (height - crop_size) / 2;
+        w_off[item_id] = (width - crop_size) / 2;
+      }
+      do_mirror[item_id] = mirror && layer->PrefetchRand() % 2;
+    }
+  }
+  const int num_readers = layer->cursors_.size();
+  vector<VolumeReaderArgs<Dtype> > args(num_readers);
+  vector<pthread_t> threads(num_readers);
+  for (int i = 0; i < num_readers; ++i) {
+    args[i].layer = layer;
+    args[i].reader_id = i;
+    args[i].top_data = top_data;
+    args[i].top_label = top_label;
+    args[i].h_off = &h_off;
+    args[i].w_off = &w_off;
+    args[i].do_mirror = &do_mirror;
+    if (i > 0) {
+      CHECK(!pthread_create(&threads[i], NULL, VolumeDataLayerRead<Dtype>,
+          static_cast<void*>(&args[i]))) << "Pthread execution failed.";
+    }
+  }
+  VolumeDataLayerRead<Dtype>(static_cast<void*>(&args[0]));
+  for (int i = 1; i < num_readers; ++i) {
+    CHECK(!pthread_join(threads[i], NULL)) << "Pthread joining failed.";
+  }
+  layer->next_record_ += batch_size;
+  return static_cast<void*>(NULL);
+}
+
 template <typename Dtype>
 VolumeDataLayer<Dtype>::~VolumeDataLayer<Dtype>() {
   JoinPrefetchThread();
@@ -202,35 +213,33 @@ void VolumeDataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   } else {
     output_labels_ = true;
   }
-  // Initialize the leveldb
-  leveldb::DB* db_temp;
-  leveldb::Options options;
-  options.create_if_missing = false;
-  options.max_open_files = 100;
-  LOG(INFO) << "Opening leveldb " << this->layer_param_.data_param().source();
-  leveldb::Status status = leveldb::DB::Open(
-      options, this->layer_param_.data_param().source(), &db_temp);
-  CHECK(status.ok()) << "Failed to open leveldb "
-      << this->layer_param_.data_param().source() << std::endl
-      << status.ToString();
-  db_.reset(db_temp);
-  iter_.reset(db_->NewIterator(leveldb::ReadOptions()));
-  iter_->SeekToFirst();
+  // Initialize the database and a cursor per reader
+  const DataParameter& data_param = this->layer_param_.data_param();
+  db_.reset(Database::Open(data_param.backend(), data_param.source()));
+  const int num_readers = data_param.num_readers();
+  CHECK_GT(num_readers, 0);
+  CHECK(num_readers == 1 || data_param.backend() == DataParameter_DB_LMDB)
+      << "Several readers need backend: LMDB.";
+  CHECK(!data_param.show_data() || num_readers == 1)
+      << "show_data requires num_readers to be 1.";
+  LOG(INFO) << "Reading with " << num_readers << " readers";
+  cursors_.clear();
+  for (int i = 0; i < num_readers; ++i) {
+    cursors_.push_back(shared_ptr<DatabaseCursor>(db_->NewCursor()));
+  }
+  next_record_ = 0;
   // Check if we would need to randomly skip a few data points
   if (this->layer_param_.data_param().rand_skip()) {
     unsigned int skip = caffe_rng_rand() %
                         this->layer_param_.data_param().rand_skip();
     LOG(INFO) << "Skipping first " << skip << " data points.";
-    while (skip-- > 0) {
-      iter_->Next();
-      if (!iter_->Valid()) {
-        iter_->SeekToFirst();
-      }
-    }
+    next_record_ = skip;
   }
   // Read a data point, and use it to initialize the top blob.
-  VolumeDatum datum;
-  datum.ParseFromString(iter_->value().ToString());
+  DatumView datum;
+  CHECK(datum.ParseVolumeDatum(cursors_[0]->value(),
+      cursors_[0]->value_size()))
+      << "Failed to parse the datum at " << cursors_[0]->key();
   // image
   int crop_size = this->layer_param_.data_param().crop_size();
   if (crop_size > 0) {
@@ -295,6 +304,16 @@ void VolumeDataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   DLOG(INFO) << "Initializing prefetch";
   CreatePrefetchThread();
   DLOG(INFO) << "Prefetch initialized.";
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void VolumeDataLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  (*top)[0]->ReshapeLike(*prefetch_data_);
+  if (output_labels_) {
+    (*top)[1]->ReshapeLike(*prefetch_label_);
+  }
 }
 
 template <typename Dtype>
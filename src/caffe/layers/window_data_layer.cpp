@@ -406,6 +406,14 @@ void WindowDataLayer<Dtype>::SetUp(const vector<Blob<Dtype>*>& bottom,
   DLOG(INFO) << "Initializing prefetch";
   CreatePrefetchThread();
   DLOG(INFO) << "Prefetch initialized.";
+  Reshape(bottom, top);
+}
+
+template <typename Dtype>
+void WindowDataLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+      vector<Blob<Dtype>*>* top) {
+  (*top)[0]->ReshapeLike(*prefetch_data_);
+  (*top)[1]->ReshapeLike(*prefetch_label_);
 }
 
 template <typename Dtype>
@@ -9,6 +9,8 @@
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/layer.hpp"
 #include "caffe/net.hpp"
+#include "caffe/vision_layers.hpp"
+#include "caffe/util/flat_weights.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/insert_splits.hpp"
 #include "caffe/util/upgrade_proto.hpp"
@@ -19,6 +21,21 @@ using std::set;
 
 namespace caffe {
 
+// Whether layers of the type compute their top blobs in the memory of the
+// blobs, rather than pointing the blobs at other memory, so that a top may be
+// a view of a larger blob.
+static bool WritesTopsInPlace(const LayerParameter_LayerType type) {
+  switch (type) {
+  case LayerParameter_LayerType_FLATTEN:
+  case LayerParameter_LayerType_MEMORY_DATA:
+  case LayerParameter_LayerType_RESHAPE:
+  case LayerParameter_LayerType_SPLIT:
+    return false;
+  default:
+    return true;
+  }
+}
+
 template <typename Dtype>
 Net<Dtype>::Net(const NetParameter& param) {
   Init(param);
@@ -44,20 +61,23 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
   CHECK_EQ(param.input_size() * 5, param.input_dim_size())
       << "Incorrect bottom blob dimension specifications.";
   size_t memory_used = 0;
+  // The layer computing each blob, or -1 for the inputs.
+  vector<int> blob_producers;
   // set the input blobs
   for (int i = 0; i < param.input_size(); ++i) {
     const string& blob_name = param.input(i);
     shared_ptr<Blob<Dtype> > blob_pointer(
-        new Blob<Dtype>(param.input_dim(i * 4),
-                        param.input_dim(i * 4 + 1),
-                        param.input_dim(i * 4 + 2),
-                        param.input_dim(i * 4 + 3),
-                        param.input_dim(i * 4 + 4)));
+        new Blob<Dtype>(param.input_dim(i * 5),
+                        param.input_dim(i * 5 + 1),
+                        param.input_dim(i * 5 + 2),
+                        param.input_dim(i * 5 + 3),
+                        param.input_dim(i * 5 + 4)));
     blobs_.push_back(blob_pointer);
     blob_names_.push_back(blob_name);
     blob_need_backward_.push_back(param.force_backward());
     net_input_blob_indices_.push_back(i);
     net_input_blobs_.push_back(blob_pointer.get());
+    blob_producers.push_back(-1);
     blob_name_to_idx[blob_name] = i;
     available_blobs.insert(blob_name);
     memory_used += blob_pointer->count();
@@ -72,6 +92,7 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
     bool in_place = false;
     const LayerParameter& layer_param = param.layers(i);
     layers_.push_back(shared_ptr<Layer<Dtype> >(GetLayer<Dtype>(layer_param)));
+    layers_[i]->set_workspace(&workspace_);
     layer_names_.push_back(layer_param.name());
     LOG(INFO) << "Creating Layer " << layer_param.name();
     bool need_backward = param.force_backward();
@@ -114,12 +135,29 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
         blobs_.push_back(blob_pointer);
         blob_names_.push_back(blob_name);
         blob_need_backward_.push_back(param.force_backward());
+        blob_producers.push_back(i);
         blob_name_to_idx[blob_name] = blob_names_.size() - 1;
         available_blobs.insert(blob_name);
         top_vecs_[i].push_back(blobs_[blob_names_.size() - 1].get());
         top_id_vecs_[i].push_back(blob_names_.size() - 1);
       }
     }
+    // Let the layers computing the inputs of a concatenation write them
+    // straight into its output (see ConcatLayer).
+    if (layer_param.type() == LayerParameter_LayerType_CONCAT) {
+      vector<bool> bottom_views(bottom_id_vecs_[i].size(), false);
+      for (int j = 0; j < bottom_views.size(); ++j) {
+        const int producer = blob_producers[bottom_id_vecs_[i][j]];
+        bottom_views[j] = producer >= 0 &&
+            WritesTopsInPlace(layers_[producer]->layer_param().type());
+        if (bottom_views[j]) {
+          LOG(INFO) << layer_names_[producer] << " writes "
+              << layer_param.bottom(j) << " into " << layer_param.name();
+        }
+      }
+      static_cast<ConcatLayer<Dtype>*>(layers_[i].get())->set_bottom_views(
+          bottom_views);
+    }
     // After this layer is connected, set it up.
     // LOG(INFO) << "Setting up " << layer_names_[i];
     layers_[i]->SetUp(bottom_vecs_[i], &top_vecs_[i]);
@@ -175,6 +213,15 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
   GetLearningRateAndWeightDecay();
   LOG(INFO) << "Network initialization done.";
   LOG(INFO) << "Memory required for Data " << memory_used*sizeof(Dtype);
+  // Each layer's scratch (e.g. the im2col/vol2col buffer of a convolution)
+  // would otherwise be allocated on its own.
+  size_t workspace_unshared = 0;
+  for (int i = 0; i < layers_.size(); ++i) {
+    workspace_unshared += layers_[i]->workspace_bytes();
+  }
+  LOG(INFO) << "Memory required for the shared workspace "
+      << workspace_.size() << " (saves "
+      << workspace_unshared - workspace_.size() << ")";
 }
 
 
@@ -231,14 +278,30 @@ const vector<Blob<Dtype>*>& Net<Dtype>::ForwardPrefilled(Dtype* loss) {
   return net_output_blobs_;
 }
 
+template <typename Dtype>
+static bool SameShape(const Blob<Dtype>& a, const Blob<Dtype>& b) {
+  return a.num() == b.num() && a.channels() == b.channels() &&
+      a.length() == b.length() && a.height() == b.height() &&
+      a.width() == b.width();
+}
+
 template <typename Dtype>
 const vector<Blob<Dtype>*>& Net<Dtype>::Forward(
     const vector<Blob<Dtype>*> & bottom, Dtype* loss) {
-  // Copy bottom to internal bottom
+  // Copy bottom to internal bottom, reshaping the net if the input shapes
+  // have changed since the last pass.
+  bool shape_changed = false;
   for (int i = 0; i < bottom.size(); ++i) {
+    if (!SameShape(*net_input_blobs_[i], *bottom[i])) {
+      net_input_blobs_[i]->ReshapeLike(*bottom[i]);
+      shape_changed = true;
+    }
     net_input_blobs_[i]->CopyFrom(*bottom[i]);
     //LOG(INFO) << "copying for inference";
   }
+  if (shape_changed) {
+    Reshape();
+  }
   return ForwardPrefilled(loss);
 }
 
@@ -252,6 +315,7 @@ string Net<Dtype>::Forward(const string& input_blob_protos, Dtype* loss) {
     for (int i = 0; i < blob_proto_vec.blobs_size(); ++i) {
       net_input_blobs_[i]->FromProto(blob_proto_vec.blobs(i));
     }
+    Reshape();
   }
   ForwardPrefilled(loss);
   blob_proto_vec.Clear();
@@ -264,6 +328,13 @@ string Net<Dtype>::Forward(const string& input_blob_protos, Dtype* loss) {
 }
 
 
+template <typename Dtype>
+void Net<Dtype>::Reshape() {
+  for (int i = 0; i < layers_.size(); ++i) {
+    layers_[i]->Reshape(bottom_vecs_[i], &top_vecs_[i]);
+  }
+}
+
 template <typename Dtype>
 void Net<Dtype>::Backward() {
   for (int i = layers_.size() - 1; i >= 0; --i) {
@@ -300,6 +371,13 @@ void Net<Dtype>::ShareTrainedLayersWith(Net* other) {
       CHECK_EQ(target_blobs[j]->length(), source_blob->length());
       CHECK_EQ(target_blobs[j]->height(), source_blob->height());
       CHECK_EQ(target_blobs[j]->width(), source_blob->width());
+      // Bring the weights up to date where this mode reads them now, so that
+      // nets sharing them only read the memory when run concurrently.
+      if (Caffe::mode() == Caffe::CPU) {
+        source_blob->cpu_data();
+      } else {
+        source_blob->gpu_data();
+      }
       target_blobs[j]->ShareData(*source_blob);
     }
   }
@@ -337,8 +415,57 @@ void Net<Dtype>::CopyTrainedLayersFrom(const NetParameter& param) {
   }
 }
 
+// Points blob at a mapped float tensor, holding the mapping alive for as long
+// as the blob's memory (which other nets may share) is. Only float nets can
+// use the mapped memory in place; the generic version converts into the
+// blob's own memory.
+template <typename Dtype>
+static void SetBlobFromFlatData(float* data,
+    const shared_ptr<FlatWeightsFile>& file, Blob<Dtype>* blob) {
+  Dtype* blob_data = blob->mutable_cpu_data();
+  for (int i = 0; i < blob->count(); ++i) {
+    blob_data[i] = data[i];
+  }
+}
+
+template <>
+void SetBlobFromFlatData<float>(float* data,
+    const shared_ptr<FlatWeightsFile>& file, Blob<float>* blob) {
+  blob->set_cpu_data(data, file);
+}
+
+template <typename Dtype>
+void Net<Dtype>::CopyTrainedLayersFromFlat(const string& trained_filename) {
+  shared_ptr<FlatWeightsFile> weights(new FlatWeightsFile(trained_filename));
+  for (int i = 0; i < weights->num_blobs(); ++i) {
+    const FlatWeightsEntry& entry = weights->entry(i);
+    if (!layer_names_index_.count(entry.layer_name)) {
+      DLOG(INFO) << "Ignoring source layer " << entry.layer_name;
+      continue;
+    }
+    vector<shared_ptr<Blob<Dtype> > >& target_blobs =
+        layers_[layer_names_index_[entry.layer_name]]->blobs();
+    CHECK_LT(entry.blob_id, target_blobs.size())
+        << "Incompatible number of blobs for layer " << entry.layer_name;
+    Blob<Dtype>* target_blob = target_blobs[entry.blob_id].get();
+    CHECK_EQ(target_blob->num(), entry.num);
+    CHECK_EQ(target_blob->channels(), entry.channels);
+    CHECK_EQ(target_blob->height(), entry.height);
+    CHECK_EQ(target_blob->width(), entry.width);
+    CHECK_EQ(target_blob->count(), entry.count())
+        << "Incompatible length for layer " << entry.layer_name;
+    target_blob->Reshape(entry.num, entry.channels, entry.length, entry.height,
+        entry.width);
+    SetBlobFromFlatData(weights->data(i), weights, target_blob);
+  }
+}
+
 template <typename Dtype>
 void Net<Dtype>::CopyTrainedLayersFrom(const string trained_filename) {
+  if (IsFlatWeightsFile(trained_filename)) {
+    CopyTrainedLayersFromFlat(trained_filename);
+    return;
+  }
   NetParameter param;
   ReadNetParamsFromBinaryFileOrDie(trained_filename, &param);
   CopyTrainedLayersFrom(param);
@@ -365,6 +492,78 @@ void Net<Dtype>::ToProto(NetParameter* param, bool write_diff) {
   }
 }
 
+template <typename Dtype>
+size_t Net<Dtype>::CompactWeights(const HalfFormat format) {
+  CHECK_EQ(Caffe::mode(), Caffe::CPU)
+      << "Compact weights only support CPU inference; set CPU mode first.";
+  size_t bytes_saved = 0;
+  for (int i = 0; i < layers_.size(); ++i) {
+    if (layers_[i]->CompactWeights(format)) {
+      const int count = layers_[i]->blobs()[0]->count();
+      bytes_saved += count * (sizeof(Dtype) - sizeof(uint16_t));
+      LOG(INFO) << "Compacted the weights of " << layer_names_[i];
+    }
+  }
+  return bytes_saved;
+}
+
+template <typename Dtype>
+size_t Net<Dtype>::CompactActivations(const HalfFormat format) {
+  CHECK_EQ(Caffe::mode(), Caffe::CPU)
+      << "Compact activations only support CPU inference; set CPU mode first.";
+  // A blob may be compact if every layer writing it (its producer and any
+  // in-place layers after it) and every layer reading it handle compact
+  // storage.
+  vector<int> num_readers(blobs_.size(), 0);
+  vector<bool> compactable(blobs_.size(), true);
+  for (int i = 0; i < layers_.size(); ++i) {
+    for (int j = 0; j < top_id_vecs_[i].size(); ++j) {
+      const int blob_id = top_id_vecs_[i][j];
+      if (!layers_[i]->WritesCompactTop()) {
+        compactable[blob_id] = false;
+      }
+    }
+    for (int j = 0; j < bottom_id_vecs_[i].size(); ++j) {
+      const int blob_id = bottom_id_vecs_[i][j];
+      ++num_readers[blob_id];
+      if (!layers_[i]->ReadsCompactBottom()) {
+        compactable[blob_id] = false;
+      }
+    }
+  }
+  for (int i = 0; i < net_input_blob_indices_.size(); ++i) {
+    compactable[net_input_blob_indices_[i]] = false;
+  }
+  for (int i = 0; i < net_output_blob_indices_.size(); ++i) {
+    compactable[net_output_blob_indices_[i]] = false;
+  }
+  size_t bytes_saved = 0;
+  for (int i = 0; i < blobs_.size(); ++i) {
+    if (compactable[i] && num_readers[i] > 0 && !blobs_[i]->compact()) {
+      blobs_[i]->Compact(format);
+      bytes_saved += blobs_[i]->count() * (sizeof(Dtype) - sizeof(uint16_t));
+      LOG(INFO) << "Compacted the activations " << blob_names_[i];
+    }
+  }
+  // The layers reserve workspace to convert their compact bottoms and tops.
+  Reshape();
+  return bytes_saved;
+}
+
+template <typename Dtype>
+void Net<Dtype>::StructureToProto(NetParameter* param) {
+  param->Clear();
+  param->set_name(name_);
+  for (int i = 0; i < net_input_blob_indices_.size(); ++i) {
+    param->add_input(blob_names_[net_input_blob_indices_[i]]);
+  }
+  for (int i = 0; i < layers_.size(); ++i) {
+    LayerParameter* layer_param = param->add_layers();
+    layer_param->CopyFrom(layers_[i]->layer_param());
+    layer_param->clear_blobs();
+  }
+}
+
 template <typename Dtype>
 void Net<Dtype>::Update() {
   for (int i = 0; i < params_.size(); ++i) {
@@ -11,6 +11,7 @@
 #include "caffe/solver.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/upgrade_proto.hpp"
 
 using std::max;
 using std::min;
@@ -19,18 +20,36 @@ namespace caffe {
 
 template <typename Dtype>
 Solver<Dtype>::Solver(const SolverParameter& param)
-    : net_(), test_net_() {
+    : net_(), test_net_(), snapshot_running_(false) {
   Init(param);
 }
 
 template <typename Dtype>
 Solver<Dtype>::Solver(const string& param_file)
-    : net_(), test_net_() {
+    : net_(), test_net_(), snapshot_running_(false) {
   SolverParameter param;
   ReadProtoFromTextFile(param_file, &param);
   Init(param);
 }
 
+template <typename Dtype>
+Solver<Dtype>::~Solver() {
+  WaitForSnapshot();
+  if (train_threads_.size()) {
+    train_stop_ = true;
+    pthread_barrier_wait(&train_barrier_);
+    for (int i = 0; i < train_threads_.size(); ++i) {
+      CHECK(!pthread_join(train_threads_[i], NULL)) << "Pthread joining failed.";
+    }
+  }
+  if (train_nets_.size()) {
+    pthread_barrier_destroy(&train_barrier_);
+  }
+  if (test_replicas_.size()) {
+    pthread_mutex_destroy(&test_mutex_);
+  }
+}
+
 template <typename Dtype>
 void Solver<Dtype>::Init(const SolverParameter& param) {
   param_ = param;
@@ -38,11 +57,21 @@ void Solver<Dtype>::Init(const SolverParameter& param) {
     Caffe::set_random_seed(param_.random_seed());
   }
   // Scaffolding code
-  LOG(INFO) << "Creating training net.";
-  net_.reset(new Net<Dtype>(param_.train_net()));
+  CHECK_GE(param_.train_num_threads(), 1);
+  if (param_.train_num_threads() > 1) {
+    InitTrainReplicas();
+  } else {
+    LOG(INFO) << "Creating training net.";
+    net_.reset(new Net<Dtype>(param_.train_net()));
+  }
   if (param_.has_test_net()) {
-    LOG(INFO) << "Creating testing net.";
-    test_net_.reset(new Net<Dtype>(param_.test_net()));
+    CHECK_GE(param_.test_num_threads(), 1);
+    if (param_.test_num_threads() > 1) {
+      InitTestReplicas();
+    } else {
+      LOG(INFO) << "Creating testing net.";
+      test_net_.reset(new Net<Dtype>(param_.test_net()));
+    }
     CHECK_GT(param_.test_iter(), 0);
     CHECK_GT(param_.test_interval(), 0);
   }
@@ -79,7 +108,8 @@ void Solver<Dtype>::Solve(const char* resume_file) {
   // should be given, and we will just provide dummy vecs.
   vector<Blob<Dtype>*> bottom_vec;
   while (iter_++ < param_.max_iter()) {
-    Dtype loss = net_->ForwardBackward(bottom_vec);
+    Dtype loss = train_nets_.size() ? ParallelForwardBackward() :
+        net_->ForwardBackward(bottom_vec);
     ComputeUpdateValue();
     net_->Update();
 
@@ -97,43 +127,207 @@ void Solver<Dtype>::Solve(const char* resume_file) {
   // After the optimization is done, always do a snapshot.
   iter_--;
   Snapshot();
+  WaitForSnapshot();
   LOG(INFO) << "Optimization Done.";
 }
 
 
+// Restricts the data layers of a training net to shard shard_id of
+// num_shards, so that every data-parallel replica reads different data.
+static void ShardDataLayers(const int num_shards, const int shard_id,
+    NetParameter* param) {
+  for (int i = 0; i < param->layers_size(); ++i) {
+    LayerParameter* layer = param->mutable_layers(i);
+    switch (layer->type()) {
+    case LayerParameter_LayerType_IMAGE_DATA:
+    case LayerParameter_LayerType_VIDEO_DATA:
+      layer->mutable_image_data_param()->set_num_shards(num_shards);
+      layer->mutable_image_data_param()->set_shard_id(shard_id);
+      break;
+    case LayerParameter_LayerType_HDF5_DATA:
+      layer->mutable_hdf5_data_param()->set_num_shards(num_shards);
+      layer->mutable_hdf5_data_param()->set_shard_id(shard_id);
+      break;
+    case LayerParameter_LayerType_DATA:
+    case LayerParameter_LayerType_MEMORY_DATA:
+    case LayerParameter_LayerType_VOLUME_DATA:
+    case LayerParameter_LayerType_WINDOW_DATA:
+      LOG(FATAL) << "Data layer " << layer->name() << " cannot be sharded "
+          << "for train_num_threads > 1.";
+      break;
+    default:
+      break;
+    }
+  }
+}
+
 template <typename Dtype>
-void Solver<Dtype>::Test() {
-  LOG(INFO) << "Iteration " << iter_ << ", Testing net";
-  // We need to set phase to test before running.
-  Caffe::set_phase(Caffe::TEST);
-  CHECK_NOTNULL(test_net_.get())->ShareTrainedLayersWith(net_.get());
-  vector<Dtype> test_score;
-  vector<Blob<Dtype>*> bottom_vec;
-  Dtype loss = 0;
-  for (int i = 0; i < param_.test_iter(); ++i) {
-    Dtype iter_loss;
-    const vector<Blob<Dtype>*>& result =
-        test_net_->Forward(bottom_vec, &iter_loss);
-    if (param_.test_compute_loss()) {
-      loss += iter_loss;
+void Solver<Dtype>::InitTrainReplicas() {
+  CHECK_EQ(param_.solver_mode(), SolverParameter_SolverMode_CPU)
+      << "train_num_threads > 1 is only supported in CPU mode.";
+  NetParameter train_param;
+  ReadNetParamsFromTextFileOrDie(param_.train_net(), &train_param);
+  const int num_threads = param_.train_num_threads();
+  LOG(INFO) << "Creating " << num_threads << " training net replicas.";
+  train_nets_.clear();
+  for (int i = 0; i < num_threads; ++i) {
+    NetParameter shard_param(train_param);
+    ShardDataLayers(num_threads, i, &shard_param);
+    train_nets_.push_back(
+        shared_ptr<Net<Dtype> >(new Net<Dtype>(shard_param)));
+    if (i > 0) {
+      train_nets_[i]->ShareTrainedLayersWith(train_nets_[0].get());
     }
-    if (i == 0) {
-      for (int j = 0; j < result.size(); ++j) {
-        const Dtype* result_vec = result[j]->cpu_data();
-        for (int k = 0; k < result[j]->count(); ++k) {
-          test_score.push_back(result_vec[k]);
-        }
+  }
+  net_ = train_nets_[0];
+  train_stop_ = false;
+  train_loss_.resize(num_threads);
+  pthread_barrier_init(&train_barrier_, NULL, num_threads);
+}
+
+namespace {
+
+template <typename Dtype>
+struct TrainWorkerArgs {
+  Solver<Dtype>* solver;
+  int worker_id;
+  unsigned int seed;
+};
+
+}  // namespace
+
+template <typename Dtype>
+void* Solver<Dtype>::TrainWorkerThread(void* arg) {
+  TrainWorkerArgs<Dtype> args = *static_cast<TrainWorkerArgs<Dtype>*>(arg);
+  delete static_cast<TrainWorkerArgs<Dtype>*>(arg);
+  Caffe::InitThreadContext();
+  Caffe::set_random_seed(args.seed);
+  Solver<Dtype>* solver = args.solver;
+  while (true) {
+    pthread_barrier_wait(&solver->train_barrier_);
+    if (solver->train_stop_) {
+      break;
+    }
+    solver->TrainWorkerStep(args.worker_id);
+  }
+  return static_cast<void*>(NULL);
+}
+
+template <typename Dtype>
+void Solver<Dtype>::TrainWorkerStep(const int worker_id) {
+  vector<Blob<Dtype>*> bottom_vec;
+  train_loss_[worker_id] = train_nets_[worker_id]->ForwardBackward(bottom_vec);
+  // Tree reduction: at the level with the given stride, every worker whose id
+  // is a multiple of 2 * stride adds the gradients of worker id + stride to
+  // its own, so the sum ends up in worker 0 after log2(num_threads) levels.
+  const int num_threads = train_nets_.size();
+  for (int stride = 1; stride < num_threads; stride *= 2) {
+    pthread_barrier_wait(&train_barrier_);
+    const int peer_id = worker_id + stride;
+    if (worker_id % (2 * stride) == 0 && peer_id < num_threads) {
+      vector<shared_ptr<Blob<Dtype> > >& params =
+          train_nets_[worker_id]->params();
+      vector<shared_ptr<Blob<Dtype> > >& peer_params =
+          train_nets_[peer_id]->params();
+      for (int i = 0; i < params.size(); ++i) {
+        caffe_axpy(params[i]->count(), Dtype(1), peer_params[i]->cpu_diff(),
+            params[i]->mutable_cpu_diff());
       }
+    }
+  }
+  pthread_barrier_wait(&train_barrier_);
+}
+
+template <typename Dtype>
+Dtype Solver<Dtype>::ParallelForwardBackward() {
+  const int num_threads = train_nets_.size();
+  if (train_threads_.empty()) {
+    train_threads_.resize(num_threads - 1);
+    for (int i = 1; i < num_threads; ++i) {
+      TrainWorkerArgs<Dtype>* args = new TrainWorkerArgs<Dtype>;
+      args->solver = this;
+      args->worker_id = i;
+      args->seed = caffe_rng_rand();
+      CHECK(!pthread_create(&train_threads_[i - 1], NULL, TrainWorkerThread,
+          args)) << "Pthread execution failed.";
+    }
+  }
+  // Start the iteration on the workers and take part as worker 0.
+  pthread_barrier_wait(&train_barrier_);
+  TrainWorkerStep(0);
+  Dtype loss = 0;
+  for (int i = 0; i < num_threads; ++i) {
+    loss += train_loss_[i];
+  }
+  vector<shared_ptr<Blob<Dtype> > >& params = net_->params();
+  for (int i = 0; i < params.size(); ++i) {
+    caffe_scal(params[i]->count(), Dtype(1) / num_threads,
+        params[i]->mutable_cpu_diff());
+  }
+  return loss / num_threads;
+}
+
+template <typename Dtype>
+void Solver<Dtype>::InitTestReplicas() {
+  NetParameter test_param;
+  ReadNetParamsFromTextFileOrDie(param_.test_net(), &test_param);
+  // The data layers are the leading layers without bottom blobs. Only they
+  // read from the data source, so running them in order from one thread
+  // yields the same batches as the single test net would.
+  int num_feed_layers = 0;
+  while (num_feed_layers < test_param.layers_size() &&
+      test_param.layers(num_feed_layers).bottom_size() == 0) {
+    ++num_feed_layers;
+  }
+  CHECK_GT(num_feed_layers, 0)
+      << "test_num_threads > 1 requires the test net to start with its data "
+      << "layers.";
+  CHECK_LT(num_feed_layers, test_param.layers_size());
+  NetParameter feed_param;
+  feed_param.set_name(test_param.name() + "_feed");
+  NetParameter replica_param(test_param);
+  replica_param.clear_layers();
+  for (int i = 0; i < test_param.layers_size(); ++i) {
+    if (i < num_feed_layers) {
+      feed_param.add_layers()->CopyFrom(test_param.layers(i));
     } else {
-      int idx = 0;
-      for (int j = 0; j < result.size(); ++j) {
-        const Dtype* result_vec = result[j]->cpu_data();
-        for (int k = 0; k < result[j]->count(); ++k) {
-          test_score[idx++] += result_vec[k];
-        }
-      }
+      replica_param.add_layers()->CopyFrom(test_param.layers(i));
     }
   }
+  LOG(INFO) << "Creating testing feeder net.";
+  test_feed_net_.reset(new Net<Dtype>(feed_param));
+  test_feed_blobs_.clear();
+  for (int i = 0; i < num_feed_layers; ++i) {
+    for (int j = 0; j < test_param.layers(i).top_size(); ++j) {
+      const string& blob_name = test_param.layers(i).top(j);
+      Blob<Dtype>* blob = test_feed_net_->blob_by_name(blob_name).get();
+      replica_param.add_input(blob_name);
+      replica_param.add_input_dim(blob->num());
+      replica_param.add_input_dim(blob->channels());
+      replica_param.add_input_dim(blob->length());
+      replica_param.add_input_dim(blob->height());
+      replica_param.add_input_dim(blob->width());
+      test_feed_blobs_.push_back(blob);
+    }
+  }
+  LOG(INFO) << "Creating " << param_.test_num_threads()
+      << " testing net replicas.";
+  test_replicas_.clear();
+  for (int i = 0; i < param_.test_num_threads(); ++i) {
+    test_replicas_.push_back(
+        shared_ptr<Net<Dtype> >(new Net<Dtype>(replica_param)));
+  }
+  pthread_mutex_init(&test_mutex_, NULL);
+}
+
+template <typename Dtype>
+void Solver<Dtype>::Test() {
+  LOG(INFO) << "Iteration " << iter_ << ", Testing net";
+  // We need to set phase to test before running.
+  Caffe::set_phase(Caffe::TEST);
+  vector<Dtype> test_score;
+  Dtype loss;
+  TestScores(&test_score, &loss);
   if (param_.test_compute_loss()) {
     loss /= param_.test_iter();
     LOG(INFO) << "Test loss: " << loss;
@@ -145,26 +339,215 @@ void Solver<Dtype>::Test() {
   Caffe::set_phase(Caffe::TRAIN);
 }
 
+namespace {
+
+template <typename Dtype>
+struct TestReplicaArgs {
+  Solver<Dtype>* solver;
+  int replica_id;
+};
+
+}  // namespace
+
+template <typename Dtype>
+void* Solver<Dtype>::TestReplicaThread(void* arg) {
+  TestReplicaArgs<Dtype>* args = static_cast<TestReplicaArgs<Dtype>*>(arg);
+  Caffe::InitThreadContext();
+  Solver<Dtype>* solver = args->solver;
+  Net<Dtype>* replica = solver->test_replicas_[args->replica_id].get();
+  const vector<Blob<Dtype>*>& inputs = replica->input_blobs();
+  const int test_iter = solver->param_.test_iter();
+  while (true) {
+    // Take the next batch and copy it into this replica's inputs. The
+    // feeder net only ever runs under the lock, so batch i is the i-th batch
+    // the serial test would have read.
+    bool reshape = false;
+    pthread_mutex_lock(&solver->test_mutex_);
+    const int i = solver->test_next_iter_++;
+    if (i < test_iter) {
+      solver->test_feed_net_->ForwardPrefilled();
+      for (int k = 0; k < inputs.size(); ++k) {
+        const Blob<Dtype>& source = *solver->test_feed_blobs_[k];
+        if (source.num() != inputs[k]->num() ||
+            source.channels() != inputs[k]->channels() ||
+            source.length() != inputs[k]->length() ||
+            source.height() != inputs[k]->height() ||
+            source.width() != inputs[k]->width()) {
+          reshape = true;
+        }
+        inputs[k]->CopyFrom(source, false, true);
+      }
+    }
+    pthread_mutex_unlock(&solver->test_mutex_);
+    if (i >= test_iter) {
+      break;
+    }
+    if (reshape) {
+      replica->Reshape();
+    }
+    const vector<Blob<Dtype>*>& result =
+        replica->ForwardPrefilled(&solver->test_iter_loss_[i]);
+    vector<Dtype>& scores = solver->test_iter_scores_[i];
+    scores.clear();
+    for (int j = 0; j < result.size(); ++j) {
+      const Dtype* result_vec = result[j]->cpu_data();
+      scores.insert(scores.end(), result_vec, result_vec + result[j]->count());
+    }
+  }
+  return static_cast<void*>(NULL);
+}
+
+template <typename Dtype>
+void Solver<Dtype>::TestScores(vector<Dtype>* test_score, Dtype* loss) {
+  test_score->clear();
+  *loss = 0;
+  if (test_replicas_.size() == 0) {
+    CHECK_NOTNULL(test_net_.get())->ShareTrainedLayersWith(net_.get());
+    vector<Blob<Dtype>*> bottom_vec;
+    for (int i = 0; i < param_.test_iter(); ++i) {
+      Dtype iter_loss;
+      const vector<Blob<Dtype>*>& result =
+          test_net_->Forward(bottom_vec, &iter_loss);
+      if (param_.test_compute_loss()) {
+        *loss += iter_loss;
+      }
+      if (i == 0) {
+        for (int j = 0; j < result.size(); ++j) {
+          const Dtype* result_vec = result[j]->cpu_data();
+          for (int k = 0; k < result[j]->count(); ++k) {
+            test_score->push_back(result_vec[k]);
+          }
+        }
+      } else {
+        int idx = 0;
+        for (int j = 0; j < result.size(); ++j) {
+          const Dtype* result_vec = result[j]->cpu_data();
+          for (int k = 0; k < result[j]->count(); ++k) {
+            (*test_score)[idx++] += result_vec[k];
+          }
+        }
+      }
+    }
+    return;
+  }
+  const int num_threads = test_replicas_.size();
+  for (int i = 0; i < num_threads; ++i) {
+    test_replicas_[i]->ShareTrainedLayersWith(net_.get());
+  }
+  test_next_iter_ = 0;
+  test_iter_scores_.resize(param_.test_iter());
+  test_iter_loss_.resize(param_.test_iter());
+  vector<TestReplicaArgs<Dtype> > args(num_threads);
+  vector<pthread_t> threads(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    args[i].solver = this;
+    args[i].replica_id = i;
+    CHECK(!pthread_create(&threads[i], NULL, TestReplicaThread, &args[i]))
+        << "Pthread execution failed.";
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    CHECK(!pthread_join(threads[i], NULL)) << "Pthread joining failed.";
+  }
+  // Sum in batch order, as the serial loop does, so the result is identical.
+  for (int i = 0; i < param_.test_iter(); ++i) {
+    if (param_.test_compute_loss()) {
+      *loss += test_iter_loss_[i];
+    }
+    const vector<Dtype>& scores = test_iter_scores_[i];
+    if (i == 0) {
+      *test_score = scores;
+    } else {
+      CHECK_EQ(scores.size(), test_score->size());
+      for (int k = 0; k < scores.size(); ++k) {
+        (*test_score)[k] += scores[k];
+      }
+    }
+  }
+}
+
+
+// Copies the data (and the diff if copy_diff) of source into the host memory
+// of *copy, reshaping and reusing it across snapshots.
+template <typename Dtype>
+static void CopyBlobToHost(const Blob<Dtype>& source, const bool copy_diff,
+    shared_ptr<Blob<Dtype> >* copy) {
+  if (!*copy) {
+    copy->reset(new Blob<Dtype>());
+  }
+  (*copy)->Reshape(source.num(), source.channels(), source.length(),
+      source.height(), source.width());
+  caffe_copy(source.count(), source.cpu_data(), (*copy)->mutable_cpu_data());
+  if (copy_diff) {
+    caffe_copy(source.count(), source.cpu_diff(), (*copy)->mutable_cpu_diff());
+  }
+}
 
 template <typename Dtype>
 void Solver<Dtype>::Snapshot() {
-  NetParameter net_param;
-  // For intermediate results, we will also dump the gradient values.
-  net_->ToProto(&net_param, param_.snapshot_diff());
+  WaitForSnapshot();
+  net_->StructureToProto(&snapshot_net_param_);
+  const vector<shared_ptr<Layer<Dtype> > >& layers = net_->layers();
+  int num_blobs = 0;
+  for (int i = 0; i < layers.size(); ++i) {
+    num_blobs += layers[i]->blobs().size();
+  }
+  snapshot_blobs_.resize(num_blobs);
+  int blob_id = 0;
+  for (int i = 0; i < layers.size(); ++i) {
+    const vector<shared_ptr<Blob<Dtype> > >& blobs = layers[i]->blobs();
+    for (int j = 0; j < blobs.size(); ++j) {
+      // For intermediate results, we will also dump the gradient values.
+      CopyBlobToHost(*blobs[j], param_.snapshot_diff(),
+          &snapshot_blobs_[blob_id++]);
+    }
+  }
+  CopySolverState();
+  snapshot_iter_ = iter_;
+  CHECK(!pthread_create(&snapshot_thread_, NULL, SnapshotThread, this))
+      << "Pthread execution failed.";
+  snapshot_running_ = true;
+}
+
+template <typename Dtype>
+void Solver<Dtype>::WaitForSnapshot() {
+  if (snapshot_running_) {
+    CHECK(!pthread_join(snapshot_thread_, NULL)) << "Pthread joining failed.";
+    snapshot_running_ = false;
+  }
+}
+
+template <typename Dtype>
+void* Solver<Dtype>::SnapshotThread(void* arg) {
+  static_cast<Solver<Dtype>*>(arg)->WriteSnapshot();
+  return static_cast<void*>(NULL);
+}
+
+template <typename Dtype>
+void Solver<Dtype>::WriteSnapshot() {
+  NetParameter net_param(snapshot_net_param_);
+  int blob_id = 0;
+  for (int i = 0; i < net_param.layers_size(); ++i) {
+    LayerParameter* layer_param = net_param.mutable_layers(i);
+    const int num_blobs = net_->layers()[i]->blobs().size();
+    for (int j = 0; j < num_blobs; ++j) {
+      snapshot_blobs_[blob_id++]->ToProto(layer_param->add_blobs(),
+          param_.snapshot_diff());
+    }
+  }
   string filename(param_.snapshot_prefix());
   const int kBufferSize = 20;
   char iter_str_buffer[kBufferSize];
-  snprintf(iter_str_buffer, kBufferSize, "_iter_%d", iter_);
+  snprintf(iter_str_buffer, kBufferSize, "_iter_%d", snapshot_iter_);
   filename += iter_str_buffer;
   LOG(INFO) << "Snapshotting to " << filename;
-  WriteProtoToBinaryFile(net_param, filename.c_str());
+  WriteProtoToBinaryFileAndSync(net_param, filename.c_str());
   SolverState state;
   SnapshotSolverState(&state);
-  state.set_iter(iter_);
+  state.set_iter(snapshot_iter_);
   state.set_learned_net(filename);
   filename += ".solverstate";
   LOG(INFO) << "Snapshotting solver state to " << filename;
-  WriteProtoToBinaryFile(state, filename.c_str());
+  WriteProtoToBinaryFileAndSync(state, filename.c_str());
 }
 
 template <typename Dtype>
@@ -286,13 +669,21 @@ void SGDSolver<Dtype>::ComputeUpdateValue() {
   }
 }
 
+template <typename Dtype>
+void SGDSolver<Dtype>::CopySolverState() {
+  history_snapshot_.resize(history_.size());
+  for (int i = 0; i < history_.size(); ++i) {
+    CopyBlobToHost(*history_[i], false, &history_snapshot_[i]);
+  }
+}
+
 template <typename Dtype>
 void SGDSolver<Dtype>::SnapshotSolverState(SolverState* state) {
   state->clear_history();
-  for (int i = 0; i < history_.size(); ++i) {
+  for (int i = 0; i < history_snapshot_.size(); ++i) {
     // Add history
     BlobProto* history_blob = state->add_history();
-    history_[i]->ToProto(history_blob);
+    history_snapshot_[i]->ToProto(history_blob);
   }
 }
 
@@ -9,9 +9,17 @@
 
 namespace caffe {
 
+SyncedMemory::SyncedMemory(const shared_ptr<SyncedMemory>& parent,
+    size_t offset, size_t size)
+    : cpu_ptr_(NULL), gpu_ptr_(NULL), size_(size), head_(UNINITIALIZED),
+      own_cpu_data_(false), parent_(parent), offset_(offset) {
+  CHECK(parent_);
+  CHECK_LE(offset_ + size_, parent_->size());
+}
+
 SyncedMemory::~SyncedMemory() {
   if (cpu_ptr_ && own_cpu_data_) {
-    CaffeFreeHost(cpu_ptr_);
+    CaffeFreeHost(cpu_ptr_, size_);
   }
 
   if (gpu_ptr_) {
@@ -21,15 +29,21 @@ SyncedMemory::~SyncedMemory() {
 
 inline void SyncedMemory::to_cpu() {
   switch (head_) {
-  case UNINITIALIZED:
-    CaffeMallocHost(&cpu_ptr_, size_);
-    memset(cpu_ptr_, 0, size_);
+  case UNINITIALIZED: {
+    bool zeroed;
+    CaffeMallocHost(&cpu_ptr_, size_, &zeroed);
+    if (!zeroed) {
+      memset(cpu_ptr_, 0, size_);
+    }
     head_ = HEAD_AT_CPU;
     own_cpu_data_ = true;
     break;
+  }
   case HEAD_AT_GPU:
     if (cpu_ptr_ == NULL) {
-      CaffeMallocHost(&cpu_ptr_, size_);
+      // Overwritten by the copy below, so there is nothing to zero.
+      bool zeroed;
+      CaffeMallocHost(&cpu_ptr_, size_, &zeroed);
       own_cpu_data_ = true;
     }
     CUDA_CHECK(cudaMemcpy(cpu_ptr_, gpu_ptr_, size_, cudaMemcpyDeviceToHost));
@@ -62,32 +76,51 @@ inline void SyncedMemory::to_gpu() {
 }
 
 const void* SyncedMemory::cpu_data() {
+  if (parent_) {
+    return static_cast<const char*>(parent_->cpu_data()) + offset_;
+  }
   to_cpu();
   return (const void*)cpu_ptr_;
 }
 
 void SyncedMemory::set_cpu_data(void* data) {
   CHECK(data);
+  CHECK(!parent_) << "Cannot set the data of a view.";
   if (own_cpu_data_) {
-    CaffeFreeHost(cpu_ptr_);
+    CaffeFreeHost(cpu_ptr_, size_);
   }
   cpu_ptr_ = data;
   head_ = HEAD_AT_CPU;
   own_cpu_data_ = false;
+  cpu_data_owner_.reset();
+}
+
+void SyncedMemory::set_cpu_data(void* data, const shared_ptr<void>& owner) {
+  set_cpu_data(data);
+  cpu_data_owner_ = owner;
 }
 
 const void* SyncedMemory::gpu_data() {
+  if (parent_) {
+    return static_cast<const char*>(parent_->gpu_data()) + offset_;
+  }
   to_gpu();
   return (const void*)gpu_ptr_;
 }
 
 void* SyncedMemory::mutable_cpu_data() {
+  if (parent_) {
+    return static_cast<char*>(parent_->mutable_cpu_data()) + offset_;
+  }
   to_cpu();
   head_ = HEAD_AT_CPU;
   return cpu_ptr_;
 }
 
 void* SyncedMemory::mutable_gpu_data() {
+  if (parent_) {
+    return static_cast<char*>(parent_->mutable_gpu_data()) + offset_;
+  }
   to_gpu();
   head_ = HEAD_AT_GPU;
   return gpu_ptr_;
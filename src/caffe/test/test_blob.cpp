@@ -57,4 +57,65 @@ TYPED_TEST(BlobSimpleTest, TestReshape) {
   EXPECT_EQ(this->blob_->count(), 120);
 }
 
+TYPED_TEST(BlobSimpleTest, TestReshapeKeepsCapacity) {
+  this->blob_->Reshape(4, 3, 2, 5, 5);
+  const TypeParam* data = this->blob_->cpu_data();
+  EXPECT_EQ(this->blob_->capacity(), 600);
+  // Shrinking must not reallocate.
+  this->blob_->Reshape(1, 3, 2, 5, 5);
+  EXPECT_EQ(this->blob_->count(), 150);
+  EXPECT_EQ(this->blob_->capacity(), 600);
+  EXPECT_EQ(this->blob_->cpu_data(), data);
+  // Growing back within the capacity must not reallocate either.
+  this->blob_->Reshape(4, 3, 2, 5, 5);
+  EXPECT_EQ(this->blob_->cpu_data(), data);
+  // Growing past it does.
+  this->blob_->Reshape(8, 3, 2, 5, 5);
+  EXPECT_EQ(this->blob_->capacity(), 1200);
+}
+
+TYPED_TEST(BlobSimpleTest, TestShareThenGrow) {
+  this->blob_->Reshape(4, 3, 2, 5, 5);
+  // Shrink, then share the data and diff of a smaller blob.
+  this->blob_->Reshape(1, 3, 2, 5, 5);
+  Blob<TypeParam> other(1, 3, 2, 5, 5);
+  this->blob_->ShareData(other);
+  this->blob_->ShareDiff(other);
+  EXPECT_EQ(this->blob_->cpu_data(), other.cpu_data());
+  EXPECT_EQ(this->blob_->capacity(), 150);
+  // Growing back to the old size must not keep the smaller shared memory.
+  this->blob_->Reshape(4, 3, 2, 5, 5);
+  EXPECT_NE(this->blob_->cpu_data(), other.cpu_data());
+  EXPECT_NE(this->blob_->cpu_diff(), other.cpu_diff());
+  memset(this->blob_->mutable_cpu_data(), 0,
+      this->blob_->count() * sizeof(TypeParam));
+  memset(this->blob_->mutable_cpu_diff(), 0,
+      this->blob_->count() * sizeof(TypeParam));
+}
+
+TYPED_TEST(BlobSimpleTest, TestCompact) {
+  Blob<TypeParam>* blob = this->blob_preshaped_;
+  TypeParam* data = blob->mutable_cpu_data();
+  for (int i = 0; i < blob->count(); ++i) {
+    // Exact in float16; 1/3 rounds.
+    data[i] = (i % 2) ? (i - 60) * 0.25 : TypeParam(1) / 3;
+  }
+  blob->Compact(HALF_FLOAT16);
+  EXPECT_TRUE(blob->compact());
+  EXPECT_EQ(blob->compact_format(), HALF_FLOAT16);
+  BlobProto proto;
+  blob->ToProto(&proto);
+  ASSERT_EQ(proto.data_size(), blob->count());
+  for (int i = 0; i < blob->count(); ++i) {
+    EXPECT_EQ(blob->cpu_compact_data()[i],
+        FloatToHalf((i % 2) ? (i - 60) * 0.25f : 1.f / 3));
+    EXPECT_EQ(proto.data(i), HalfToFloat(blob->cpu_compact_data()[i]));
+  }
+  blob->Expand();
+  EXPECT_FALSE(blob->compact());
+  for (int i = 0; i < blob->count(); ++i) {
+    EXPECT_EQ(blob->cpu_data()[i], proto.data(i));
+  }
+}
+
 }  // namespace caffe
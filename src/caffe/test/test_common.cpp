@@ -1,5 +1,7 @@
 // Copyright 2014 BVLC and contributors.
 
+#include <pthread.h>
+
 #include <cstring>
 
 #include "cuda_runtime.h"
@@ -63,4 +65,46 @@ TEST_F(CommonTest, TestRandSeedGPU) {
   }
 }
 
+// Draws a few numbers after seeding the calling thread's generator.
+static void DrawWithSeed(const unsigned int seed, int* values) {
+  Caffe::set_random_seed(seed);
+  caffe_rng_bernoulli(10, 0.5, values);
+}
+
+static void* ThreadContextThread(void* arg) {
+  int* values = static_cast<int*>(arg);
+  EXPECT_FALSE(Caffe::has_thread_context());
+  Caffe::InitThreadContext();
+  EXPECT_TRUE(Caffe::has_thread_context());
+  // The context starts from the process-wide mode and phase.
+  EXPECT_EQ(Caffe::mode(), Caffe::CPU);
+  EXPECT_EQ(Caffe::phase(), Caffe::TEST);
+  Caffe::set_mode(Caffe::GPU);
+  Caffe::set_phase(Caffe::TRAIN);
+  EXPECT_EQ(Caffe::mode(), Caffe::GPU);
+  EXPECT_EQ(Caffe::phase(), Caffe::TRAIN);
+  DrawWithSeed(1701, values);
+  return static_cast<void*>(NULL);
+}
+
+TEST_F(CommonTest, TestThreadContext) {
+  Caffe::set_mode(Caffe::CPU);
+  Caffe::set_phase(Caffe::TEST);
+  int thread_values[10];
+  pthread_t thread;
+  ASSERT_FALSE(pthread_create(&thread, NULL, ThreadContextThread,
+      thread_values));
+  ASSERT_FALSE(pthread_join(thread, NULL));
+  // The thread's settings stayed in its own context.
+  EXPECT_FALSE(Caffe::has_thread_context());
+  EXPECT_EQ(Caffe::mode(), Caffe::CPU);
+  EXPECT_EQ(Caffe::phase(), Caffe::TEST);
+  // And its generator draws what the process-wide one does with that seed.
+  int values[10];
+  DrawWithSeed(1701, values);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(values[i], thread_values[i]);
+  }
+}
+
 }  // namespace caffe
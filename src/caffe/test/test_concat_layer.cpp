@@ -8,6 +8,7 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
+#include "caffe/util/math_functions.hpp"
 #include "caffe/vision_layers.hpp"
 #include "caffe/test/test_gradient_check_util.hpp"
 
@@ -109,6 +110,123 @@ TYPED_TEST(ConcatLayerTest, TestCPUNum) {
 }
 
 
+TYPED_TEST(ConcatLayerTest, TestCPUChannels5D) {
+  Blob<TypeParam> bottom_0(2, 3, 4, 6, 5);
+  Blob<TypeParam> bottom_1(2, 5, 4, 6, 5);
+  FillerParameter filler_param;
+  GaussianFiller<TypeParam> filler(filler_param);
+  filler.Fill(&bottom_0);
+  filler.Fill(&bottom_1);
+  vector<Blob<TypeParam>*> bottom_vec;
+  bottom_vec.push_back(&bottom_0);
+  bottom_vec.push_back(&bottom_1);
+  LayerParameter layer_param;
+  ConcatLayer<TypeParam> layer(layer_param);
+  Caffe::set_mode(Caffe::CPU);
+  layer.SetUp(bottom_vec, &(this->blob_top_vec_));
+  EXPECT_EQ(8, this->blob_top_->channels());
+  EXPECT_EQ(4, this->blob_top_->length());
+  layer.Forward(bottom_vec, &(this->blob_top_vec_));
+  for (int n = 0; n < 2; ++n) {
+    for (int c = 0; c < 8; ++c) {
+      for (int l = 0; l < 4; ++l) {
+        for (int h = 0; h < 6; ++h) {
+          for (int w = 0; w < 5; ++w) {
+            EXPECT_EQ(this->blob_top_->data_at(n, c, l, h, w), c < 3 ?
+                bottom_0.data_at(n, c, l, h, w) :
+                bottom_1.data_at(n, c - 3, l, h, w));
+          }
+        }
+      }
+    }
+  }
+  caffe_copy(this->blob_top_->count(), this->blob_top_->cpu_data(),
+      this->blob_top_->mutable_cpu_diff());
+  layer.Backward(this->blob_top_vec_, true, &bottom_vec);
+  for (int i = 0; i < bottom_0.count(); ++i) {
+    EXPECT_EQ(bottom_0.cpu_data()[i], bottom_0.cpu_diff()[i]);
+  }
+  for (int i = 0; i < bottom_1.count(); ++i) {
+    EXPECT_EQ(bottom_1.cpu_data()[i], bottom_1.cpu_diff()[i]);
+  }
+}
+
+TYPED_TEST(ConcatLayerTest, TestCPUViews) {
+  LayerParameter layer_param;
+  layer_param.mutable_concat_param()->set_concat_dim(0);
+  ConcatLayer<TypeParam> layer(layer_param);
+  Caffe::set_mode(Caffe::CPU);
+  vector<bool> bottom_views(2, true);
+  bottom_views[1] = false;
+  layer.set_bottom_views(bottom_views);
+  layer.SetUp(this->blob_bottom_vec_1, &(this->blob_top_vec_));
+  EXPECT_TRUE(this->blob_bottom_0->DataIsViewOf(*this->blob_top_, 0));
+  EXPECT_TRUE(this->blob_bottom_0->DiffIsViewOf(*this->blob_top_, 0));
+  EXPECT_FALSE(this->blob_bottom_2->DataIsViewOf(*this->blob_top_,
+      this->blob_bottom_0->count()));
+  // The view has taken the place of the data of the bottom.
+  FillerParameter filler_param;
+  GaussianFiller<TypeParam> filler(filler_param);
+  filler.Fill(this->blob_bottom_0);
+  filler.Fill(this->blob_bottom_2);
+  layer.Forward(this->blob_bottom_vec_1, &(this->blob_top_vec_));
+  const int count_0 = this->blob_bottom_0->count();
+  for (int i = 0; i < count_0; ++i) {
+    EXPECT_EQ(this->blob_bottom_0->cpu_data()[i],
+        this->blob_top_->cpu_data()[i]);
+  }
+  for (int i = 0; i < this->blob_bottom_2->count(); ++i) {
+    EXPECT_EQ(this->blob_bottom_2->cpu_data()[i],
+        this->blob_top_->cpu_data()[count_0 + i]);
+  }
+  caffe_copy(this->blob_top_->count(), this->blob_top_->cpu_data(),
+      this->blob_top_->mutable_cpu_diff());
+  layer.Backward(this->blob_top_vec_, true, &(this->blob_bottom_vec_1));
+  for (int i = 0; i < count_0; ++i) {
+    EXPECT_EQ(this->blob_bottom_0->cpu_data()[i],
+        this->blob_bottom_0->cpu_diff()[i]);
+  }
+  for (int i = 0; i < this->blob_bottom_2->count(); ++i) {
+    EXPECT_EQ(this->blob_bottom_2->cpu_data()[i],
+        this->blob_bottom_2->cpu_diff()[i]);
+  }
+}
+
+TYPED_TEST(ConcatLayerTest, TestCPUChannelViews) {
+  LayerParameter layer_param;
+  ConcatLayer<TypeParam> layer(layer_param);
+  Caffe::set_mode(Caffe::CPU);
+  layer.set_bottom_views(vector<bool>(2, true));
+  // The channels of a single volume are contiguous...
+  this->blob_bottom_0->Reshape(1, 3, 6, 5);
+  this->blob_bottom_1->Reshape(1, 5, 6, 5);
+  layer.SetUp(this->blob_bottom_vec_0, &(this->blob_top_vec_));
+  EXPECT_TRUE(this->blob_bottom_0->DataIsViewOf(*this->blob_top_, 0));
+  EXPECT_TRUE(this->blob_bottom_1->DataIsViewOf(*this->blob_top_,
+      this->blob_bottom_0->count()));
+  // ...but not those of a batch, which are copied instead.
+  this->blob_bottom_0->Reshape(2, 3, 6, 5);
+  this->blob_bottom_1->Reshape(2, 5, 6, 5);
+  layer.Reshape(this->blob_bottom_vec_0, &(this->blob_top_vec_));
+  EXPECT_FALSE(this->blob_bottom_0->DataIsViewOf(*this->blob_top_, 0));
+  FillerParameter filler_param;
+  GaussianFiller<TypeParam> filler(filler_param);
+  filler.Fill(this->blob_bottom_0);
+  filler.Fill(this->blob_bottom_1);
+  layer.Forward(this->blob_bottom_vec_0, &(this->blob_top_vec_));
+  for (int n = 0; n < 2; ++n) {
+    for (int c = 0; c < 8; ++c) {
+      for (int h = 0; h < 6; ++h) {
+        for (int w = 0; w < 5; ++w) {
+          EXPECT_EQ(this->blob_top_->data_at(n, c, h, w), c < 3 ?
+              this->blob_bottom_0->data_at(n, c, h, w) :
+              this->blob_bottom_1->data_at(n, c - 3, h, w));
+        }
+      }
+    }
+  }
+}
+
 TYPED_TEST(ConcatLayerTest, TestCPUGradient) {
   LayerParameter layer_param;
   Caffe::set_mode(Caffe::CPU);
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <cstring>
 #include <vector>
 
@@ -92,6 +93,91 @@ TYPED_TEST(Convolution3DLayerTest, TestCPUSimpleConvolution3D) {
   }
 }
 
+TYPED_TEST(Convolution3DLayerTest, TestCPUReshape) {
+  // Change the batch size and clip length after SetUp without rebuilding
+  // the layer; the weights must be kept and the output resized.
+  FillerParameter filler_param;
+  filler_param.set_value(1.);
+  ConstantFiller<TypeParam> filler(filler_param);
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->set_kernel_size(3);
+  convolution_param->set_kernel_depth(3);
+  convolution_param->set_stride(2);
+  convolution_param->set_temporal_stride(2);
+  convolution_param->set_num_output(6);
+  convolution_param->mutable_weight_filler()->set_type("constant");
+  convolution_param->mutable_weight_filler()->set_value(1);
+  convolution_param->mutable_bias_filler()->set_type("constant");
+  convolution_param->mutable_bias_filler()->set_value(0.1);
+  shared_ptr<Layer<TypeParam> > layer(
+      new Convolution3DLayer<TypeParam>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  const TypeParam* weights = layer->blobs()[0]->cpu_data();
+  this->blob_bottom_->Reshape(1, 3, 7, 5, 5);
+  filler.Fill(this->blob_bottom_);
+  layer->Reshape(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  EXPECT_EQ(this->blob_top_->num(), 1);
+  EXPECT_EQ(this->blob_top_->channels(), 6);
+  EXPECT_EQ(this->blob_top_->length(), 3);
+  EXPECT_EQ(this->blob_top_->height(), 2);
+  EXPECT_EQ(this->blob_top_->width(), 2);
+  EXPECT_EQ(layer->blobs()[0]->cpu_data(), weights);
+  Caffe::set_mode(Caffe::CPU);
+  layer->Forward(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  const TypeParam* top_data = this->blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], 81.1, 1e-4);
+  }
+}
+
+TYPED_TEST(Convolution3DLayerTest, TestCPUCompact) {
+  // Compact weights and a compact bottom must give the output of the
+  // full-precision layer on the same rounded values, and a compact top that
+  // output rounded.
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->set_kernel_size(3);
+  convolution_param->set_kernel_depth(3);
+  convolution_param->set_stride(2);
+  convolution_param->set_temporal_stride(2);
+  convolution_param->set_num_output(6);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("constant");
+  convolution_param->mutable_bias_filler()->set_value(0.1);
+  shared_ptr<Layer<TypeParam> > layer(
+      new Convolution3DLayer<TypeParam>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  Blob<TypeParam>* rounded[2] = {layer->blobs()[0].get(), this->blob_bottom_};
+  for (int i = 0; i < 2; ++i) {
+    vector<uint16_t> half(rounded[i]->count());
+    ToHalf(HALF_FLOAT16, half.size(), rounded[i]->cpu_data(), &half[0]);
+    FromHalf(HALF_FLOAT16, half.size(), &half[0],
+        rounded[i]->mutable_cpu_data());
+  }
+  Caffe::set_mode(Caffe::CPU);
+  layer->Forward(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  vector<TypeParam> expected(this->blob_top_->cpu_data(),
+      this->blob_top_->cpu_data() + this->blob_top_->count());
+  EXPECT_TRUE(layer->CompactWeights(HALF_FLOAT16));
+  this->blob_bottom_->Compact(HALF_FLOAT16);
+  layer->Forward(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  const TypeParam* top_data = this->blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], expected[i], 1e-4);
+  }
+  this->blob_top_->Compact(HALF_FLOAT16);
+  layer->Reshape(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  layer->Forward(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  this->blob_top_->Expand();
+  top_data = this->blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], expected[i], 1e-3 * fabs(expected[i]) + 1e-4);
+  }
+}
+
 TYPED_TEST(Convolution3DLayerTest, TestGPUSimpleConvolution3D) {
   // We will simply see if the convolution layer carries out averaging well.
   FillerParameter filler_param;
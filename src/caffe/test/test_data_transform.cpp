@@ -0,0 +1,151 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "caffe/common.hpp"
+#include "caffe/util/data_transform.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class DataTransformTest : public ::testing::Test {
+ protected:
+  // A crop of 21 covers one full SIMD block plus a scalar tail per row.
+  DataTransformTest()
+      : channels_(2), length_(3), height_(24), width_(27), crop_size_(21),
+        scale_(0.5) {
+    size_ = channels_ * length_ * height_ * width_;
+    data_.resize(size_);
+    mean_.resize(size_);
+    for (int i = 0; i < size_; ++i) {
+      data_[i] = static_cast<uint8_t>((i * 29 + 7) % 256);
+      mean_[i] = static_cast<Dtype>((i * 13) % 251) / 3;
+    }
+  }
+
+  // The per-element loop the data layers used before.
+  void ReferenceTransform(const int h_off, const int w_off, const bool mirror,
+      Dtype* top_data, char* show_buffer) {
+    for (int c = 0; c < channels_; ++c) {
+      for (int l = 0; l < length_; ++l) {
+        for (int h = 0; h < crop_size_; ++h) {
+          for (int w = 0; w < crop_size_; ++w) {
+            const int out_w = mirror ? crop_size_ - 1 - w : w;
+            const int top_index =
+                ((c * length_ + l) * crop_size_ + h) * crop_size_ + out_w;
+            const int data_index =
+                ((c * length_ + l) * height_ + h + h_off) * width_ + w + w_off;
+            top_data[top_index] =
+                (static_cast<Dtype>(data_[data_index]) - mean_[data_index])
+                * scale_;
+            show_buffer[top_index] = data_[data_index];
+          }
+        }
+      }
+    }
+  }
+
+  void TestCrop(const bool mirror) {
+    const int h_off = 2;
+    const int w_off = 5;
+    const int top_size = channels_ * length_ * crop_size_ * crop_size_;
+    std::vector<Dtype> expected(top_size), actual(top_size);
+    std::vector<char> expected_show(top_size), actual_show(top_size);
+    ReferenceTransform(h_off, w_off, mirror, &expected[0], &expected_show[0]);
+    TransformVolumeData(&data_[0], &mean_[0], channels_, length_, height_,
+        width_, crop_size_, h_off, w_off, mirror, scale_, &actual[0],
+        &actual_show[0]);
+    for (int i = 0; i < top_size; ++i) {
+      EXPECT_EQ(expected[i], actual[i]) << "at " << i;
+      EXPECT_EQ(expected_show[i], actual_show[i]) << "at " << i;
+    }
+  }
+
+  // Interleaves the channels of every frame of data_, with padding bytes at
+  // the end of each row as a decoded image may have, then transforms the
+  // frames one by one.
+  void TransformFrames(const int crop_size, const int h_off, const int w_off,
+      const bool mirror, Dtype* top_data) {
+    const int row_stride = width_ * channels_ + 5;
+    std::vector<uint8_t> pixels(height_ * row_stride);
+    for (int l = 0; l < length_; ++l) {
+      for (int c = 0; c < channels_; ++c) {
+        for (int h = 0; h < height_; ++h) {
+          for (int w = 0; w < width_; ++w) {
+            pixels[h * row_stride + w * channels_ + c] =
+                data_[((c * length_ + l) * height_ + h) * width_ + w];
+          }
+        }
+      }
+      TransformInterleavedFrame(&pixels[0], row_stride, &mean_[0], channels_,
+          length_, l, height_, width_, crop_size, h_off, w_off, mirror,
+          scale_, top_data);
+    }
+  }
+
+  void TestInterleaved(const int crop_size, const bool mirror) {
+    const int h_off = crop_size ? 3 : 0;
+    const int w_off = crop_size ? 4 : 0;
+    const int top_size = crop_size ?
+        channels_ * length_ * crop_size * crop_size : size_;
+    std::vector<Dtype> expected(top_size), actual(top_size);
+    TransformVolumeData(&data_[0], &mean_[0], channels_, length_, height_,
+        width_, crop_size, h_off, w_off, mirror, scale_, &expected[0],
+        static_cast<char*>(NULL));
+    TransformFrames(crop_size, h_off, w_off, mirror, &actual[0]);
+    for (int i = 0; i < top_size; ++i) {
+      EXPECT_EQ(expected[i], actual[i]) << "at " << i;
+    }
+  }
+
+  int channels_;
+  int length_;
+  int height_;
+  int width_;
+  int crop_size_;
+  int size_;
+  Dtype scale_;
+  std::vector<uint8_t> data_;
+  std::vector<Dtype> mean_;
+};
+
+typedef ::testing::Types<float, double> Dtypes;
+TYPED_TEST_CASE(DataTransformTest, Dtypes);
+
+TYPED_TEST(DataTransformTest, TestCrop) {
+  this->TestCrop(false);
+}
+
+TYPED_TEST(DataTransformTest, TestCropMirror) {
+  this->TestCrop(true);
+}
+
+TYPED_TEST(DataTransformTest, TestNoCrop) {
+  std::vector<TypeParam> actual(this->size_);
+  TransformVolumeData(&this->data_[0], &this->mean_[0], this->channels_,
+      this->length_, this->height_, this->width_, 0, 0, 0, false,
+      this->scale_, &actual[0], static_cast<char*>(NULL));
+  for (int i = 0; i < this->size_; ++i) {
+    EXPECT_EQ((static_cast<TypeParam>(this->data_[i]) - this->mean_[i])
+        * this->scale_, actual[i]);
+  }
+}
+
+TYPED_TEST(DataTransformTest, TestInterleavedCrop) {
+  this->TestInterleaved(this->crop_size_, false);
+}
+
+TYPED_TEST(DataTransformTest, TestInterleavedCropMirror) {
+  this->TestInterleaved(this->crop_size_, true);
+}
+
+TYPED_TEST(DataTransformTest, TestInterleavedNoCrop) {
+  this->TestInterleaved(0, false);
+}
+
+}  // namespace caffe
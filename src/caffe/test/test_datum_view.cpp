@@ -0,0 +1,120 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <stdint.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/datum_view.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+using std::string;
+
+namespace caffe {
+
+class DatumViewTest : public ::testing::Test {};
+
+TEST_F(DatumViewTest, TestVolumeDatum) {
+  VolumeDatum datum;
+  datum.set_channels(3);
+  datum.set_length(4);
+  datum.set_height(5);
+  datum.set_width(6);
+  datum.set_label(-7);
+  string data;
+  for (int i = 0; i < 3 * 4 * 5 * 6; ++i) {
+    data.push_back(static_cast<char>(i));
+  }
+  datum.set_data(data);
+  const string record = datum.SerializeAsString();
+  DatumView view;
+  ASSERT_TRUE(view.ParseVolumeDatum(record.data(), record.size()));
+  EXPECT_EQ(3, view.channels());
+  EXPECT_EQ(4, view.length());
+  EXPECT_EQ(5, view.height());
+  EXPECT_EQ(6, view.width());
+  EXPECT_EQ(-7, view.label());
+  ASSERT_EQ(data.size(), view.data_size());
+  // The data is not copied out of the record.
+  const uint8_t* begin = reinterpret_cast<const uint8_t*>(record.data());
+  EXPECT_GE(view.data(), begin);
+  EXPECT_LE(view.data() + view.data_size(), begin + record.size());
+  for (int i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(static_cast<uint8_t>(data[i]), view.data()[i]);
+  }
+  EXPECT_EQ(0, view.float_data_size());
+}
+
+TEST_F(DatumViewTest, TestVolumeDatumFloats) {
+  VolumeDatum datum;
+  datum.set_channels(2);
+  datum.set_height(3);
+  datum.set_width(1);
+  for (int i = 0; i < 6; ++i) {
+    datum.add_float_data(i * 0.5);
+  }
+  const string record = datum.SerializeAsString();
+  DatumView view;
+  ASSERT_TRUE(view.ParseVolumeDatum(record.data(), record.size()));
+  // length takes its default.
+  EXPECT_EQ(1, view.length());
+  EXPECT_EQ(0, view.data_size());
+  ASSERT_EQ(6, view.float_data_size());
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(i * 0.5, view.float_data()[i]);
+  }
+  // The float buffer is reset by the next parse.
+  VolumeDatum empty;
+  empty.set_channels(1);
+  const string empty_record = empty.SerializeAsString();
+  ASSERT_TRUE(view.ParseVolumeDatum(empty_record.data(),
+      empty_record.size()));
+  EXPECT_EQ(0, view.float_data_size());
+  EXPECT_EQ(1, view.channels());
+  EXPECT_EQ(0, view.height());
+}
+
+TEST_F(DatumViewTest, TestDatum) {
+  Datum datum;
+  datum.set_channels(2);
+  datum.set_height(3);
+  datum.set_width(4);
+  datum.set_label(9);
+  for (int i = 0; i < 24; ++i) {
+    datum.add_float_data(i);
+  }
+  const string record = datum.SerializeAsString();
+  DatumView view;
+  ASSERT_TRUE(view.ParseDatum(record.data(), record.size()));
+  EXPECT_EQ(2, view.channels());
+  EXPECT_EQ(1, view.length());
+  EXPECT_EQ(3, view.height());
+  EXPECT_EQ(4, view.width());
+  EXPECT_EQ(9, view.label());
+  ASSERT_EQ(24, view.float_data_size());
+  for (int i = 0; i < 24; ++i) {
+    EXPECT_EQ(i, view.float_data()[i]);
+  }
+}
+
+TEST_F(DatumViewTest, TestTruncated) {
+  VolumeDatum datum;
+  datum.set_channels(3);
+  datum.set_data(string(100, 'x'));
+  datum.set_label(1);
+  const string record = datum.SerializeAsString();
+  DatumView view;
+  for (int size = 1; size < record.size(); ++size) {
+    // Every prefix that cuts a field short is rejected.
+    const bool complete = size == 2 || size == record.size() - 2;
+    EXPECT_EQ(complete, view.ParseVolumeDatum(record.data(), size)) << size;
+  }
+  EXPECT_FALSE(view.ParseVolumeDatum(record.data(), 50));
+  EXPECT_EQ(0, view.channels());
+  EXPECT_EQ(0, view.data_size());
+}
+
+}  // namespace caffe
@@ -0,0 +1,86 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include "lmdb.h"
+#include "gtest/gtest.h"
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/db.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+using std::string;
+using std::stringstream;
+
+namespace caffe {
+
+class DatabaseTest : public ::testing::Test {
+ protected:
+  DatabaseTest() : filename_(tmpnam(NULL)) {}
+
+  // Writes records "0", "1", ... with values "value 0", "value 1", ...
+  void FillLMDB(const int num_records) {
+    MDB_env* env;
+    MDB_dbi dbi;
+    MDB_txn* txn;
+    CHECK_EQ(mkdir(filename_.c_str(), 0744), 0);
+    CHECK_EQ(mdb_env_create(&env), MDB_SUCCESS);
+    CHECK_EQ(mdb_env_set_mapsize(env, 1 << 20), MDB_SUCCESS);
+    CHECK_EQ(mdb_env_open(env, filename_.c_str(), 0, 0664), MDB_SUCCESS);
+    CHECK_EQ(mdb_txn_begin(env, NULL, 0, &txn), MDB_SUCCESS);
+    CHECK_EQ(mdb_dbi_open(txn, NULL, 0, &dbi), MDB_SUCCESS);
+    for (int i = 0; i < num_records; ++i) {
+      stringstream key_stream, value_stream;
+      key_stream << i;
+      value_stream << "value " << i;
+      string key_string = key_stream.str();
+      string value_string = value_stream.str();
+      MDB_val key, value;
+      key.mv_size = key_string.size();
+      key.mv_data = &key_string[0];
+      value.mv_size = value_string.size();
+      value.mv_data = &value_string[0];
+      CHECK_EQ(mdb_put(txn, dbi, &key, &value, 0), MDB_SUCCESS);
+    }
+    CHECK_EQ(mdb_txn_commit(txn), MDB_SUCCESS);
+    mdb_env_close(env);
+  }
+
+  string filename_;
+};
+
+TEST_F(DatabaseTest, TestLMDBCursors) {
+  FillLMDB(3);
+  shared_ptr<Database> db(Database::Open(DataParameter_DB_LMDB, filename_));
+  shared_ptr<DatabaseCursor> cursor(db->NewCursor());
+  shared_ptr<DatabaseCursor> other(db->NewCursor());
+  EXPECT_EQ("0", cursor->key());
+  cursor->Next();
+  EXPECT_EQ("1", cursor->key());
+  // Past the last record the cursor starts over.
+  cursor->SeekTo(5);
+  EXPECT_EQ(5, cursor->index());
+  EXPECT_EQ("2", cursor->key());
+  const string value(static_cast<const char*>(cursor->value()),
+      cursor->value_size());
+  EXPECT_EQ("value 2", value);
+  // Cursors are independent.
+  EXPECT_EQ(0, other->index());
+  EXPECT_EQ("0", other->key());
+}
+
+TEST_F(DatabaseTest, TestLMDBErrors) {
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  EXPECT_DEATH(Database::Open(DataParameter_DB_LMDB, filename_),
+      "Failed to open lmdb");
+  FillLMDB(0);
+  shared_ptr<Database> db(Database::Open(DataParameter_DB_LMDB, filename_));
+  EXPECT_DEATH(db->NewCursor(), "The database is empty");
+}
+
+}  // namespace caffe
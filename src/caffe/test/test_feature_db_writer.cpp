@@ -0,0 +1,79 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <leveldb/db.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/feature_db_writer.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class FeatureDBWriterTest : public ::testing::Test {
+ protected:
+  FeatureDBWriterTest() : num_batches_(7), batch_size_(5), dim_(13) {}
+
+  // Writes batches of features whose values encode their index and
+  // dimension, then checks that the database holds exactly those.
+  void TestWrite(const int num_threads, const int queue_size,
+      const bool bulk_load) {
+    const string filename = tmpnam(NULL);
+    {
+      FeatureDBWriter writer(filename, num_threads, queue_size, bulk_load);
+      vector<float> features(batch_size_ * dim_);
+      for (int b = 0; b < num_batches_; ++b) {
+        for (int i = 0; i < features.size(); ++i) {
+          features[i] = b * batch_size_ * dim_ + i;
+        }
+        writer.Write(b * batch_size_, batch_size_, dim_, &features[0]);
+      }
+      writer.Close();
+      EXPECT_EQ(num_batches_ * batch_size_, writer.num_written());
+    }
+    leveldb::DB* db;
+    leveldb::Options options;
+    options.create_if_missing = false;
+    ASSERT_TRUE(leveldb::DB::Open(options, filename, &db).ok());
+    leveldb::Iterator* iter = db->NewIterator(leveldb::ReadOptions());
+    int index = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++index) {
+      EXPECT_EQ(FeatureKey(index), iter->key().ToString());
+      Datum datum;
+      ASSERT_TRUE(datum.ParseFromString(iter->value().ToString()));
+      EXPECT_EQ(1, datum.channels());
+      EXPECT_EQ(dim_, datum.height());
+      EXPECT_EQ(1, datum.width());
+      ASSERT_EQ(dim_, datum.float_data_size());
+      for (int d = 0; d < dim_; ++d) {
+        EXPECT_EQ(index * dim_ + d, datum.float_data(d));
+      }
+    }
+    EXPECT_EQ(num_batches_ * batch_size_, index);
+    delete iter;
+    delete db;
+  }
+
+  int num_batches_;
+  int batch_size_;
+  int dim_;
+};
+
+TEST_F(FeatureDBWriterTest, TestWrite) {
+  this->TestWrite(3, 2, false);
+}
+
+TEST_F(FeatureDBWriterTest, TestWriteBulkLoad) {
+  this->TestWrite(3, 2, true);
+}
+
+TEST_F(FeatureDBWriterTest, TestWriteOneThread) {
+  this->TestWrite(1, 1, false);
+}
+
+}  // namespace caffe
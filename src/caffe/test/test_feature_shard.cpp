@@ -0,0 +1,121 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/util/feature_shard.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class FeatureShardTest : public ::testing::Test {
+ protected:
+  FeatureShardTest()
+      : blob_(new Blob<Dtype>(4, 3, 2, 5, 7)),
+        prefix_(tmpnam(NULL)) {
+    Caffe::set_random_seed(1701);
+    FillerParameter filler_param;
+    filler_param.set_std(10);
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(blob_);
+  }
+  virtual ~FeatureShardTest() {
+    delete blob_;
+    remove((prefix_ + ".index").c_str());
+    for (int i = 0; i < 10; ++i) {
+      std::ostringstream shard;
+      shard << prefix_ << ".shard-0000" << i;
+      remove(shard.str().c_str());
+    }
+  }
+
+  // Writes every item of the blob, then the whole blob, and reads them back.
+  // The shard size limit makes every record start a new shard.
+  void TestWriteRead(const FeatureStorage storage, const bool compress,
+      const Dtype tolerance) {
+    {
+      FeatureShardWriter writer(prefix_, storage, compress, 64);
+      for (int n = 0; n < blob_->num(); ++n) {
+        std::ostringstream key;
+        key << "clip_" << n << ".fc6";
+        writer.Write(key.str(), blob_, n);
+      }
+      writer.Write("all.fc6", blob_);
+    }
+    FeatureShardReader reader(prefix_);
+    EXPECT_EQ(reader.size(), blob_->num() + 1);
+    EXPECT_FALSE(reader.Find("missing.fc6"));
+    Blob<Dtype> feature;
+    EXPECT_FALSE(reader.Read("missing.fc6", &feature));
+    for (int n = 0; n < blob_->num(); ++n) {
+      std::ostringstream key;
+      key << "clip_" << n << ".fc6";
+      const FeatureRecord* record = reader.Find(key.str());
+      ASSERT_TRUE(record);
+      EXPECT_EQ(record->shard, n);
+      ASSERT_TRUE(reader.Read(key.str(), &feature));
+      EXPECT_EQ(feature.num(), 1);
+      EXPECT_EQ(feature.channels(), blob_->channels());
+      EXPECT_EQ(feature.length(), blob_->length());
+      EXPECT_EQ(feature.height(), blob_->height());
+      EXPECT_EQ(feature.width(), blob_->width());
+      for (int i = 0; i < feature.count(); ++i) {
+        const Dtype expected =
+            static_cast<float>(blob_->cpu_data()[blob_->offset(n) + i]);
+        EXPECT_NEAR(expected, feature.cpu_data()[i],
+            tolerance * std::max(Dtype(1), fabs(expected)));
+      }
+    }
+    ASSERT_TRUE(reader.Read("all.fc6", &feature));
+    EXPECT_EQ(feature.count(), blob_->count());
+    for (int i = 0; i < feature.count(); ++i) {
+      const Dtype expected = static_cast<float>(blob_->cpu_data()[i]);
+      EXPECT_NEAR(expected, feature.cpu_data()[i],
+          tolerance * std::max(Dtype(1), fabs(expected)));
+    }
+  }
+
+  Blob<Dtype>* const blob_;
+  string prefix_;
+};
+
+typedef ::testing::Types<float, double> Dtypes;
+TYPED_TEST_CASE(FeatureShardTest, Dtypes);
+
+TYPED_TEST(FeatureShardTest, TestFloat32) {
+  this->TestWriteRead(FEATURE_FLOAT32, false, 0);
+}
+
+TYPED_TEST(FeatureShardTest, TestFloat16) {
+  // Half precision keeps 11 significant bits.
+  this->TestWriteRead(FEATURE_FLOAT16, false, 1e-3);
+}
+
+TYPED_TEST(FeatureShardTest, TestFloat16Compressed) {
+  this->TestWriteRead(FEATURE_FLOAT16, true, 1e-3);
+}
+
+TYPED_TEST(FeatureShardTest, TestLaterRecordWins) {
+  {
+    FeatureShardWriter writer(this->prefix_, FEATURE_FLOAT32, false);
+    writer.Write("clip.fc6", this->blob_, 0);
+    writer.Write("clip.fc6", this->blob_, 1);
+  }
+  FeatureShardReader reader(this->prefix_);
+  EXPECT_EQ(reader.size(), 1);
+  Blob<TypeParam> feature;
+  ASSERT_TRUE(reader.Read("clip.fc6", &feature));
+  EXPECT_EQ(static_cast<float>(this->blob_->cpu_data()[this->blob_->offset(1)]),
+      feature.cpu_data()[0]);
+}
+
+}  // namespace caffe
@@ -0,0 +1,142 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <google/protobuf/text_format.h>
+#include <stdint.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "caffe/common.hpp"
+#include "caffe/net.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/flat_weights.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class FlatWeightsTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    const string& proto =
+        "name: 'TestNetwork' "
+        "input: 'data' "
+        "input_dim: 2 "
+        "input_dim: 3 "
+        "input_dim: 1 "
+        "input_dim: 4 "
+        "input_dim: 5 "
+        "layers: { "
+        "  name: 'innerproduct' "
+        "  type: INNER_PRODUCT "
+        "  inner_product_param { "
+        "    num_output: 7 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 1 "
+        "    } "
+        "    bias_filler { "
+        "      type: 'gaussian' "
+        "      std: 1 "
+        "    } "
+        "  } "
+        "  bottom: 'data' "
+        "  top: 'innerproduct' "
+        "} ";
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto, &net_param_));
+    filename_ = tmpnam(NULL);
+  }
+
+  virtual void TearDown() {
+    remove(filename_.c_str());
+  }
+
+  NetParameter net_param_;
+  string filename_;
+};
+
+typedef ::testing::Types<float, double> Dtypes;
+TYPED_TEST_CASE(FlatWeightsTest, Dtypes);
+
+TYPED_TEST(FlatWeightsTest, TestRoundTrip) {
+  Net<TypeParam> trained(this->net_param_);
+  NetParameter trained_param;
+  trained.ToProto(&trained_param);
+  WriteFlatWeightsFile(trained_param, this->filename_);
+  EXPECT_TRUE(IsFlatWeightsFile(this->filename_));
+
+  FlatWeightsFile file(this->filename_);
+  ASSERT_EQ(file.num_blobs(), 2);
+  EXPECT_EQ(file.entry(0).layer_name, "innerproduct");
+  EXPECT_EQ(file.entry(1).blob_id, 1);
+  for (int i = 0; i < file.num_blobs(); ++i) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(file.data(i))
+        % kFlatWeightsAlignment, 0);
+  }
+
+  // The second net starts from different random weights.
+  Net<TypeParam> loaded(this->net_param_);
+  loaded.CopyTrainedLayersFrom(this->filename_);
+  const vector<shared_ptr<Blob<TypeParam> > >& trained_params =
+      trained.params();
+  const vector<shared_ptr<Blob<TypeParam> > >& loaded_params =
+      loaded.params();
+  ASSERT_EQ(trained_params.size(), loaded_params.size());
+  for (int i = 0; i < trained_params.size(); ++i) {
+    ASSERT_EQ(trained_params[i]->count(), loaded_params[i]->count());
+    for (int j = 0; j < trained_params[i]->count(); ++j) {
+      EXPECT_EQ(static_cast<float>(trained_params[i]->cpu_data()[j]),
+          loaded_params[i]->cpu_data()[j]);
+    }
+  }
+  // Writing to the loaded weights must not change the file.
+  loaded_params[0]->mutable_cpu_data()[0] += 1;
+  FlatWeightsFile reread(this->filename_);
+  EXPECT_EQ(static_cast<float>(trained_params[0]->cpu_data()[0]),
+      reread.data(0)[0]);
+}
+
+TYPED_TEST(FlatWeightsTest, TestReplicaOutlivesLoadedNet) {
+  Caffe::set_mode(Caffe::CPU);
+  Net<TypeParam> trained(this->net_param_);
+  NetParameter trained_param;
+  trained.ToProto(&trained_param);
+  WriteFlatWeightsFile(trained_param, this->filename_);
+  Blob<TypeParam>* input = trained.input_blobs()[0];
+  for (int i = 0; i < input->count(); ++i) {
+    input->mutable_cpu_data()[i] = i * 0.1;
+  }
+  const Blob<TypeParam>* expected = trained.ForwardPrefilled()[0];
+
+  // The replica shares the weights of a net that loaded the file, and keeps
+  // working after that net is gone.
+  Net<TypeParam> replica(this->net_param_);
+  {
+    Net<TypeParam> loaded(this->net_param_);
+    loaded.CopyTrainedLayersFrom(this->filename_);
+    replica.ShareTrainedLayersWith(&loaded);
+  }
+  replica.input_blobs()[0]->CopyFrom(*input);
+  const Blob<TypeParam>* output = replica.ForwardPrefilled()[0];
+  ASSERT_EQ(expected->count(), output->count());
+  for (int i = 0; i < output->count(); ++i) {
+    EXPECT_NEAR(expected->cpu_data()[i], output->cpu_data()[i], 1e-4);
+  }
+}
+
+TEST(FlatWeightsFileTest, TestNotFlat) {
+  const string filename = tmpnam(NULL);
+  NetParameter param;
+  param.set_name("not flat");
+  FILE* file = fopen(filename.c_str(), "wb");
+  const string serialized = param.SerializeAsString();
+  fwrite(serialized.data(), 1, serialized.size(), file);
+  fclose(file);
+  EXPECT_FALSE(IsFlatWeightsFile(filename));
+  remove(filename.c_str());
+}
+
+}  // namespace caffe
@@ -0,0 +1,86 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <stdint.h>
+
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "caffe/util/float16.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+TEST(Float16Test, TestValues) {
+  EXPECT_EQ(FloatToHalf(0.f), 0x0000);
+  EXPECT_EQ(FloatToHalf(-0.f), 0x8000);
+  EXPECT_EQ(FloatToHalf(1.f), 0x3c00);
+  EXPECT_EQ(FloatToHalf(-2.f), 0xc000);
+  EXPECT_EQ(FloatToHalf(65504.f), 0x7bff);
+  // Halfway between 65504 and 65536 rounds to even, i.e. to infinity.
+  EXPECT_EQ(FloatToHalf(65519.f), 0x7bff);
+  EXPECT_EQ(FloatToHalf(65520.f), 0x7c00);
+  EXPECT_EQ(FloatToHalf(INFINITY), 0x7c00);
+  EXPECT_EQ(FloatToHalf(-INFINITY), 0xfc00);
+  EXPECT_TRUE(std::isnan(HalfToFloat(FloatToHalf(NAN))));
+  // Smallest subnormal, and half of it, which rounds to even (zero).
+  EXPECT_EQ(FloatToHalf(ldexpf(1.f, -24)), 0x0001);
+  EXPECT_EQ(FloatToHalf(ldexpf(1.f, -25)), 0x0000);
+  EXPECT_EQ(FloatToHalf(ldexpf(3.f, -25)), 0x0002);
+  // 1 + 2^-11 is halfway between 1 and the next half: ties to even.
+  EXPECT_EQ(FloatToHalf(1.f + ldexpf(1.f, -11)), 0x3c00);
+  EXPECT_EQ(FloatToHalf(1.f + ldexpf(3.f, -11)), 0x3c02);
+}
+
+TEST(Float16Test, TestRoundTrip) {
+  // Every finite half converts to a float and back unchanged.
+  for (int i = 0; i < 65536; ++i) {
+    const uint16_t value = i;
+    if ((value & 0x7c00) == 0x7c00 && (value & 0x3ff)) {
+      continue;  // NaN
+    }
+    EXPECT_EQ(FloatToHalf(HalfToFloat(value)), value);
+  }
+}
+
+TEST(Float16Test, TestBfloat16Values) {
+  EXPECT_EQ(FloatToBfloat16(1.f), 0x3f80);
+  EXPECT_EQ(FloatToBfloat16(-2.f), 0xc000);
+  EXPECT_EQ(Bfloat16ToFloat(0x3f80), 1.f);
+  // 1 + 2^-8 is halfway between 1 and the next bfloat16: ties to even.
+  EXPECT_EQ(FloatToBfloat16(1.f + ldexpf(1.f, -8)), 0x3f80);
+  EXPECT_EQ(FloatToBfloat16(1.f + ldexpf(3.f, -8)), 0x3f82);
+  EXPECT_EQ(FloatToBfloat16(INFINITY), 0x7f80);
+  EXPECT_TRUE(std::isnan(Bfloat16ToFloat(FloatToBfloat16(NAN))));
+}
+
+TEST(Float16Test, TestFromHalf) {
+  // The vectorized bulk conversion agrees with the scalar one on every
+  // value, including the tail after the last full vector.
+  std::vector<uint16_t> values(65536 + 5);
+  for (int i = 0; i < values.size(); ++i) {
+    values[i] = i;
+  }
+  std::vector<float> converted(values.size());
+  FromHalf(HALF_FLOAT16, values.size(), &values[0], &converted[0]);
+  for (int i = 0; i < values.size(); ++i) {
+    const float expected = HalfToFloat(values[i]);
+    if (std::isnan(expected)) {
+      EXPECT_TRUE(std::isnan(converted[i]));
+    } else {
+      EXPECT_EQ(expected, converted[i]);
+    }
+  }
+  FromHalf(HALF_BFLOAT16, values.size(), &values[0], &converted[0]);
+  for (int i = 0; i < values.size(); ++i) {
+    const float expected = Bfloat16ToFloat(values[i]);
+    if (std::isnan(expected)) {
+      EXPECT_TRUE(std::isnan(converted[i]));
+    } else {
+      EXPECT_EQ(expected, converted[i]);
+    }
+  }
+}
+
+}  // namespace caffe
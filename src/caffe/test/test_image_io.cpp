@@ -0,0 +1,149 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "caffe/common.hpp"
+#include "caffe/util/image_io.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+const int kLength = 16;
+
+class ImageIOTest : public ::testing::Test {
+ protected:
+  // Checks that segment_frames[seg_id] is first, first + 1, ..., last.
+  void ExpectConsecutive(const int seg_id, const int first, const int last) {
+    const std::vector<int>& frames = segment_frames_[seg_id];
+    ASSERT_EQ(frames.size(), kLength);
+    for (int i = 0; i < kLength; ++i) {
+      EXPECT_EQ(std::min(first + i, last), frames[i])
+          << "segment " << seg_id << " at " << i;
+    }
+  }
+
+  std::vector<std::vector<int> > segment_frames_;
+};
+
+TEST_F(ImageIOTest, TestPlanShortVideo) {
+  // Fewer frames than a clip: every segment repeats the last frame.
+  PlanImageSequenceSegments(10, kLength, 4, false, &this->segment_frames_);
+  ASSERT_EQ(this->segment_frames_.size(), 4);
+  for (int seg_id = 0; seg_id < 4; ++seg_id) {
+    this->ExpectConsecutive(seg_id, 1, 10);
+  }
+}
+
+TEST_F(ImageIOTest, TestPlanOverlappingThirds) {
+  // 40 frames are too few for three disjoint 16-frame thirds.
+  PlanImageSequenceSegments(40, kLength, 4, false, &this->segment_frames_);
+  ASSERT_EQ(this->segment_frames_.size(), 4);
+  this->ExpectConsecutive(0, 1, 16);
+  this->ExpectConsecutive(1, 13, 28);
+  this->ExpectConsecutive(2, 25, 40);
+  // The whole video, sampled every 2.5 frames.
+  const std::vector<int>& whole = this->segment_frames_[3];
+  EXPECT_EQ(1, whole[0]);
+  EXPECT_EQ(3, whole[1]);
+  EXPECT_EQ(5, whole[2]);
+  EXPECT_EQ(40, whole[kLength - 1]);
+}
+
+TEST_F(ImageIOTest, TestPlanThirds) {
+  PlanImageSequenceSegments(48, kLength, 4, false, &this->segment_frames_);
+  ASSERT_EQ(this->segment_frames_.size(), 4);
+  this->ExpectConsecutive(0, 1, 16);
+  this->ExpectConsecutive(1, 17, 32);
+  this->ExpectConsecutive(2, 33, 48);
+}
+
+TEST_F(ImageIOTest, TestPlanSegmentCounts) {
+  // One segment is the whole video.
+  PlanImageSequenceSegments(48, kLength, 1, false, &this->segment_frames_);
+  ASSERT_EQ(this->segment_frames_.size(), 1);
+  EXPECT_EQ(1, this->segment_frames_[0][0]);
+  EXPECT_EQ(3, this->segment_frames_[0][1]);
+  EXPECT_EQ(48, this->segment_frames_[0][kLength - 1]);
+  // Three segments are two overlapping halves and the whole video.
+  PlanImageSequenceSegments(20, kLength, 3, false, &this->segment_frames_);
+  ASSERT_EQ(this->segment_frames_.size(), 3);
+  this->ExpectConsecutive(0, 1, 16);
+  this->ExpectConsecutive(1, 5, 20);
+}
+
+TEST_F(ImageIOTest, TestReadSegmentsMatchesPerSegment) {
+  // 24 frames of 8x6 in a scratch directory, each of its own color.
+  char dir_template[] = "/tmp/caffe_test_frames.XXXXXX";
+  const char* dir = mkdtemp(dir_template);
+  ASSERT_TRUE(dir != NULL);
+  const int kFrames = 24;
+  char filename[256];
+  for (int i = 1; i <= kFrames; ++i) {
+    cv::Mat img(6, 8, CV_8UC3, cv::Scalar(10 * i, 200 - 5 * i, 7 * i));
+    sprintf(filename, "%s/%06d.jpg", dir, i);
+    ASSERT_TRUE(cv::imwrite(filename, img));
+  }
+  PlanImageSequenceSegments(kFrames, kLength, 4, false, &this->segment_frames_);
+  std::vector<VolumeDatum> datums;
+  ASSERT_TRUE(ReadImageSegmentsToVolumeData(dir, this->segment_frames_, 3, 0,
+      0, &datums));
+  ASSERT_EQ(datums.size(), 4);
+  for (int seg_id = 0; seg_id < 4; ++seg_id) {
+    VolumeDatum expected;
+    ASSERT_TRUE(ReadImageFramesToVolumeDatum(dir,
+        this->segment_frames_[seg_id], 3, 0, 0, &expected));
+    EXPECT_EQ(expected.channels(), datums[seg_id].channels());
+    EXPECT_EQ(expected.length(), datums[seg_id].length());
+    EXPECT_EQ(expected.height(), datums[seg_id].height());
+    EXPECT_EQ(expected.width(), datums[seg_id].width());
+    EXPECT_EQ(expected.label(), datums[seg_id].label());
+    EXPECT_TRUE(expected.data() == datums[seg_id].data()) << "segment "
+        << seg_id;
+  }
+  for (int i = 1; i <= kFrames; ++i) {
+    sprintf(filename, "%s/%06d.jpg", dir, i);
+    remove(filename);
+  }
+  remove(dir);
+}
+
+TEST_F(ImageIOTest, TestReducedDecode) {
+  // A smooth 256x344 gradient read at 64x86: the 1/2 and 1/4 decodes are
+  // candidates, and either has to stay close to the full-size decode.
+  char filename[] = "/tmp/caffe_test_frame.XXXXXX.jpg";
+  const int fd = mkstemps(filename, 4);
+  ASSERT_NE(fd, -1);
+  close(fd);
+  cv::Mat img(256, 344, CV_8UC3);
+  for (int h = 0; h < img.rows; ++h) {
+    for (int w = 0; w < img.cols; ++w) {
+      img.at<cv::Vec3b>(h, w) = cv::Vec3b(h / 2, w / 2, (h + w) / 4);
+    }
+  }
+  ASSERT_TRUE(cv::imwrite(filename, img));
+  cv::Mat full, reduced;
+  ASSERT_TRUE(ReadImageFrame(filename, 64, 86, false, &full));
+  ASSERT_TRUE(ReadImageFrame(filename, 64, 86, true, &reduced));
+  ASSERT_EQ(64, reduced.rows);
+  ASSERT_EQ(86, reduced.cols);
+  for (int h = 0; h < 64; ++h) {
+    for (int w = 0; w < 86; ++w) {
+      for (int c = 0; c < 3; ++c) {
+        EXPECT_NEAR(full.at<cv::Vec3b>(h, w)[c],
+            reduced.at<cv::Vec3b>(h, w)[c], 8);
+      }
+    }
+  }
+  remove(filename);
+}
+
+}  // namespace caffe
@@ -75,6 +75,34 @@ TYPED_TEST(InnerProductLayerTest, TestCPU) {
   }
 }
 
+TYPED_TEST(InnerProductLayerTest, TestCPUCompactWeights) {
+  // Compact weights must give the output of the full-precision layer on the
+  // same rounded weights.
+  LayerParameter layer_param;
+  InnerProductParameter* inner_product_param =
+      layer_param.mutable_inner_product_param();
+  Caffe::set_mode(Caffe::CPU);
+  inner_product_param->set_num_output(10);
+  inner_product_param->mutable_weight_filler()->set_type("uniform");
+  inner_product_param->mutable_bias_filler()->set_type("uniform");
+  shared_ptr<InnerProductLayer<TypeParam> > layer(
+      new InnerProductLayer<TypeParam>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  Blob<TypeParam>* weights = layer->blobs()[0].get();
+  vector<uint16_t> half(weights->count());
+  ToHalf(HALF_BFLOAT16, half.size(), weights->cpu_data(), &half[0]);
+  FromHalf(HALF_BFLOAT16, half.size(), &half[0], weights->mutable_cpu_data());
+  layer->Forward(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  vector<TypeParam> expected(this->blob_top_->cpu_data(),
+      this->blob_top_->cpu_data() + this->blob_top_->count());
+  EXPECT_TRUE(layer->CompactWeights(HALF_BFLOAT16));
+  layer->Forward(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  const TypeParam* data = this->blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(data[i], expected[i], 1e-5);
+  }
+}
+
 TYPED_TEST(InnerProductLayerTest, TestGPU) {
   if (sizeof(TypeParam) == 4 || CAFFE_TEST_CUDA_PROP.major >= 2) {
     LayerParameter layer_param;
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "caffe/filler.hpp"
+#include "caffe/util/math_functions.hpp"
 #include "caffe/vision_layers.hpp"
 #include "caffe/test/test_caffe_main.hpp"
 
@@ -105,4 +106,44 @@ TYPED_TEST(MemoryDataLayerTest, TestForward) {
   }
 }
 
+// clips of several frames come out as 5-D blobs, one clip after another
+TYPED_TEST(MemoryDataLayerTest, TestForwardClips) {
+  const int length = 3;
+  LayerParameter layer_param;
+  MemoryDataParameter* md_param = layer_param.mutable_memory_data_param();
+  md_param->set_batch_size(this->batch_size_);
+  md_param->set_channels(this->channels_);
+  md_param->set_length(length);
+  md_param->set_height(this->height_);
+  md_param->set_width(this->width_);
+  shared_ptr<MemoryDataLayer<TypeParam> > layer(
+      new MemoryDataLayer<TypeParam>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  EXPECT_EQ(this->data_blob_->num(), this->batch_size_);
+  EXPECT_EQ(this->data_blob_->channels(), this->channels_);
+  EXPECT_EQ(this->data_blob_->length(), length);
+  EXPECT_EQ(this->data_blob_->height(), this->height_);
+  EXPECT_EQ(this->data_blob_->width(), this->width_);
+  EXPECT_EQ(layer->datum_length(), length);
+  const int num_clips = this->batches_ * this->batch_size_ / length;
+  Blob<TypeParam> clips(num_clips, this->channels_, length, this->height_,
+      this->width_);
+  caffe_copy(clips.count(), this->data_->cpu_data(),
+      clips.mutable_cpu_data());
+  layer->Reset(clips.mutable_cpu_data(), this->labels_->mutable_cpu_data(),
+      num_clips);
+  for (int i = 0; i < 2 * num_clips / this->batch_size_; ++i) {
+    int batch_num = i % (num_clips / this->batch_size_);
+    layer->Forward(this->blob_bottom_vec_, &(this->blob_top_vec_));
+    for (int j = 0; j < this->data_blob_->count(); ++j) {
+      EXPECT_EQ(this->data_blob_->cpu_data()[j],
+          clips.cpu_data()[clips.offset(this->batch_size_ * batch_num) + j]);
+    }
+    for (int j = 0; j < this->label_blob_->count(); ++j) {
+      EXPECT_EQ(this->label_blob_->cpu_data()[j],
+          this->labels_->cpu_data()[this->batch_size_ * batch_num + j]);
+    }
+  }
+}
+
 }  // namespace caffe
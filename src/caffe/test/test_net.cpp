@@ -2,11 +2,17 @@
 
 #include <google/protobuf/text_format.h>
 #include <leveldb/db.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "caffe/common.hpp"
+#include "caffe/filler.hpp"
 #include "caffe/net.hpp"
 #include "caffe/test/test_gradient_check_util.hpp"
 
@@ -133,4 +139,327 @@ TYPED_TEST(NetTest, TestGetLayerByName) {
   EXPECT_FALSE(net.layer_by_name("label"));
 }
 
+TYPED_TEST(NetTest, TestSharedWorkspace) {
+  const string& proto =
+      "name: 'TestNetwork' "
+      "input: 'data' "
+      "input_dim: 2 input_dim: 3 input_dim: 1 input_dim: 8 input_dim: 8 "
+      "layers: { "
+      "  name: 'conv1' "
+      "  type: CONVOLUTION3D "
+      "  convolution_param { "
+      "    num_output: 4 kernel_size: 3 kernel_depth: 1 pad: 1 "
+      "    weight_filler { type: 'gaussian' std: 0.01 } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'conv1' "
+      "} "
+      "layers: { "
+      "  name: 'conv2' "
+      "  type: CONVOLUTION "
+      "  convolution_param { "
+      "    num_output: 4 kernel_size: 5 "
+      "    weight_filler { type: 'gaussian' std: 0.01 } "
+      "  } "
+      "  bottom: 'conv1' "
+      "  top: 'conv2' "
+      "} ";
+  NetParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+  Net<TypeParam> net(param);
+  const size_t conv1_bytes = 3 * 3 * 3 * 8 * 8 * sizeof(TypeParam);
+  const size_t conv2_bytes = 4 * 5 * 5 * 4 * 4 * sizeof(TypeParam);
+  EXPECT_EQ(conv1_bytes, net.layer_by_name("conv1")->workspace_bytes());
+  EXPECT_EQ(conv2_bytes, net.layer_by_name("conv2")->workspace_bytes());
+  EXPECT_EQ(std::max(conv1_bytes, conv2_bytes), net.workspace_size());
+  Caffe::set_mode(Caffe::CPU);
+  net.ForwardPrefilled();
+  EXPECT_EQ(std::max(conv1_bytes, conv2_bytes), net.workspace_size());
+}
+
+TYPED_TEST(NetTest, TestCompactWeights) {
+  const string& proto =
+      "name: 'TestNetwork' "
+      "input: 'data' "
+      "input_dim: 2 input_dim: 3 input_dim: 1 input_dim: 8 input_dim: 8 "
+      "layers: { "
+      "  name: 'conv1' "
+      "  type: CONVOLUTION3D "
+      "  convolution_param { "
+      "    num_output: 4 kernel_size: 3 kernel_depth: 1 pad: 1 "
+      "    weight_filler { type: 'gaussian' std: 0.01 } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'conv1' "
+      "} "
+      "layers: { "
+      "  name: 'fc2' "
+      "  type: INNER_PRODUCT "
+      "  inner_product_param { "
+      "    num_output: 5 "
+      "    weight_filler { type: 'gaussian' std: 0.01 } "
+      "  } "
+      "  bottom: 'conv1' "
+      "  top: 'fc2' "
+      "} ";
+  NetParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+  Net<TypeParam> net(param);
+  Caffe::set_mode(Caffe::CPU);
+  const int num_weights = 4 * 3 * 3 * 3 + 5 * 4 * 8 * 8;
+  EXPECT_EQ(num_weights * (sizeof(TypeParam) - sizeof(uint16_t)),
+      net.CompactWeights(HALF_FLOAT16));
+  EXPECT_TRUE(net.layer_by_name("conv1")->blobs()[0]->compact());
+  EXPECT_TRUE(net.layer_by_name("fc2")->blobs()[0]->compact());
+  const vector<Blob<TypeParam>*>& output = net.ForwardPrefilled();
+  EXPECT_FALSE(output[0]->compact());
+  EXPECT_EQ(2 * 5, output[0]->count());
+}
+
+TYPED_TEST(NetTest, TestCompactActivations) {
+  const string& proto =
+      "name: 'TestNetwork' "
+      "input: 'data' "
+      "input_dim: 2 input_dim: 3 input_dim: 1 input_dim: 8 input_dim: 8 "
+      "layers: { "
+      "  name: 'conv1' "
+      "  type: CONVOLUTION3D "
+      "  convolution_param { "
+      "    num_output: 4 kernel_size: 3 kernel_depth: 1 pad: 1 "
+      "    weight_filler { type: 'gaussian' std: 0.1 } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'conv1' "
+      "} "
+      "layers: { "
+      "  name: 'relu1' "
+      "  type: RELU "
+      "  bottom: 'conv1' "
+      "  top: 'conv1' "
+      "} "
+      "layers: { "
+      "  name: 'conv2' "
+      "  type: CONVOLUTION3D "
+      "  convolution_param { "
+      "    num_output: 4 kernel_size: 3 kernel_depth: 1 pad: 1 "
+      "    weight_filler { type: 'gaussian' std: 0.1 } "
+      "  } "
+      "  bottom: 'conv1' "
+      "  top: 'conv2' "
+      "} "
+      "layers: { "
+      "  name: 'fc3' "
+      "  type: INNER_PRODUCT "
+      "  inner_product_param { "
+      "    num_output: 5 "
+      "    weight_filler { type: 'gaussian' std: 0.1 } "
+      "  } "
+      "  bottom: 'conv2' "
+      "  top: 'fc3' "
+      "} ";
+  NetParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+  Caffe::set_mode(Caffe::CPU);
+  Net<TypeParam> full_net(param);
+  Net<TypeParam> compact_net(param);
+  compact_net.ShareTrainedLayersWith(&full_net);
+  FillerParameter filler_param;
+  GaussianFiller<TypeParam> filler(filler_param);
+  filler.Fill(full_net.input_blobs()[0]);
+  compact_net.input_blobs()[0]->CopyFrom(*full_net.input_blobs()[0]);
+  const vector<Blob<TypeParam>*>& full_output = full_net.ForwardPrefilled();
+  // The net input and output stay full precision.
+  const int num_activations = 2 * (2 * 4 * 8 * 8);
+  EXPECT_EQ(num_activations * (sizeof(TypeParam) - sizeof(uint16_t)),
+      compact_net.CompactActivations(HALF_FLOAT16));
+  EXPECT_FALSE(compact_net.blob_by_name("data")->compact());
+  EXPECT_TRUE(compact_net.blob_by_name("conv1")->compact());
+  EXPECT_TRUE(compact_net.blob_by_name("conv2")->compact());
+  EXPECT_FALSE(compact_net.blob_by_name("fc3")->compact());
+  // Compact activations, then compact weights as well, stay close to the
+  // full-precision output.
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass == 1) {
+      compact_net.CompactWeights(HALF_FLOAT16);
+    }
+    const vector<Blob<TypeParam>*>& output = compact_net.ForwardPrefilled();
+    ASSERT_EQ(full_output[0]->count(), output[0]->count());
+    for (int i = 0; i < output[0]->count(); ++i) {
+      const TypeParam expected = full_output[0]->cpu_data()[i];
+      EXPECT_NEAR(expected, output[0]->cpu_data()[i],
+          1e-2 * fabs(expected) + 1e-3);
+    }
+  }
+}
+
+TYPED_TEST(NetTest, TestConcatViews) {
+  const string& proto =
+      "name: 'TestNetwork' "
+      "input: 'data' "
+      "input_dim: 2 input_dim: 3 input_dim: 1 input_dim: 2 input_dim: 2 "
+      "layers: { "
+      "  name: 'ip1' "
+      "  type: INNER_PRODUCT "
+      "  inner_product_param { "
+      "    num_output: 4 "
+      "    weight_filler { type: 'constant' value: 1 } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'ip1' "
+      "} "
+      "layers: { "
+      "  name: 'ip2' "
+      "  type: INNER_PRODUCT "
+      "  inner_product_param { "
+      "    num_output: 4 "
+      "    weight_filler { type: 'constant' value: 2 } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'ip2' "
+      "} "
+      "layers: { "
+      "  name: 'concat' "
+      "  type: CONCAT "
+      "  concat_param { concat_dim: 0 } "
+      "  bottom: 'ip1' "
+      "  bottom: 'ip2' "
+      "  top: 'concat' "
+      "} ";
+  NetParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+  Net<TypeParam> net(param);
+  const Blob<TypeParam>& ip1 = *net.blob_by_name("ip1");
+  const Blob<TypeParam>& ip2 = *net.blob_by_name("ip2");
+  const Blob<TypeParam>& concat = *net.blob_by_name("concat");
+  EXPECT_TRUE(ip1.DataIsViewOf(concat, 0));
+  EXPECT_TRUE(ip2.DataIsViewOf(concat, ip1.count()));
+  Blob<TypeParam>* data = net.input_blobs()[0];
+  for (int i = 0; i < data->count(); ++i) {
+    data->mutable_cpu_data()[i] = i;
+  }
+  Caffe::set_mode(Caffe::CPU);
+  net.ForwardPrefilled();
+  ASSERT_EQ(4, concat.num());
+  for (int n = 0; n < 4; ++n) {
+    // Each output is the sum of the 12 inputs of its volume, times 2 for ip2.
+    const int first = (n % 2) * 12;
+    const TypeParam sum = (n / 2 + 1) * (first * 12 + 66);
+    for (int c = 0; c < 4; ++c) {
+      EXPECT_EQ(sum, concat.data_at(n, c, 0, 0, 0));
+    }
+  }
+}
+
+template <typename Dtype>
+struct ReplicaThreadArgs {
+  Net<Dtype>* replica;
+  Caffe::Phase phase;
+  unsigned int seed;
+  const Blob<Dtype>* input;
+  // The outputs of every iteration, concatenated.
+  vector<Dtype> outputs;
+};
+
+// Runs a replica in its own thread context and records what it computes.
+template <typename Dtype>
+static void RunReplica(ReplicaThreadArgs<Dtype>* args, const int iters) {
+  Caffe::set_phase(args->phase);
+  Caffe::set_random_seed(args->seed);
+  args->outputs.clear();
+  for (int i = 0; i < iters; ++i) {
+    args->replica->input_blobs()[0]->CopyFrom(*args->input);
+    const Blob<Dtype>* output = args->replica->ForwardPrefilled()[0];
+    args->outputs.insert(args->outputs.end(), output->cpu_data(),
+        output->cpu_data() + output->count());
+  }
+}
+
+static const int kReplicaIters = 20;
+
+template <typename Dtype>
+static void* ReplicaThread(void* arg) {
+  Caffe::InitThreadContext();
+  RunReplica(static_cast<ReplicaThreadArgs<Dtype>*>(arg), kReplicaIters);
+  return static_cast<void*>(NULL);
+}
+
+TYPED_TEST(NetTest, TestConcurrentReplicas) {
+  const string& proto =
+      "name: 'TestNetwork' "
+      "input: 'data' "
+      "input_dim: 2 input_dim: 3 input_dim: 2 input_dim: 6 input_dim: 6 "
+      "layers: { "
+      "  name: 'conv' "
+      "  type: CONVOLUTION3D "
+      "  convolution_param { "
+      "    num_output: 4 kernel_size: 3 kernel_depth: 2 "
+      "    weight_filler { type: 'gaussian' std: 0.1 } "
+      "    bias_filler { type: 'gaussian' std: 0.1 } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'conv' "
+      "} "
+      "layers: { "
+      "  name: 'drop' "
+      "  type: DROPOUT "
+      "  bottom: 'conv' "
+      "  top: 'conv' "
+      "} "
+      "layers: { "
+      "  name: 'ip' "
+      "  type: INNER_PRODUCT "
+      "  inner_product_param { "
+      "    num_output: 5 "
+      "    weight_filler { type: 'gaussian' std: 0.1 } "
+      "  } "
+      "  bottom: 'conv' "
+      "  top: 'ip' "
+      "} ";
+  NetParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+  Caffe::set_mode(Caffe::CPU);
+  Caffe::set_random_seed(1701);
+  Net<TypeParam> net(param);
+  const int num_threads = 6;
+  vector<shared_ptr<Net<TypeParam> > > replicas(num_threads);
+  vector<shared_ptr<Blob<TypeParam> > > inputs(num_threads);
+  vector<ReplicaThreadArgs<TypeParam> > args(num_threads);
+  FillerParameter filler_param;
+  GaussianFiller<TypeParam> filler(filler_param);
+  for (int i = 0; i < num_threads; ++i) {
+    replicas[i].reset(new Net<TypeParam>(param));
+    replicas[i]->ShareTrainedLayersWith(&net);
+    inputs[i].reset(new Blob<TypeParam>());
+    inputs[i]->ReshapeLike(*net.input_blobs()[0]);
+    filler.Fill(inputs[i].get());
+    args[i].replica = replicas[i].get();
+    args[i].phase = (i % 2) ? Caffe::TEST : Caffe::TRAIN;
+    args[i].seed = 1000 + i;
+    args[i].input = inputs[i].get();
+  }
+  // The expected outputs, computed one replica after another on this thread.
+  vector<vector<TypeParam> > expected(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    RunReplica(&args[i], kReplicaIters);
+    expected[i].swap(args[i].outputs);
+  }
+  Caffe::set_phase(Caffe::TRAIN);
+  vector<pthread_t> threads(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    ASSERT_FALSE(pthread_create(&threads[i], NULL, ReplicaThread<TypeParam>,
+        &args[i]));
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    ASSERT_FALSE(pthread_join(threads[i], NULL));
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    ASSERT_EQ(expected[i].size(), args[i].outputs.size());
+    for (int j = 0; j < expected[i].size(); ++j) {
+      EXPECT_EQ(expected[i][j], args[i].outputs[j]);
+    }
+  }
+  // The threads' phases did not leak into this one.
+  EXPECT_EQ(Caffe::TRAIN, Caffe::phase());
+}
+
 }  // namespace caffe
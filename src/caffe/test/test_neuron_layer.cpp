@@ -8,6 +8,7 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
+#include "caffe/util/math_functions.hpp"
 #include "caffe/vision_layers.hpp"
 #include "caffe/test/test_gradient_check_util.hpp"
 
@@ -168,6 +169,42 @@ TYPED_TEST(NeuronLayerTest, TestDropoutCPU) {
 }
 
 
+TYPED_TEST(NeuronLayerTest, TestDropoutCPUReproducible) {
+  LayerParameter layer_param;
+  Caffe::set_mode(Caffe::CPU);
+  Caffe::set_phase(Caffe::TRAIN);
+  DropoutLayer<TypeParam> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  const int count = this->blob_top_->count();
+  vector<TypeParam> first(count);
+  Caffe::set_random_seed(1701);
+  layer.Forward(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  caffe_copy(count, this->blob_top_->cpu_data(), &first[0]);
+  // The next pass draws a different mask ...
+  layer.Forward(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  int same = 0;
+  for (int i = 0; i < count; ++i) {
+    same += (first[i] == this->blob_top_->cpu_data()[i]);
+  }
+  EXPECT_LT(same, count);
+  // ... and the same seed the same one, which backward applies too.
+  Caffe::set_random_seed(1701);
+  layer.Forward(this->blob_bottom_vec_, &(this->blob_top_vec_));
+  caffe_copy(count, this->blob_bottom_->cpu_data(),
+      this->blob_top_->mutable_cpu_diff());
+  layer.Backward(this->blob_top_vec_, true, &(this->blob_bottom_vec_));
+  int kept = 0;
+  for (int i = 0; i < count; ++i) {
+    EXPECT_EQ(first[i], this->blob_top_->cpu_data()[i]);
+    EXPECT_EQ(first[i], this->blob_bottom_->cpu_diff()[i]);
+    kept += (first[i] != 0);
+  }
+  // The default dropout ratio is 0.5.
+  EXPECT_GE(kept, count / 4);
+  EXPECT_LE(kept, count * 3 / 4);
+}
+
+
 TYPED_TEST(NeuronLayerTest, TestDropoutGradientCPU) {
   LayerParameter layer_param;
   Caffe::set_mode(Caffe::CPU);
@@ -0,0 +1,64 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "caffe/common.hpp"
+#include "caffe/util/philox.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class PhiloxTest : public ::testing::Test {};
+
+TEST_F(PhiloxTest, TestKnownAnswers) {
+  // Known-answer vectors of the Random123 distribution.
+  const uint32_t zero_counter[4] = {0, 0, 0, 0};
+  const uint32_t zero_key[2] = {0, 0};
+  const uint32_t zero_expected[4] =
+      {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8};
+  const uint32_t ones_counter[4] =
+      {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff};
+  const uint32_t ones_key[2] = {0xffffffff, 0xffffffff};
+  const uint32_t ones_expected[4] =
+      {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd};
+  uint32_t out[4];
+  Philox4x32(zero_counter, zero_key, out);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(zero_expected[i], out[i]);
+  }
+  Philox4x32(ones_counter, ones_key, out);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(ones_expected[i], out[i]);
+  }
+}
+
+TEST_F(PhiloxTest, TestBernoulliBits) {
+  // 1000 elements end in a partial word, which has to be cleared.
+  const int n = 1000;
+  const uint32_t key[2] = {1701, 42};
+  const uint32_t threshold = 0x60000000;
+  std::vector<uint32_t> bits(BitMaskWords(n));
+  PhiloxBernoulliBits(key, n, threshold, &bits[0]);
+  int ones = 0;
+  for (int i = 0; i < bits.size() * 32; ++i) {
+    const bool bit = (bits[i / 32] >> (i % 32)) & 1;
+    if (i >= n) {
+      EXPECT_FALSE(bit) << "at " << i;
+      continue;
+    }
+    const uint32_t counter[4] = {4 * (i / 16) + i % 4, 0, 0, 0};
+    uint32_t words[4];
+    Philox4x32(counter, key, words);
+    EXPECT_EQ(words[(i % 16) / 4] > threshold, bit) << "at " << i;
+    ones += bit;
+  }
+  // Expect 625 set bits (1 - 3/8 of them).
+  EXPECT_GE(ones, 575);
+  EXPECT_LE(ones, 675);
+}
+
+}  // namespace caffe
@@ -1,5 +1,7 @@
 // Copyright 2014 BVLC and contributors.
 
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
@@ -50,6 +52,64 @@ typedef ::testing::Types<float, double> Dtypes;
 TYPED_TEST_CASE(SoftmaxWithLossLayerTest, Dtypes);
 
 
+TYPED_TEST(SoftmaxWithLossLayerTest, TestForwardCPU) {
+  LayerParameter layer_param;
+  Caffe::set_mode(Caffe::CPU);
+  SoftmaxWithLossLayer<TypeParam> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, &this->blob_top_vec_);
+  const TypeParam loss = layer.Forward(this->blob_bottom_vec_,
+      &this->blob_top_vec_);
+  // The mean of -log(softmax(x)[label]), with the softmax done separately.
+  const TypeParam* data = this->blob_bottom_data_->cpu_data();
+  const TypeParam* label = this->blob_bottom_label_->cpu_data();
+  const int num = this->blob_bottom_data_->num();
+  const int dim = this->blob_bottom_data_->count() / num;
+  double expected_loss = 0;
+  for (int i = 0; i < num; ++i) {
+    double x_max = data[i * dim];
+    for (int j = 0; j < dim; ++j) {
+      x_max = std::max(x_max, static_cast<double>(data[i * dim + j]));
+    }
+    double sum = 0;
+    for (int j = 0; j < dim; ++j) {
+      sum += exp(data[i * dim + j] - x_max);
+    }
+    const double prob =
+        exp(data[i * dim + static_cast<int>(label[i])] - x_max) / sum;
+    expected_loss -= log(std::max(prob, static_cast<double>(FLT_MIN)));
+  }
+  EXPECT_NEAR(expected_loss / num, loss, 1e-4);
+}
+
+TYPED_TEST(SoftmaxWithLossLayerTest, TestLargeInputCPU) {
+  // exp of these inputs overflows unless the max is subtracted first.
+  TypeParam* data = this->blob_bottom_data_->mutable_cpu_data();
+  for (int i = 0; i < this->blob_bottom_data_->count(); ++i) {
+    data[i] = 1000 + 10 * i;
+  }
+  LayerParameter layer_param;
+  Caffe::set_mode(Caffe::CPU);
+  SoftmaxWithLossLayer<TypeParam> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, &this->blob_top_vec_);
+  const TypeParam loss = layer.Forward(this->blob_bottom_vec_,
+      &this->blob_top_vec_);
+  EXPECT_TRUE(std::isfinite(loss));
+  layer.Backward(this->blob_top_vec_, true, &this->blob_bottom_vec_);
+  // Every row of the gradient is (prob - one-hot(label)) / num, which sums
+  // to zero.
+  const TypeParam* diff = this->blob_bottom_data_->cpu_diff();
+  const int num = this->blob_bottom_data_->num();
+  const int dim = this->blob_bottom_data_->count() / num;
+  for (int i = 0; i < num; ++i) {
+    TypeParam row_sum = 0;
+    for (int j = 0; j < dim; ++j) {
+      EXPECT_TRUE(std::isfinite(diff[i * dim + j]));
+      row_sum += diff[i * dim + j];
+    }
+    EXPECT_NEAR(0, row_sum, 1e-5);
+  }
+}
+
 TYPED_TEST(SoftmaxWithLossLayerTest, TestGradientCPU) {
   LayerParameter layer_param;
   Caffe::set_mode(Caffe::CPU);
@@ -60,6 +120,19 @@ TYPED_TEST(SoftmaxWithLossLayerTest, TestGradientCPU) {
       &(this->blob_top_vec_), 0, -1, -1);
 }
 
+TYPED_TEST(SoftmaxWithLossLayerTest, TestGradientTestPhaseCPU) {
+  // Outside of training Backward computes the gradient itself.
+  LayerParameter layer_param;
+  Caffe::set_mode(Caffe::CPU);
+  Caffe::set_phase(Caffe::TEST);
+  SoftmaxWithLossLayer<TypeParam> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, &this->blob_top_vec_);
+  GradientChecker<TypeParam> checker(1e-2, 1e-2, 1701);
+  checker.CheckGradientSingle(&layer, &(this->blob_bottom_vec_),
+      &(this->blob_top_vec_), 0, -1, -1);
+  Caffe::set_phase(Caffe::TRAIN);
+}
+
 TYPED_TEST(SoftmaxWithLossLayerTest, TestGradientGPU) {
   LayerParameter layer_param;
   Caffe::set_mode(Caffe::GPU);
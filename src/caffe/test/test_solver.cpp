@@ -0,0 +1,226 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <cstdio>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "caffe/common.hpp"
+#include "caffe/net.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/solver.hpp"
+#include "caffe/util/io.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+// Exposes the test routine of the solver.
+template <typename Dtype>
+class TestableSGDSolver : public SGDSolver<Dtype> {
+ public:
+  explicit TestableSGDSolver(const SolverParameter& param)
+      : SGDSolver<Dtype>(param) {}
+  using Solver<Dtype>::TestScores;
+  using Solver<Dtype>::ParallelForwardBackward;
+};
+
+template <typename Dtype>
+class SolverTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    Caffe::set_mode(Caffe::CPU);
+    // 3 rows per batch over the 20 rows of the two sample files, so the
+    // batches wrap around the files at different offsets.
+    const string& data_and_innerproduct =
+        "name: 'TestNetwork' "
+        "layers: { "
+        "  name: 'data' "
+        "  type: HDF5_DATA "
+        "  hdf5_data_param { "
+        "    source: 'src/caffe/test/test_data/sample_data_list.txt' "
+        "    batch_size: 3 "
+        "  } "
+        "  top: 'data' "
+        "  top: 'label' "
+        "} "
+        "layers: { "
+        "  name: 'innerproduct' "
+        "  type: INNER_PRODUCT "
+        "  inner_product_param { "
+        "    num_output: 10 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.0001 "
+        "    } "
+        "    bias_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "  bottom: 'data' "
+        "  top: 'innerproduct' "
+        "} ";
+    const string& prob_and_accuracy =
+        "layers: { "
+        "  name: 'prob' "
+        "  type: SOFTMAX "
+        "  bottom: 'innerproduct' "
+        "  top: 'prob' "
+        "} "
+        "layers: { "
+        "  name: 'accuracy' "
+        "  type: ACCURACY "
+        "  bottom: 'innerproduct' "
+        "  bottom: 'label' "
+        "  top: 'accuracy' "
+        "} ";
+    const string& loss =
+        "layers: { "
+        "  name: 'loss' "
+        "  type: SOFTMAX_LOSS "
+        "  bottom: 'innerproduct' "
+        "  bottom: 'label' "
+        "} ";
+    train_net_filename_ = tmpnam(NULL);  // get temp name
+    std::ofstream train_net_file(train_net_filename_.c_str());
+    train_net_file << data_and_innerproduct << loss;
+    train_net_file.close();
+    test_net_filename_ = tmpnam(NULL);
+    std::ofstream test_net_file(test_net_filename_.c_str());
+    test_net_file << data_and_innerproduct << prob_and_accuracy << loss;
+    test_net_file.close();
+    param_.set_train_net(train_net_filename_);
+    param_.set_test_net(test_net_filename_);
+    param_.set_test_iter(7);
+    param_.set_test_interval(1);
+    param_.set_test_compute_loss(true);
+    param_.set_base_lr(0.01);
+    param_.set_lr_policy("fixed");
+    param_.set_solver_mode(SolverParameter_SolverMode_CPU);
+    param_.set_random_seed(1701);
+  }
+
+  virtual void TearDown() {
+    remove(train_net_filename_.c_str());
+    remove(test_net_filename_.c_str());
+  }
+
+  string train_net_filename_;
+  string test_net_filename_;
+  SolverParameter param_;
+};
+
+typedef ::testing::Types<float, double> Dtypes;
+TYPED_TEST_CASE(SolverTest, Dtypes);
+
+TYPED_TEST(SolverTest, TestParallelTestMatchesSerial) {
+  Caffe::set_phase(Caffe::TEST);
+  TestableSGDSolver<TypeParam> serial(this->param_);
+  this->param_.set_test_num_threads(3);
+  TestableSGDSolver<TypeParam> parallel(this->param_);
+  // Run the test twice to check that the parallel test continues reading
+  // the data where the previous test stopped, as the serial one does.
+  for (int run = 0; run < 2; ++run) {
+    vector<TypeParam> serial_score, parallel_score;
+    TypeParam serial_loss, parallel_loss;
+    serial.TestScores(&serial_score, &serial_loss);
+    parallel.TestScores(&parallel_score, &parallel_loss);
+    EXPECT_EQ(serial_loss, parallel_loss);
+    ASSERT_EQ(serial_score.size(), parallel_score.size());
+    // prob (3 x 10) and accuracy (accuracy and logprob)
+    EXPECT_EQ(serial_score.size(), 32);
+    for (int i = 0; i < serial_score.size(); ++i) {
+      EXPECT_EQ(serial_score[i], parallel_score[i]) << "at " << i;
+    }
+  }
+  Caffe::set_phase(Caffe::TRAIN);
+}
+
+TYPED_TEST(SolverTest, TestDataParallelGradient) {
+  Caffe::set_phase(Caffe::TRAIN);
+  this->param_.clear_test_net();
+  this->param_.set_train_num_threads(2);
+  TestableSGDSolver<TypeParam> solver(this->param_);
+  // Reference: the two shards (one HDF5 file each) run one after the other
+  // on nets sharing the solver's weights.
+  NetParameter net_param;
+  ReadNetParamsFromTextFileOrDie(this->train_net_filename_, &net_param);
+  vector<shared_ptr<Net<TypeParam> > > shard_nets;
+  for (int i = 0; i < 2; ++i) {
+    net_param.mutable_layers(0)->mutable_hdf5_data_param()->set_num_shards(2);
+    net_param.mutable_layers(0)->mutable_hdf5_data_param()->set_shard_id(i);
+    shard_nets.push_back(
+        shared_ptr<Net<TypeParam> >(new Net<TypeParam>(net_param)));
+    shard_nets[i]->ShareTrainedLayersWith(solver.net().get());
+  }
+  // The second step checks that the workers keep running between steps.
+  for (int step = 0; step < 2; ++step) {
+    const TypeParam loss = solver.ParallelForwardBackward();
+    const TypeParam loss0 = shard_nets[0]->ForwardBackward(
+        vector<Blob<TypeParam>*>());
+    const TypeParam loss1 = shard_nets[1]->ForwardBackward(
+        vector<Blob<TypeParam>*>());
+    EXPECT_NEAR(loss, (loss0 + loss1) / 2, 1e-5);
+    vector<shared_ptr<Blob<TypeParam> > >& params = solver.net()->params();
+    for (int i = 0; i < params.size(); ++i) {
+      const TypeParam* diff = params[i]->cpu_diff();
+      const TypeParam* diff0 = shard_nets[0]->params()[i]->cpu_diff();
+      const TypeParam* diff1 = shard_nets[1]->params()[i]->cpu_diff();
+      for (int j = 0; j < params[i]->count(); ++j) {
+        EXPECT_NEAR(diff[j], (diff0[j] + diff1[j]) / 2, 1e-5);
+      }
+    }
+  }
+}
+
+TYPED_TEST(SolverTest, TestAsyncSnapshot) {
+  this->param_.clear_test_net();
+  this->param_.set_test_interval(0);
+  this->param_.set_max_iter(2);
+  this->param_.set_momentum(0.9);
+  this->param_.set_snapshot(1);
+  const string snapshot_prefix = tmpnam(NULL);
+  this->param_.set_snapshot_prefix(snapshot_prefix);
+  SGDSolver<TypeParam> solver(this->param_);
+  solver.Solve();
+  // Solve returns only after the final snapshot is written, and it has to
+  // match the weights the solver ended with.
+  NetParameter net_param;
+  const string net_filename = snapshot_prefix + "_iter_2";
+  ASSERT_TRUE(ReadProtoFromBinaryFile(net_filename, &net_param));
+  const vector<shared_ptr<Layer<TypeParam> > >& layers =
+      solver.net()->layers();
+  ASSERT_EQ(net_param.layers_size(), layers.size());
+  for (int i = 0; i < layers.size(); ++i) {
+    EXPECT_EQ(net_param.layers(i).name(), layers[i]->layer_param().name());
+    ASSERT_EQ(net_param.layers(i).blobs_size(), layers[i]->blobs().size());
+    for (int j = 0; j < layers[i]->blobs().size(); ++j) {
+      const Blob<TypeParam>& blob = *layers[i]->blobs()[j];
+      const BlobProto& proto = net_param.layers(i).blobs(j);
+      ASSERT_EQ(proto.data_size(), blob.count());
+      for (int k = 0; k < blob.count(); ++k) {
+        EXPECT_EQ(proto.data(k), static_cast<float>(blob.cpu_data()[k]));
+      }
+    }
+  }
+  SolverState state;
+  ASSERT_TRUE(ReadProtoFromBinaryFile(net_filename + ".solverstate", &state));
+  EXPECT_EQ(state.iter(), 2);
+  EXPECT_EQ(state.learned_net(), net_filename);
+  EXPECT_EQ(state.history_size(), solver.net()->params().size());
+  // The intermediate snapshot is there too.
+  SolverState first_state;
+  const string first_filename = snapshot_prefix + "_iter_1";
+  ASSERT_TRUE(ReadProtoFromBinaryFile(first_filename + ".solverstate",
+      &first_state));
+  EXPECT_EQ(first_state.iter(), 1);
+  remove(net_filename.c_str());
+  remove((net_filename + ".solverstate").c_str());
+  remove(first_filename.c_str());
+  remove((first_filename + ".solverstate").c_str());
+}
+
+}  // namespace caffe
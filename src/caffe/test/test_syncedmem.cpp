@@ -1,5 +1,7 @@
 // Copyright 2014 BVLC and contributors.
 
+#include <stdint.h>
+
 #include <cstring>
 #include <vector>
 
@@ -87,4 +89,88 @@ TEST_F(SyncedMemoryTest, TestGPUWrite) {
   EXPECT_EQ(mem.head(), SyncedMemory::SYNCED);
 }
 
+TEST_F(SyncedMemoryTest, TestCPUAlignedAndZeroed) {
+  // Sizes below and above kHostMapThreshold, which come from different
+  // places.
+  const size_t sizes[2] = {1000, kHostMapThreshold + 1000};
+  for (int i = 0; i < 2; ++i) {
+    for (int round = 0; round < 2; ++round) {
+      // The second round gets the block the first one dirtied back from the
+      // cache, and still has to see zeros.
+      SyncedMemory mem(sizes[i]);
+      const char* cpu_data = static_cast<const char*>(mem.cpu_data());
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(cpu_data) % kHostAlignment, 0);
+      for (int j = 0; j < mem.size(); ++j) {
+        EXPECT_EQ(cpu_data[j], 0);
+      }
+      memset(mem.mutable_cpu_data(), 1, mem.size());
+    }
+  }
+}
+
+TEST_F(SyncedMemoryTest, TestHostCacheReuse) {
+  // Start from an empty cache so that only the second block is a hit.
+  Caffe::ReleaseHostCache();
+  HostMemoryStats before = Caffe::host_memory_stats();
+  const void* first;
+  {
+    SyncedMemory mem(5000);
+    first = mem.cpu_data();
+  }
+  // A block of the same size class comes back from the cache.
+  SyncedMemory mem(4900);
+  EXPECT_EQ(first, mem.cpu_data());
+  HostMemoryStats after = Caffe::host_memory_stats();
+  EXPECT_EQ(after.allocations, before.allocations + 2);
+  EXPECT_EQ(after.cache_hits, before.cache_hits + 1);
+  EXPECT_EQ(after.in_use_bytes,
+      before.in_use_bytes + HostAllocator::SizeClass(4900));
+  EXPECT_GE(after.peak_in_use_bytes, after.in_use_bytes);
+}
+
+TEST_F(SyncedMemoryTest, TestHostCacheLimit) {
+  Caffe::ReleaseHostCache();
+  EXPECT_EQ(Caffe::host_memory_stats().cached_bytes, 0);
+  const size_t limit = HostAllocator::Get().cache_limit();
+  Caffe::set_host_cache_limit(0);
+  {
+    SyncedMemory mem(5000);
+    mem.cpu_data();
+  }
+  EXPECT_EQ(Caffe::host_memory_stats().cached_bytes, 0);
+  Caffe::set_host_cache_limit(limit);
+  {
+    SyncedMemory mem(5000);
+    mem.cpu_data();
+  }
+  EXPECT_EQ(Caffe::host_memory_stats().cached_bytes,
+      HostAllocator::SizeClass(5000));
+}
+
+TEST_F(SyncedMemoryTest, TestHostSizeClasses) {
+  EXPECT_EQ(HostAllocator::SizeClass(0), 64);
+  EXPECT_EQ(HostAllocator::SizeClass(64), 64);
+  EXPECT_EQ(HostAllocator::SizeClass(65), 80);
+  EXPECT_EQ(HostAllocator::SizeClass(128), 128);
+  EXPECT_EQ(HostAllocator::SizeClass(129), 160);
+  EXPECT_EQ(HostAllocator::SizeClass(1000), 1024);
+  EXPECT_EQ(HostAllocator::SizeClass(1025), 1280);
+}
+
+TEST_F(SyncedMemoryTest, TestCPUView) {
+  shared_ptr<SyncedMemory> mem(new SyncedMemory(10));
+  SyncedMemory view(mem, 4, 3);
+  EXPECT_TRUE(view.is_view());
+  EXPECT_EQ(view.size(), 3);
+  EXPECT_EQ(view.head(), SyncedMemory::UNINITIALIZED);
+  memset(view.mutable_cpu_data(), 1, view.size());
+  EXPECT_EQ(view.head(), SyncedMemory::HEAD_AT_CPU);
+  EXPECT_EQ(mem->head(), SyncedMemory::HEAD_AT_CPU);
+  const char* data = static_cast<const char*>(mem->cpu_data());
+  EXPECT_EQ(data + 4, view.cpu_data());
+  for (int i = 0; i < mem->size(); ++i) {
+    EXPECT_EQ(data[i], i >= 4 && i < 7 ? 1 : 0);
+  }
+}
+
 }  // namespace caffe
@@ -1,12 +1,14 @@
 // Copyright 2014 BVLC and contributors.
 
 #include <cstring>
+#include <vector>
 
 #include "cuda_runtime.h"
 #include "cublas_v2.h"
 
 #include "gtest/gtest.h"
 #include "caffe/blob.hpp"
+#include "caffe/util/float16.hpp"
 #include "caffe/util/math_functions.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
@@ -93,6 +95,57 @@ TYPED_TEST(GemmTest, TestGemm) {
 }
 
 
+TYPED_TEST(GemmTest, TestCompactGemm) {
+  // The compact operand has 600 rows or columns besides K = 2000, so it is
+  // converted in several panels. A dense operand of 3 rows is split along
+  // the other dimension, one of 150 rows along K. Small integers are exact
+  // in both 16-bit formats and their products sum exactly, so the results
+  // must match.
+  const int kOther = 600;
+  const int K = 2000;
+  const int kSmallSizes[2] = {3, 150};
+  std::vector<TypeParam> compact_data(kOther * K);
+  for (int i = 0; i < compact_data.size(); ++i) {
+    compact_data[i] = (i * 7) % 9 - 4;
+  }
+  std::vector<uint16_t> compact(compact_data.size());
+  const CBLAS_TRANSPOSE trans[2] = {CblasNoTrans, CblasTrans};
+  for (int s = 0; s < 2; ++s) {
+    const int kSmall = kSmallSizes[s];
+    std::vector<TypeParam> dense_data(kSmall * K);
+    for (int i = 0; i < dense_data.size(); ++i) {
+      dense_data[i] = (i * 5) % 7 - 3;
+    }
+    std::vector<TypeParam> expected(kOther * kSmall), actual(kOther * kSmall);
+    for (int format = HALF_FLOAT16; format <= HALF_BFLOAT16; ++format) {
+      ToHalf(static_cast<HalfFormat>(format), compact.size(),
+          &compact_data[0], &compact[0]);
+      for (int a = 0; a < 2; ++a) {
+        for (int b = 0; b < 2; ++b) {
+          // Compact A: (600 x K) * (K x kSmall).
+          caffe_cpu_gemm<TypeParam>(trans[a], trans[b], kOther, kSmall, K,
+              2., &compact_data[0], &dense_data[0], 0., &expected[0]);
+          caffe_cpu_gemm<TypeParam>(trans[a], trans[b], kOther, kSmall, K,
+              2., &compact[0], static_cast<HalfFormat>(format),
+              &dense_data[0], 0., &actual[0]);
+          for (int i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(expected[i], actual[i]);
+          }
+          // Compact B: (kSmall x K) * (K x 600).
+          caffe_cpu_gemm<TypeParam>(trans[a], trans[b], kSmall, kOther, K,
+              2., &dense_data[0], &compact_data[0], 0., &expected[0]);
+          caffe_cpu_gemm<TypeParam>(trans[a], trans[b], kSmall, kOther, K,
+              2., &dense_data[0], &compact[0],
+              static_cast<HalfFormat>(format), 0., &actual[0]);
+          for (int i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(expected[i], actual[i]);
+          }
+        }
+      }
+    }
+  }
+}
+
 TYPED_TEST(GemmTest, TestGemv) {
   Blob<TypeParam> A(1, 1, 2, 3);
   Blob<TypeParam> x(1, 1, 1, 3);
@@ -0,0 +1,206 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "leveldb/db.h"
+#include "lmdb.h"
+#include "gtest/gtest.h"
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/volume_data_layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/test/test_caffe_main.hpp"
+
+using std::string;
+using std::stringstream;
+
+namespace caffe {
+
+template <typename Dtype>
+class VolumeDataLayerTest : public ::testing::Test {
+ protected:
+  VolumeDataLayerTest()
+      : blob_top_data_(new Blob<Dtype>()),
+        blob_top_label_(new Blob<Dtype>()),
+        filename_(new string(tmpnam(NULL))),
+        num_records_(7),
+        seed_(1701) {}
+  virtual void SetUp() {
+    blob_top_vec_.push_back(blob_top_data_);
+    blob_top_vec_.push_back(blob_top_label_);
+  }
+
+  // Fill a database with num_records_ clips of 2 channels, 3 frames and 4x5
+  // pixels. If unique_pixels, each pixel is unique but all clips are the
+  // same; else each clip is unique but all pixels within a clip are the same.
+  void FillDB(const DataParameter_DB backend, const bool unique_pixels) {
+    LOG(INFO) << "Using temporary database " << *filename_;
+    vector<string> keys;
+    vector<string> values;
+    for (int i = 0; i < num_records_; ++i) {
+      VolumeDatum datum;
+      datum.set_label(i);
+      datum.set_channels(2);
+      datum.set_length(3);
+      datum.set_height(4);
+      datum.set_width(5);
+      string* data = datum.mutable_data();
+      for (int j = 0; j < 120; ++j) {
+        data->push_back(static_cast<uint8_t>(unique_pixels ? j : i));
+      }
+      stringstream ss;
+      ss << i;
+      keys.push_back(ss.str());
+      values.push_back(datum.SerializeAsString());
+    }
+    if (backend == DataParameter_DB_LEVELDB) {
+      leveldb::DB* db;
+      leveldb::Options options;
+      options.error_if_exists = true;
+      options.create_if_missing = true;
+      leveldb::Status status =
+          leveldb::DB::Open(options, filename_->c_str(), &db);
+      CHECK(status.ok());
+      for (int i = 0; i < num_records_; ++i) {
+        db->Put(leveldb::WriteOptions(), keys[i], values[i]);
+      }
+      delete db;
+    } else {
+      MDB_env* env;
+      MDB_dbi dbi;
+      MDB_txn* txn;
+      CHECK_EQ(mkdir(filename_->c_str(), 0744), 0);
+      CHECK_EQ(mdb_env_create(&env), MDB_SUCCESS);
+      CHECK_EQ(mdb_env_set_mapsize(env, 1 << 20), MDB_SUCCESS);
+      CHECK_EQ(mdb_env_open(env, filename_->c_str(), 0, 0664), MDB_SUCCESS);
+      CHECK_EQ(mdb_txn_begin(env, NULL, 0, &txn), MDB_SUCCESS);
+      CHECK_EQ(mdb_dbi_open(txn, NULL, 0, &dbi), MDB_SUCCESS);
+      for (int i = 0; i < num_records_; ++i) {
+        MDB_val key, value;
+        key.mv_size = keys[i].size();
+        key.mv_data = &keys[i][0];
+        value.mv_size = values[i].size();
+        value.mv_data = &values[i][0];
+        CHECK_EQ(mdb_put(txn, dbi, &key, &value, 0), MDB_SUCCESS);
+      }
+      CHECK_EQ(mdb_txn_commit(txn), MDB_SUCCESS);
+      mdb_env_close(env);
+    }
+  }
+
+  // Read batches of 4 from a database of unique clips, which wraps around
+  // in the middle of the second batch.
+  void TestRead(const DataParameter_DB backend, const int num_readers) {
+    const bool unique_pixels = false;  // all pixels the same; clips different
+    FillDB(backend, unique_pixels);
+    const Dtype scale = 3;
+    LayerParameter param;
+    DataParameter* data_param = param.mutable_data_param();
+    data_param->set_batch_size(4);
+    data_param->set_scale(scale);
+    data_param->set_source(filename_->c_str());
+    data_param->set_backend(backend);
+    data_param->set_num_readers(num_readers);
+    VolumeDataLayer<Dtype> layer(param);
+    layer.SetUp(blob_bottom_vec_, &blob_top_vec_);
+    EXPECT_EQ(blob_top_data_->num(), 4);
+    EXPECT_EQ(blob_top_data_->channels(), 2);
+    EXPECT_EQ(blob_top_data_->length(), 3);
+    EXPECT_EQ(blob_top_data_->height(), 4);
+    EXPECT_EQ(blob_top_data_->width(), 5);
+    EXPECT_EQ(blob_top_label_->num(), 4);
+    EXPECT_EQ(blob_top_label_->channels(), 1);
+
+    for (int iter = 0; iter < 5; ++iter) {
+      layer.Forward(blob_bottom_vec_, &blob_top_vec_);
+      for (int i = 0; i < 4; ++i) {
+        const int record = (iter * 4 + i) % num_records_;
+        EXPECT_EQ(record, blob_top_label_->cpu_data()[i]);
+        for (int j = 0; j < 120; ++j) {
+          EXPECT_EQ(scale * record, blob_top_data_->cpu_data()[i * 120 + j])
+              << "debug: iter " << iter << " i " << i << " j " << j;
+        }
+      }
+    }
+  }
+
+  virtual ~VolumeDataLayerTest() {
+    delete blob_top_data_;
+    delete blob_top_label_;
+  }
+
+  Blob<Dtype>* const blob_top_data_;
+  Blob<Dtype>* const blob_top_label_;
+  shared_ptr<string> filename_;
+  const int num_records_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+  int seed_;
+};
+
+typedef ::testing::Types<float, double> Dtypes;
+TYPED_TEST_CASE(VolumeDataLayerTest, Dtypes);
+
+TYPED_TEST(VolumeDataLayerTest, TestReadLevelDB) {
+  Caffe::set_mode(Caffe::CPU);
+  this->TestRead(DataParameter_DB_LEVELDB, 1);
+}
+
+TYPED_TEST(VolumeDataLayerTest, TestReadLMDB) {
+  Caffe::set_mode(Caffe::CPU);
+  this->TestRead(DataParameter_DB_LMDB, 1);
+}
+
+TYPED_TEST(VolumeDataLayerTest, TestReadParallelLMDB) {
+  Caffe::set_mode(Caffe::CPU);
+  this->TestRead(DataParameter_DB_LMDB, 3);
+}
+
+TYPED_TEST(VolumeDataLayerTest, TestParallelCropMirrorMatchesSerial) {
+  Caffe::set_phase(Caffe::TRAIN);
+  Caffe::set_mode(Caffe::CPU);
+  const bool unique_pixels = true;  // all clips the same; pixels different
+  this->FillDB(DataParameter_DB_LMDB, unique_pixels);
+  LayerParameter param;
+  DataParameter* data_param = param.mutable_data_param();
+  data_param->set_batch_size(4);
+  data_param->set_crop_size(2);
+  data_param->set_mirror(true);
+  data_param->set_source(this->filename_->c_str());
+  data_param->set_backend(DataParameter_DB_LMDB);
+
+  // Get the crops of a few batches read by one reader.
+  const int num_iter = 4;
+  vector<TypeParam> serial_data;
+  {
+    Caffe::set_random_seed(this->seed_);
+    VolumeDataLayer<TypeParam> layer(param);
+    layer.SetUp(this->blob_bottom_vec_, &this->blob_top_vec_);
+    for (int iter = 0; iter < num_iter; ++iter) {
+      layer.Forward(this->blob_bottom_vec_, &this->blob_top_vec_);
+      serial_data.insert(serial_data.end(), this->blob_top_data_->cpu_data(),
+          this->blob_top_data_->cpu_data() + this->blob_top_data_->count());
+    }
+  }
+  // Three readers draw the same crops and mirroring for the same items.
+  data_param->set_num_readers(3);
+  Caffe::set_random_seed(this->seed_);
+  VolumeDataLayer<TypeParam> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, &this->blob_top_vec_);
+  const int count = this->blob_top_data_->count();
+  for (int iter = 0; iter < num_iter; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, &this->blob_top_vec_);
+    for (int i = 0; i < count; ++i) {
+      EXPECT_EQ(serial_data[iter * count + i],
+          this->blob_top_data_->cpu_data()[i])
+          << "debug: iter " << iter << " i " << i;
+    }
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,120 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/datum_view.hpp"
+#include "caffe/util/volume_mean.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class VolumeMeanTest : public ::testing::Test {
+ protected:
+  // 3 x 2 x 5 x 7 = 210 elements: not a multiple of the SIMD width.
+  VolumeMeanTest() : channels_(3), length_(2), height_(5), width_(7) {}
+
+  void MakeByteDatum(const int seed, VolumeDatum* datum) {
+    const int size = channels_ * length_ * height_ * width_;
+    datum->set_channels(channels_);
+    datum->set_length(length_);
+    datum->set_height(height_);
+    datum->set_width(width_);
+    std::string* data = datum->mutable_data();
+    data->clear();
+    for (int i = 0; i < size; ++i) {
+      data->push_back(static_cast<char>((i * 37 + seed * 101) % 256));
+    }
+  }
+
+  int channels_;
+  int length_;
+  int height_;
+  int width_;
+};
+
+TEST_F(VolumeMeanTest, TestByteMean) {
+  VolumeMeanAccumulator accumulator;
+  VolumeDatum datum;
+  MakeByteDatum(0, &datum);
+  accumulator.Init(datum);
+  const int num = 5;
+  std::vector<double> expected(accumulator.size(), 0.);
+  for (int n = 0; n < num; ++n) {
+    MakeByteDatum(n, &datum);
+    accumulator.Add(datum);
+    for (int i = 0; i < accumulator.size(); ++i) {
+      expected[i] += static_cast<uint8_t>(datum.data()[i]);
+    }
+  }
+  BlobProto proto;
+  accumulator.ToProto(&proto);
+  EXPECT_EQ(proto.num(), 1);
+  EXPECT_EQ(proto.channels(), channels_);
+  EXPECT_EQ(proto.length(), length_);
+  EXPECT_EQ(proto.height(), height_);
+  EXPECT_EQ(proto.width(), width_);
+  ASSERT_EQ(proto.data_size(), accumulator.size());
+  for (int i = 0; i < proto.data_size(); ++i) {
+    EXPECT_NEAR(proto.data(i), expected[i] / num, 1e-4);
+  }
+}
+
+TEST_F(VolumeMeanTest, TestMergeAndFloatData) {
+  VolumeDatum datum;
+  MakeByteDatum(0, &datum);
+  VolumeMeanAccumulator bytes, floats;
+  bytes.Init(datum);
+  floats.Init(datum);
+  bytes.Add(datum);
+  VolumeDatum float_datum;
+  float_datum.set_channels(channels_);
+  float_datum.set_length(length_);
+  float_datum.set_height(height_);
+  float_datum.set_width(width_);
+  for (int i = 0; i < floats.size(); ++i) {
+    float_datum.add_float_data(0.5);
+  }
+  floats.Add(float_datum);
+  bytes.Merge(floats);
+  EXPECT_EQ(bytes.count(), 2);
+  BlobProto proto;
+  bytes.ToProto(&proto);
+  for (int i = 0; i < proto.data_size(); ++i) {
+    EXPECT_NEAR(proto.data(i),
+        (static_cast<uint8_t>(datum.data()[i]) + 0.5) / 2, 1e-4);
+  }
+}
+
+TEST_F(VolumeMeanTest, TestDatumView) {
+  VolumeMeanAccumulator from_datum, from_view;
+  VolumeDatum datum;
+  DatumView view;
+  for (int n = 0; n < 3; ++n) {
+    MakeByteDatum(n, &datum);
+    const std::string record = datum.SerializeAsString();
+    ASSERT_TRUE(view.ParseVolumeDatum(record.data(), record.size()));
+    if (n == 0) {
+      from_datum.Init(datum);
+      from_view.Init(view);
+    }
+    from_datum.Add(datum);
+    from_view.Add(view);
+  }
+  BlobProto expected, proto;
+  from_datum.ToProto(&expected);
+  from_view.ToProto(&proto);
+  EXPECT_EQ(expected.length(), proto.length());
+  ASSERT_EQ(expected.data_size(), proto.data_size());
+  for (int i = 0; i < proto.data_size(); ++i) {
+    EXPECT_EQ(expected.data(i), proto.data(i));
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,144 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/vision_layers.hpp"
+#include "caffe/workspace.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class WorkspaceTest : public ::testing::Test {};
+
+TEST_F(WorkspaceTest, TestReserve) {
+  Workspace workspace;
+  EXPECT_EQ(0, workspace.size());
+  workspace.Reserve(100);
+  EXPECT_EQ(100, workspace.size());
+  workspace.Reserve(10);
+  EXPECT_EQ(100, workspace.size());
+}
+
+TEST_F(WorkspaceTest, TestCPUData) {
+  Workspace workspace;
+  workspace.Reserve(100);
+  void* data = workspace.mutable_cpu_data(10);
+  ASSERT_TRUE(data);
+  memset(data, 1, 100);
+  // Requests within the reserved size reuse the buffer.
+  EXPECT_EQ(data, workspace.mutable_cpu_data(100));
+  EXPECT_EQ(100, workspace.size());
+  // Larger ones grow it.
+  data = workspace.mutable_cpu_data(1000);
+  ASSERT_TRUE(data);
+  memset(data, 2, 1000);
+  EXPECT_EQ(1000, workspace.size());
+}
+
+template <typename Dtype>
+class WorkspaceLayerTest : public ::testing::Test {
+ protected:
+  WorkspaceLayerTest()
+      : blob_bottom_(new Blob<Dtype>(2, 7, 3, 4, 5)),
+        blob_top_(new Blob<Dtype>()),
+        blob_top_shared_(new Blob<Dtype>()) {}
+  virtual void SetUp() {
+    Caffe::set_random_seed(1701);
+    FillerParameter filler_param;
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(blob_bottom_);
+    blob_bottom_vec_.push_back(blob_bottom_);
+    blob_top_vec_.push_back(blob_top_);
+    blob_top_shared_vec_.push_back(blob_top_shared_);
+  }
+  virtual ~WorkspaceLayerTest() {
+    delete blob_bottom_;
+    delete blob_top_;
+    delete blob_top_shared_;
+  }
+
+  // Runs the layer forward and backward once with its own workspace, and
+  // again with a shared workspace that another layer has left garbage in,
+  // and checks that both give the same results.
+  void TestLayer(const LayerParameter& layer_param) {
+    shared_ptr<Layer<Dtype> > layer(GetLayer<Dtype>(layer_param));
+    layer->SetUp(blob_bottom_vec_, &blob_top_vec_);
+    layer->Forward(blob_bottom_vec_, &blob_top_vec_);
+    caffe_copy(blob_top_->count(), blob_top_->cpu_data(),
+        blob_top_->mutable_cpu_diff());
+    layer->Backward(blob_top_vec_, true, &blob_bottom_vec_);
+    vector<Dtype> bottom_diff(blob_bottom_->cpu_diff(),
+        blob_bottom_->cpu_diff() + blob_bottom_->count());
+
+    Workspace workspace;
+    shared_ptr<Layer<Dtype> > shared_layer(GetLayer<Dtype>(layer_param));
+    shared_layer->set_workspace(&workspace);
+    shared_layer->SetUp(blob_bottom_vec_, &blob_top_shared_vec_);
+    EXPECT_EQ(shared_layer->workspace_bytes(), workspace.size());
+    if (layer->blobs().size()) {
+      shared_layer->blobs()[0]->CopyFrom(*layer->blobs()[0]);
+    }
+    const size_t size = workspace.size() + 1;
+    memset(workspace.mutable_cpu_data(size), 0x7f, size);
+    shared_layer->Forward(blob_bottom_vec_, &blob_top_shared_vec_);
+    for (int i = 0; i < blob_top_->count(); ++i) {
+      EXPECT_EQ(blob_top_->cpu_data()[i], blob_top_shared_->cpu_data()[i]);
+    }
+    memset(workspace.mutable_cpu_data(size), 0x7f, size);
+    caffe_copy(blob_top_shared_->count(), blob_top_shared_->cpu_data(),
+        blob_top_shared_->mutable_cpu_diff());
+    shared_layer->Backward(blob_top_shared_vec_, true, &blob_bottom_vec_);
+    for (int i = 0; i < blob_bottom_->count(); ++i) {
+      EXPECT_EQ(bottom_diff[i], blob_bottom_->cpu_diff()[i]);
+    }
+  }
+
+  Blob<Dtype>* const blob_bottom_;
+  Blob<Dtype>* const blob_top_;
+  Blob<Dtype>* const blob_top_shared_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+  vector<Blob<Dtype>*> blob_top_shared_vec_;
+};
+
+typedef ::testing::Types<float, double> Dtypes;
+TYPED_TEST_CASE(WorkspaceLayerTest, Dtypes);
+
+TYPED_TEST(WorkspaceLayerTest, TestLRN) {
+  Caffe::set_mode(Caffe::CPU);
+  LayerParameter layer_param;
+  layer_param.set_type(LayerParameter_LayerType_LRN);
+  layer_param.mutable_lrn_param()->set_local_size(5);
+  this->TestLayer(layer_param);
+}
+
+TYPED_TEST(WorkspaceLayerTest, TestSoftmax) {
+  Caffe::set_mode(Caffe::CPU);
+  LayerParameter layer_param;
+  layer_param.set_type(LayerParameter_LayerType_SOFTMAX);
+  this->TestLayer(layer_param);
+}
+
+TYPED_TEST(WorkspaceLayerTest, TestConvolution3D) {
+  Caffe::set_mode(Caffe::CPU);
+  LayerParameter layer_param;
+  layer_param.set_type(LayerParameter_LayerType_CONVOLUTION3D);
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->set_kernel_size(3);
+  convolution_param->set_kernel_depth(3);
+  convolution_param->set_pad(1);
+  convolution_param->set_temporal_pad(1);
+  convolution_param->set_num_output(4);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->set_bias_term(false);
+  this->TestLayer(layer_param);
+}
+
+}  // namespace caffe
@@ -0,0 +1,174 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <glog/logging.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "caffe/util/data_transform.hpp"
+
+namespace caffe {
+
+// Transforms n contiguous bytes of one image row. With mirror set, element i
+// of the row is written to dst[n - 1 - i].
+template <typename Dtype>
+static inline void TransformRow(const uint8_t* src, const Dtype* mean,
+    const int n, const Dtype scale, const bool mirror, Dtype* dst) {
+  if (mirror) {
+    for (int i = 0; i < n; ++i) {
+      dst[n - 1 - i] = (static_cast<Dtype>(src[i]) - mean[i]) * scale;
+    }
+  } else {
+    for (int i = 0; i < n; ++i) {
+      dst[i] = (static_cast<Dtype>(src[i]) - mean[i]) * scale;
+    }
+  }
+}
+
+#if defined(__SSE2__)
+// Converts 16 bytes at a time to floats and applies the mean and scale with
+// the same operations as the scalar loop, so both give identical results.
+template <>
+inline void TransformRow<float>(const uint8_t* src, const float* mean,
+    const int n, const float scale, const bool mirror, float* dst) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 scale4 = _mm_set1_ps(scale);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+    const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+    __m128 v[4];
+    v[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+    v[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+    v[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+    v[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+    for (int k = 0; k < 4; ++k) {
+      const __m128 out = _mm_mul_ps(
+          _mm_sub_ps(v[k], _mm_loadu_ps(mean + i + 4 * k)), scale4);
+      if (mirror) {
+        _mm_storeu_ps(dst + n - 4 - (i + 4 * k),
+            _mm_shuffle_ps(out, out, _MM_SHUFFLE(0, 1, 2, 3)));
+      } else {
+        _mm_storeu_ps(dst + i + 4 * k, out);
+      }
+    }
+  }
+  if (mirror) {
+    for (; i < n; ++i) {
+      dst[n - 1 - i] = (static_cast<float>(src[i]) - mean[i]) * scale;
+    }
+  } else {
+    for (; i < n; ++i) {
+      dst[i] = (static_cast<float>(src[i]) - mean[i]) * scale;
+    }
+  }
+}
+#endif
+
+template <typename Dtype>
+void TransformVolumeData(const uint8_t* data, const Dtype* mean,
+    const int channels, const int length, const int height, const int width,
+    const int crop_size, const int h_off, const int w_off, const bool mirror,
+    const Dtype scale, Dtype* top_data, char* show_buffer) {
+  if (crop_size == 0) {
+    CHECK(!mirror) << "Mirroring requires crop_size to be set.";
+    const int size = channels * length * height * width;
+    TransformRow(data, mean, size, scale, false, top_data);
+    if (show_buffer) {
+      memcpy(show_buffer, data, size);
+    }
+    return;
+  }
+  CHECK_LE(h_off + crop_size, height);
+  CHECK_LE(w_off + crop_size, width);
+  const int frames = channels * length;
+  for (int f = 0; f < frames; ++f) {
+    for (int h = 0; h < crop_size; ++h) {
+      const int data_index = (f * height + h + h_off) * width + w_off;
+      const int top_index = (f * crop_size + h) * crop_size;
+      TransformRow(data + data_index, mean + data_index, crop_size, scale,
+          mirror, top_data + top_index);
+      if (show_buffer) {
+        char* row = show_buffer + top_index;
+        if (mirror) {
+          for (int w = 0; w < crop_size; ++w) {
+            row[crop_size - 1 - w] = data[data_index + w];
+          }
+        } else {
+          memcpy(row, data + data_index, crop_size);
+        }
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void TransformInterleavedFrame(const uint8_t* pixels, const int row_stride,
+    const Dtype* mean, const int channels, const int length, const int frame,
+    const int height, const int width, const int crop_size, const int h_off,
+    const int w_off, const bool mirror, const Dtype scale, Dtype* top_data) {
+  CHECK(crop_size || !mirror) << "Mirroring requires crop_size to be set.";
+  CHECK_LT(frame, length);
+  CHECK_LE(h_off + crop_size, height);
+  CHECK_LE(w_off + crop_size, width);
+  const int top_height = crop_size ? crop_size : height;
+  const int top_width = crop_size ? crop_size : width;
+  // One channel of a row at a time is gathered into row, and goes through
+  // the same row transform as the planar path.
+  std::vector<uint8_t> row(top_width);
+  for (int c = 0; c < channels; ++c) {
+    const int f = c * length + frame;
+    for (int h = 0; h < top_height; ++h) {
+      const uint8_t* src =
+          pixels + (h + h_off) * row_stride + w_off * channels + c;
+      for (int w = 0; w < top_width; ++w) {
+        row[w] = src[w * channels];
+      }
+      TransformRow(&row[0], mean + (f * height + h + h_off) * width + w_off,
+          top_width, scale, mirror,
+          top_data + (f * top_height + h) * top_width);
+    }
+  }
+}
+
+template <typename Dtype>
+void TransformFloatData(const float* data, const Dtype* mean, const int size,
+    const Dtype scale, Dtype* top_data) {
+  for (int i = 0; i < size; ++i) {
+    top_data[i] = (data[i] - mean[i]) * scale;
+  }
+}
+
+// Explicit instantiation
+template void TransformVolumeData<float>(const uint8_t* data,
+    const float* mean, const int channels, const int length, const int height,
+    const int width, const int crop_size, const int h_off, const int w_off,
+    const bool mirror, const float scale, float* top_data, char* show_buffer);
+template void TransformVolumeData<double>(const uint8_t* data,
+    const double* mean, const int channels, const int length,
+    const int height, const int width, const int crop_size, const int h_off,
+    const int w_off, const bool mirror, const double scale, double* top_data,
+    char* show_buffer);
+template void TransformInterleavedFrame<float>(const uint8_t* pixels,
+    const int row_stride, const float* mean, const int channels,
+    const int length, const int frame, const int height, const int width,
+    const int crop_size, const int h_off, const int w_off, const bool mirror,
+    const float scale, float* top_data);
+template void TransformInterleavedFrame<double>(const uint8_t* pixels,
+    const int row_stride, const double* mean, const int channels,
+    const int length, const int frame, const int height, const int width,
+    const int crop_size, const int h_off, const int w_off, const bool mirror,
+    const double scale, double* top_data);
+template void TransformFloatData<float>(const float* data, const float* mean,
+    const int size, const float scale, float* top_data);
+template void TransformFloatData<double>(const float* data,
+    const double* mean, const int size, const double scale, double* top_data);
+
+}  // namespace caffe
@@ -0,0 +1,140 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "caffe/util/datum_view.hpp"
+
+namespace caffe {
+
+// Protocol buffer wire types.
+enum WireType {
+  WIRE_VARINT = 0,
+  WIRE_FIXED64 = 1,
+  WIRE_LENGTH_DELIMITED = 2,
+  WIRE_FIXED32 = 5
+};
+
+// Reads the varint at *pos, which must end before end, and advances past it.
+static bool ReadVarint(const uint8_t** pos, const uint8_t* end,
+    uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+    const uint8_t byte = *(*pos)++;
+    *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static float DecodeFloat(const uint8_t* bytes) {
+  float value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+void DatumView::Clear() {
+  channels_ = 0;
+  length_ = 1;
+  height_ = 0;
+  width_ = 0;
+  label_ = 0;
+  data_ = NULL;
+  data_size_ = 0;
+  float_data_.clear();
+}
+
+bool DatumView::ParseVolumeDatum(const void* record, const size_t size) {
+  static const Fields kVolumeDatumFields = { 1, 2, 3, 4, 5, 6, 7 };
+  return Parse(kVolumeDatumFields, static_cast<const uint8_t*>(record), size);
+}
+
+bool DatumView::ParseDatum(const void* record, const size_t size) {
+  static const Fields kDatumFields = { 1, -1, 2, 3, 4, 5, 6 };
+  return Parse(kDatumFields, static_cast<const uint8_t*>(record), size);
+}
+
+bool DatumView::Parse(const Fields& fields, const uint8_t* record,
+    const size_t size) {
+  Clear();
+  const uint8_t* pos = record;
+  const uint8_t* const end = record + size;
+  bool ok = true;
+  while (ok && pos < end) {
+    uint64_t tag;
+    if (!ReadVarint(&pos, end, &tag)) {
+      ok = false;
+      break;
+    }
+    const int field = tag >> 3;
+    const int wire_type = tag & 7;
+    if (wire_type == WIRE_VARINT) {
+      uint64_t value;
+      if (!ReadVarint(&pos, end, &value)) {
+        ok = false;
+        break;
+      }
+      // int32 fields: negative values are sign-extended to 64 bits.
+      const int int_value = static_cast<int32_t>(value);
+      if (field == fields.channels) {
+        channels_ = int_value;
+      } else if (field == fields.length) {
+        length_ = int_value;
+      } else if (field == fields.height) {
+        height_ = int_value;
+      } else if (field == fields.width) {
+        width_ = int_value;
+      } else if (field == fields.label) {
+        label_ = int_value;
+      }
+    } else if (wire_type == WIRE_LENGTH_DELIMITED) {
+      uint64_t field_size;
+      if (!ReadVarint(&pos, end, &field_size) ||
+          field_size > static_cast<uint64_t>(end - pos)) {
+        ok = false;
+        break;
+      }
+      if (field == fields.data) {
+        data_ = pos;
+        data_size_ = field_size;
+      } else if (field == fields.float_data && field_size > 0) {
+        // Packed floats.
+        if (field_size % sizeof(float)) {
+          ok = false;
+          break;
+        }
+        const size_t offset = float_data_.size();
+        float_data_.resize(offset + field_size / sizeof(float));
+        memcpy(&float_data_[offset], pos, field_size);
+      }
+      pos += field_size;
+    } else if (wire_type == WIRE_FIXED32) {
+      if (end - pos < 4) {
+        ok = false;
+        break;
+      }
+      if (field == fields.float_data) {
+        float_data_.push_back(DecodeFloat(pos));
+      }
+      pos += 4;
+    } else if (wire_type == WIRE_FIXED64) {
+      if (end - pos < 8) {
+        ok = false;
+        break;
+      }
+      pos += 8;
+    } else {
+      // Groups are not used by these messages.
+      ok = false;
+    }
+  }
+  if (!ok) {
+    Clear();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace caffe
@@ -0,0 +1,162 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <leveldb/db.h>
+#include <lmdb.h>
+
+#include <string>
+
+#include "caffe/common.hpp"
+#include "caffe/util/db.hpp"
+
+#define MDB_CHECK(condition) \
+  do { \
+    const int mdb_status = (condition); \
+    CHECK_EQ(mdb_status, MDB_SUCCESS) << " " << mdb_strerror(mdb_status); \
+  } while (0)
+
+namespace caffe {
+
+void DatabaseCursor::SeekTo(const uint64_t index) {
+  CHECK_GE(index, index_) << "Database cursors only move forward.";
+  for (; index_ < index; ++index_) {
+    if (!NextRecord()) {
+      DLOG(INFO) << "Restarting data prefetching from start.";
+      SeekToFirstRecord();
+    }
+  }
+}
+
+namespace {
+
+class LevelDBCursor : public DatabaseCursor {
+ public:
+  explicit LevelDBCursor(leveldb::Iterator* iter) : iter_(iter) {
+    SeekToFirstRecord();
+  }
+
+  virtual string key() const { return iter_->key().ToString(); }
+  virtual const void* value() const { return iter_->value().data(); }
+  virtual size_t value_size() const { return iter_->value().size(); }
+
+ protected:
+  virtual void SeekToFirstRecord() {
+    iter_->SeekToFirst();
+    CHECK(iter_->Valid()) << "The database is empty.";
+  }
+  virtual bool NextRecord() {
+    iter_->Next();
+    return iter_->Valid();
+  }
+
+ private:
+  shared_ptr<leveldb::Iterator> iter_;
+};
+
+class LevelDBDatabase : public Database {
+ public:
+  explicit LevelDBDatabase(const string& source) {
+    leveldb::DB* db;
+    leveldb::Options options;
+    options.create_if_missing = false;
+    options.max_open_files = 100;
+    LOG(INFO) << "Opening leveldb " << source;
+    leveldb::Status status = leveldb::DB::Open(options, source, &db);
+    CHECK(status.ok()) << "Failed to open leveldb " << source << std::endl
+        << status.ToString();
+    db_.reset(db);
+  }
+
+  virtual DatabaseCursor* NewCursor() {
+    return new LevelDBCursor(db_->NewIterator(leveldb::ReadOptions()));
+  }
+
+ private:
+  shared_ptr<leveldb::DB> db_;
+};
+
+class LMDBCursor : public DatabaseCursor {
+ public:
+  LMDBCursor(MDB_env* env, MDB_dbi dbi) {
+    MDB_CHECK(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn_));
+    MDB_CHECK(mdb_cursor_open(txn_, dbi, &cursor_));
+    SeekToFirstRecord();
+  }
+  virtual ~LMDBCursor() {
+    mdb_cursor_close(cursor_);
+    mdb_txn_abort(txn_);
+  }
+
+  virtual string key() const {
+    return string(static_cast<const char*>(key_.mv_data), key_.mv_size);
+  }
+  virtual const void* value() const { return value_.mv_data; }
+  virtual size_t value_size() const { return value_.mv_size; }
+
+ protected:
+  virtual void SeekToFirstRecord() {
+    const int rc = mdb_cursor_get(cursor_, &key_, &value_, MDB_FIRST);
+    CHECK_NE(rc, MDB_NOTFOUND) << "The database is empty.";
+    MDB_CHECK(rc);
+  }
+  virtual bool NextRecord() {
+    const int rc = mdb_cursor_get(cursor_, &key_, &value_, MDB_NEXT);
+    if (rc == MDB_NOTFOUND) {
+      return false;
+    }
+    MDB_CHECK(rc);
+    return true;
+  }
+
+ private:
+  MDB_txn* txn_;
+  MDB_cursor* cursor_;
+  MDB_val key_;
+  MDB_val value_;
+};
+
+class LMDBDatabase : public Database {
+ public:
+  explicit LMDBDatabase(const string& source) {
+    LOG(INFO) << "Opening lmdb " << source;
+    MDB_CHECK(mdb_env_create(&env_));
+    // MDB_NOTLS ties read transactions to their cursors rather than to the
+    // thread that began them, so that a prefetch thread can use cursors
+    // made by another.
+    const int rc = mdb_env_open(env_, source.c_str(), MDB_RDONLY | MDB_NOTLS,
+        0664);
+    CHECK_EQ(rc, MDB_SUCCESS) << "Failed to open lmdb " << source << ": "
+        << mdb_strerror(rc);
+    MDB_txn* txn;
+    MDB_CHECK(mdb_txn_begin(env_, NULL, MDB_RDONLY, &txn));
+    MDB_CHECK(mdb_dbi_open(txn, NULL, 0, &dbi_));
+    MDB_CHECK(mdb_txn_commit(txn));
+  }
+  virtual ~LMDBDatabase() {
+    mdb_env_close(env_);
+  }
+
+  virtual DatabaseCursor* NewCursor() {
+    return new LMDBCursor(env_, dbi_);
+  }
+
+ private:
+  MDB_env* env_;
+  MDB_dbi dbi_;
+};
+
+}  // namespace
+
+Database* Database::Open(const DataParameter_DB backend,
+    const string& source) {
+  switch (backend) {
+  case DataParameter_DB_LEVELDB:
+    return new LevelDBDatabase(source);
+  case DataParameter_DB_LMDB:
+    return new LMDBDatabase(source);
+  default:
+    LOG(FATAL) << "Unknown database backend " << backend;
+  }
+  return NULL;
+}
+
+}  // namespace caffe
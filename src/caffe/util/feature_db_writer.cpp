@@ -0,0 +1,158 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <leveldb/db.h>
+#include <leveldb/write_batch.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/feature_db_writer.hpp"
+
+namespace caffe {
+
+string FeatureKey(const int index) {
+  char key[32];
+  snprintf(key, sizeof(key), "%016d", index);
+  return string(key);
+}
+
+FeatureDBWriter::FeatureDBWriter(const string& path, const int num_threads,
+    const int queue_size, const bool bulk_load)
+    : bulk_load_(bulk_load), queue_size_(queue_size), closing_(false),
+      next_sequence_(0), next_commit_(0), num_written_(0) {
+  CHECK_GT(num_threads, 0);
+  CHECK_GT(queue_size, 0);
+  leveldb::Options options;
+  options.error_if_exists = true;
+  options.create_if_missing = true;
+  options.write_buffer_size = 268435456;
+  LOG(INFO) << "Opening leveldb " << path;
+  leveldb::Status status = leveldb::DB::Open(options, path, &db_);
+  CHECK(status.ok()) << "Failed to open leveldb " << path << ": "
+      << status.ToString();
+  CHECK(!pthread_mutex_init(&mutex_, NULL));
+  CHECK(!pthread_cond_init(&not_empty_, NULL));
+  CHECK(!pthread_cond_init(&not_full_, NULL));
+  CHECK(!pthread_cond_init(&committed_, NULL));
+  threads_.resize(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    CHECK(!pthread_create(&threads_[i], NULL, WriterThread, this))
+        << "Pthread execution failed.";
+  }
+}
+
+FeatureDBWriter::~FeatureDBWriter() {
+  Close();
+  pthread_cond_destroy(&committed_);
+  pthread_cond_destroy(&not_full_);
+  pthread_cond_destroy(&not_empty_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+template <typename Dtype>
+void FeatureDBWriter::Write(const int first_index, const int num,
+    const int dim, const Dtype* features) {
+  CHECK(db_) << "Writing to a closed feature writer.";
+  Batch* batch = new Batch;
+  batch->first_index = first_index;
+  batch->num = num;
+  batch->dim = dim;
+  batch->features.assign(features, features + num * dim);
+  pthread_mutex_lock(&mutex_);
+  while (queue_.size() >= queue_size_) {
+    pthread_cond_wait(&not_full_, &mutex_);
+  }
+  batch->sequence = next_sequence_++;
+  queue_.push_back(batch);
+  pthread_cond_signal(&not_empty_);
+  pthread_mutex_unlock(&mutex_);
+}
+
+template void FeatureDBWriter::Write(const int first_index, const int num,
+    const int dim, const float* features);
+template void FeatureDBWriter::Write(const int first_index, const int num,
+    const int dim, const double* features);
+
+void* FeatureDBWriter::WriterThread(void* writer_pointer) {
+  FeatureDBWriter* writer = static_cast<FeatureDBWriter*>(writer_pointer);
+  while (true) {
+    pthread_mutex_lock(&writer->mutex_);
+    while (writer->queue_.empty() && !writer->closing_) {
+      pthread_cond_wait(&writer->not_empty_, &writer->mutex_);
+    }
+    if (writer->queue_.empty()) {
+      pthread_mutex_unlock(&writer->mutex_);
+      break;
+    }
+    Batch* batch = writer->queue_.front();
+    writer->queue_.pop_front();
+    pthread_cond_signal(&writer->not_full_);
+    pthread_mutex_unlock(&writer->mutex_);
+    writer->CommitBatch(*batch);
+    delete batch;
+  }
+  return static_cast<void*>(NULL);
+}
+
+void FeatureDBWriter::CommitBatch(const Batch& batch) {
+  leveldb::WriteBatch write_batch;
+  Datum datum;
+  datum.set_channels(1);
+  datum.set_height(batch.dim);
+  datum.set_width(1);
+  string value;
+  for (int n = 0; n < batch.num; ++n) {
+    // One copy of the whole feature instead of an add_float_data per value.
+    datum.mutable_float_data()->Resize(batch.dim, 0);
+    memcpy(datum.mutable_float_data()->mutable_data(),
+        &batch.features[n * batch.dim], batch.dim * sizeof(float));
+    datum.SerializeToString(&value);
+    write_batch.Put(FeatureKey(batch.first_index + n), value);
+  }
+  if (bulk_load_) {
+    pthread_mutex_lock(&mutex_);
+    while (next_commit_ != batch.sequence) {
+      pthread_cond_wait(&committed_, &mutex_);
+    }
+    pthread_mutex_unlock(&mutex_);
+  }
+  leveldb::Status status = db_->Write(leveldb::WriteOptions(), &write_batch);
+  CHECK(status.ok()) << "Failed to write features: " << status.ToString();
+  pthread_mutex_lock(&mutex_);
+  num_written_ += batch.num;
+  if (bulk_load_) {
+    ++next_commit_;
+    pthread_cond_broadcast(&committed_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void FeatureDBWriter::Close() {
+  if (!db_) {
+    return;
+  }
+  pthread_mutex_lock(&mutex_);
+  closing_ = true;
+  pthread_cond_broadcast(&not_empty_);
+  pthread_mutex_unlock(&mutex_);
+  for (int i = 0; i < threads_.size(); ++i) {
+    CHECK(!pthread_join(threads_[i], NULL)) << "Pthread joining failed.";
+  }
+  threads_.clear();
+  delete db_;
+  db_ = NULL;
+}
+
+int FeatureDBWriter::num_written() {
+  pthread_mutex_lock(&mutex_);
+  const int num_written = num_written_;
+  pthread_mutex_unlock(&mutex_);
+  return num_written;
+}
+
+}  // namespace caffe
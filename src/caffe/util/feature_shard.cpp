@@ -0,0 +1,265 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <fcntl.h>
+#include <snappy.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/feature_shard.hpp"
+#include "caffe/util/float16.hpp"
+
+namespace caffe {
+
+static string ShardFilename(const string& prefix, const int shard_id) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".shard-%05d", shard_id);
+  return prefix + suffix;
+}
+
+template <typename T>
+static void AppendRaw(const T& value, string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+FeatureShardWriter::FeatureShardWriter(const string& prefix,
+    const FeatureStorage storage, const bool compress,
+    const uint64_t max_shard_size)
+    : prefix_(prefix), storage_(storage), compress_(compress),
+      max_shard_size_(max_shard_size), shard_file_(NULL), shard_id_(-1),
+      shard_size_(0) {
+  const string index_filename = prefix_ + ".index";
+  index_file_ = fopen(index_filename.c_str(), "wb");
+  CHECK(index_file_) << "Failed to open " << index_filename;
+  OpenShard();
+}
+
+FeatureShardWriter::~FeatureShardWriter() {
+  Close();
+}
+
+void FeatureShardWriter::OpenShard() {
+  if (shard_file_) {
+    CHECK_EQ(fclose(shard_file_), 0) << "Failed to write shard " << shard_id_;
+  }
+  ++shard_id_;
+  const string filename = ShardFilename(prefix_, shard_id_);
+  shard_file_ = fopen(filename.c_str(), "wb");
+  CHECK(shard_file_) << "Failed to open " << filename;
+  shard_size_ = 0;
+}
+
+void FeatureShardWriter::Close() {
+  if (shard_file_) {
+    CHECK_EQ(fclose(shard_file_), 0) << "Failed to write shard " << shard_id_;
+    shard_file_ = NULL;
+  }
+  if (index_file_) {
+    CHECK_EQ(fclose(index_file_), 0) << "Failed to write " << prefix_
+        << ".index";
+    index_file_ = NULL;
+  }
+}
+
+template <typename Dtype>
+void FeatureShardWriter::Write(const string& key, Blob<Dtype>* blob,
+    const int num_index) {
+  const int num = num_index < 0 ? blob->num() : 1;
+  const Dtype* data = blob->cpu_data() +
+      (num_index < 0 ? 0 : blob->offset(num_index));
+  const int count = num * blob->channels() * blob->length() * blob->height()
+      * blob->width();
+  float_buffer_.resize(count);
+  for (int i = 0; i < count; ++i) {
+    float_buffer_[i] = data[i];
+  }
+  Append(key, &float_buffer_[0], num, blob->channels(), blob->length(),
+      blob->height(), blob->width());
+}
+
+template <>
+void FeatureShardWriter::Write<float>(const string& key, Blob<float>* blob,
+    const int num_index) {
+  const int num = num_index < 0 ? blob->num() : 1;
+  Append(key, blob->cpu_data() + (num_index < 0 ? 0 : blob->offset(num_index)),
+      num, blob->channels(), blob->length(), blob->height(), blob->width());
+}
+
+void FeatureShardWriter::Append(const string& key, const float* data,
+    const int num, const int channels, const int length, const int height,
+    const int width) {
+  CHECK(shard_file_) << "Writing to a closed feature shard writer.";
+  const int count = num * channels * length * height * width;
+  const char* record = reinterpret_cast<const char*>(data);
+  size_t record_size = count * sizeof(float);
+  if (storage_ == FEATURE_FLOAT16) {
+    half_buffer_.resize(count);
+    FloatToHalf(count, data, &half_buffer_[0]);
+    record = reinterpret_cast<const char*>(&half_buffer_[0]);
+    record_size = count * sizeof(uint16_t);
+  }
+  if (compress_) {
+    snappy::Compress(record, record_size, &compressed_buffer_);
+    record = compressed_buffer_.data();
+    record_size = compressed_buffer_.size();
+  }
+  if (shard_size_ > 0 && shard_size_ + record_size > max_shard_size_) {
+    OpenShard();
+  }
+  CHECK_EQ(fwrite(record, 1, record_size, shard_file_), record_size)
+      << "Failed to write shard " << shard_id_;
+  string entry;
+  AppendRaw(static_cast<uint32_t>(key.size()), &entry);
+  entry.append(key);
+  AppendRaw(static_cast<int32_t>(shard_id_), &entry);
+  AppendRaw(shard_size_, &entry);
+  AppendRaw(static_cast<uint32_t>(record_size), &entry);
+  AppendRaw(static_cast<int32_t>(num), &entry);
+  AppendRaw(static_cast<int32_t>(channels), &entry);
+  AppendRaw(static_cast<int32_t>(length), &entry);
+  AppendRaw(static_cast<int32_t>(height), &entry);
+  AppendRaw(static_cast<int32_t>(width), &entry);
+  AppendRaw(static_cast<uint8_t>(storage_), &entry);
+  AppendRaw(static_cast<uint8_t>(compress_), &entry);
+  CHECK_EQ(fwrite(entry.data(), 1, entry.size(), index_file_), entry.size())
+      << "Failed to write " << prefix_ << ".index";
+  shard_size_ += record_size;
+}
+
+template void FeatureShardWriter::Write(const string& key, Blob<double>* blob,
+    const int num_index);
+
+template <typename T>
+static bool ReadRaw(FILE* file, T* value) {
+  return fread(value, sizeof(T), 1, file) == 1;
+}
+
+FeatureShardReader::FeatureShardReader(const string& prefix) {
+  const string index_filename = prefix + ".index";
+  FILE* index_file = fopen(index_filename.c_str(), "rb");
+  CHECK(index_file) << "Failed to open " << index_filename;
+  int num_shards = 0;
+  uint32_t key_size;
+  while (ReadRaw(index_file, &key_size)) {
+    string key(key_size, '\0');
+    FeatureRecord record;
+    int32_t shard, dims[5];
+    uint32_t stored_size;
+    uint8_t storage, compressed;
+    CHECK(fread(&key[0], 1, key_size, index_file) == key_size &&
+        ReadRaw(index_file, &shard) && ReadRaw(index_file, &record.offset) &&
+        ReadRaw(index_file, &stored_size) &&
+        fread(dims, sizeof(dims[0]), 5, index_file) == 5 &&
+        ReadRaw(index_file, &storage) && ReadRaw(index_file, &compressed))
+        << "Truncated feature index " << index_filename;
+    record.shard = shard;
+    record.stored_size = stored_size;
+    record.num = dims[0];
+    record.channels = dims[1];
+    record.length = dims[2];
+    record.height = dims[3];
+    record.width = dims[4];
+    CHECK_LE(storage, FEATURE_FLOAT16) << "Unknown feature storage.";
+    record.storage = static_cast<FeatureStorage>(storage);
+    record.compressed = compressed;
+    records_[key] = record;
+    num_shards = std::max(num_shards, shard + 1);
+  }
+  fclose(index_file);
+  shard_data_.resize(num_shards, static_cast<char*>(NULL));
+  shard_sizes_.resize(num_shards, 0);
+  for (int i = 0; i < num_shards; ++i) {
+    const string filename = ShardFilename(prefix, i);
+    int fd = open(filename.c_str(), O_RDONLY);
+    CHECK_NE(fd, -1) << "File not found: " << filename;
+    struct stat file_stat;
+    CHECK_EQ(fstat(fd, &file_stat), 0) << "Cannot stat " << filename;
+    shard_sizes_[i] = file_stat.st_size;
+    if (shard_sizes_[i] > 0) {
+      void* data = mmap(NULL, shard_sizes_[i], PROT_READ, MAP_SHARED, fd, 0);
+      CHECK(data != MAP_FAILED) << "Failed to map " << filename;
+      shard_data_[i] = static_cast<char*>(data);
+    }
+    close(fd);
+  }
+  for (map<string, FeatureRecord>::const_iterator it = records_.begin();
+       it != records_.end(); ++it) {
+    CHECK_LE(it->second.offset + it->second.stored_size,
+        shard_sizes_[it->second.shard])
+        << "Truncated shard for feature " << it->first;
+  }
+}
+
+FeatureShardReader::~FeatureShardReader() {
+  for (int i = 0; i < shard_data_.size(); ++i) {
+    if (shard_data_[i]) {
+      munmap(shard_data_[i], shard_sizes_[i]);
+    }
+  }
+}
+
+const FeatureRecord* FeatureShardReader::Find(const string& key) const {
+  map<string, FeatureRecord>::const_iterator it = records_.find(key);
+  return it == records_.end() ? NULL : &it->second;
+}
+
+template <typename Dtype>
+bool FeatureShardReader::Read(const string& key, Blob<Dtype>* blob) const {
+  const FeatureRecord* record = Find(key);
+  if (!record) {
+    return false;
+  }
+  blob->Reshape(record->num, record->channels, record->length, record->height,
+      record->width);
+  const int count = record->count();
+  const size_t element_size = record->storage == FEATURE_FLOAT16 ?
+      sizeof(uint16_t) : sizeof(float);
+  const char* stored = shard_data_[record->shard] + record->offset;
+  string uncompressed;
+  if (record->compressed) {
+    size_t uncompressed_size;
+    CHECK(snappy::GetUncompressedLength(stored, record->stored_size,
+        &uncompressed_size)) << "Corrupt feature " << key;
+    CHECK_EQ(uncompressed_size, count * element_size)
+        << "Corrupt feature " << key;
+    uncompressed.resize(uncompressed_size);
+    CHECK(snappy::RawUncompress(stored, record->stored_size, &uncompressed[0]))
+        << "Corrupt feature " << key;
+    stored = uncompressed.data();
+  } else {
+    CHECK_EQ(record->stored_size, count * element_size)
+        << "Corrupt feature " << key;
+  }
+  // The shards carry no alignment, so go through memcpy.
+  Dtype* data = blob->mutable_cpu_data();
+  if (record->storage == FEATURE_FLOAT16) {
+    for (int i = 0; i < count; ++i) {
+      uint16_t value;
+      memcpy(&value, stored + i * sizeof(value), sizeof(value));
+      data[i] = HalfToFloat(value);
+    }
+  } else {
+    for (int i = 0; i < count; ++i) {
+      float value;
+      memcpy(&value, stored + i * sizeof(value), sizeof(value));
+      data[i] = value;
+    }
+  }
+  return true;
+}
+
+template bool FeatureShardReader::Read(const string& key, Blob<float>* blob)
+    const;
+template bool FeatureShardReader::Read(const string& key, Blob<double>* blob)
+    const;
+
+}  // namespace caffe
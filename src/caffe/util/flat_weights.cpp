@@ -0,0 +1,147 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/flat_weights.hpp"
+
+namespace caffe {
+
+static uint64_t AlignUp(const uint64_t offset) {
+  return (offset + kFlatWeightsAlignment - 1) /
+      kFlatWeightsAlignment * kFlatWeightsAlignment;
+}
+
+template <typename T>
+static void AppendRaw(const T& value, string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void WriteFlatWeightsFile(const NetParameter& param, const string& filename) {
+  FILE* file = fopen(filename.c_str(), "wb");
+  CHECK(file) << "Failed to open " << filename << " for writing.";
+  FlatWeightsHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kFlatWeightsMagic, sizeof(header.magic));
+  header.version = kFlatWeightsVersion;
+  uint64_t offset = sizeof(header);
+  CHECK_EQ(fwrite(&header, sizeof(header), 1, file), 1);
+  string index;
+  const char padding[kFlatWeightsAlignment] = {0};
+  for (int i = 0; i < param.layers_size(); ++i) {
+    const LayerParameter& layer = param.layers(i);
+    for (int j = 0; j < layer.blobs_size(); ++j) {
+      const BlobProto& blob = layer.blobs(j);
+      // Old models leave length unset, which means 1 (see Blob::FromProto).
+      const int length = blob.length() ? blob.length() : 1;
+      const int count = blob.num() * blob.channels() * length * blob.height()
+          * blob.width();
+      CHECK_EQ(count, blob.data_size())
+          << "Incorrect data size for blob " << j << " of " << layer.name();
+      const uint64_t data_offset = AlignUp(offset);
+      CHECK_EQ(fwrite(padding, 1, data_offset - offset, file),
+          data_offset - offset);
+      CHECK_EQ(fwrite(blob.data().data(), sizeof(float), count, file), count);
+      offset = data_offset + count * sizeof(float);
+      const uint32_t name_size = layer.name().size();
+      AppendRaw(name_size, &index);
+      index.append(layer.name());
+      AppendRaw(static_cast<int32_t>(j), &index);
+      AppendRaw(static_cast<int32_t>(blob.num()), &index);
+      AppendRaw(static_cast<int32_t>(blob.channels()), &index);
+      AppendRaw(static_cast<int32_t>(length), &index);
+      AppendRaw(static_cast<int32_t>(blob.height()), &index);
+      AppendRaw(static_cast<int32_t>(blob.width()), &index);
+      AppendRaw(data_offset, &index);
+      ++header.num_blobs;
+    }
+  }
+  header.index_offset = offset;
+  header.index_size = index.size();
+  CHECK_EQ(fwrite(index.data(), 1, index.size(), file), index.size());
+  CHECK_EQ(fseek(file, 0, SEEK_SET), 0);
+  CHECK_EQ(fwrite(&header, sizeof(header), 1, file), 1);
+  CHECK_EQ(fclose(file), 0) << "Failed to write " << filename;
+}
+
+bool IsFlatWeightsFile(const string& filename) {
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  char magic[sizeof(kFlatWeightsMagic)];
+  const bool is_flat = fread(magic, sizeof(magic), 1, file) == 1 &&
+      memcmp(magic, kFlatWeightsMagic, sizeof(magic)) == 0;
+  fclose(file);
+  return is_flat;
+}
+
+template <typename T>
+static T ReadRaw(const char** cursor, const char* end) {
+  CHECK_LE(*cursor + sizeof(T), end) << "Truncated flat weight index.";
+  T value;
+  memcpy(&value, *cursor, sizeof(T));
+  *cursor += sizeof(T);
+  return value;
+}
+
+FlatWeightsFile::FlatWeightsFile(const string& filename)
+    : filename_(filename), base_(NULL), size_(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  CHECK_NE(fd, -1) << "File not found: " << filename;
+  struct stat file_stat;
+  CHECK_EQ(fstat(fd, &file_stat), 0) << "Cannot stat " << filename;
+  size_ = file_stat.st_size;
+  CHECK_GE(size_, sizeof(FlatWeightsHeader)) << "Truncated file " << filename;
+  // Private writable mapping: pages stay shared with the page cache until
+  // someone writes to them, e.g. when training starts from these weights.
+  void* base = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  CHECK(base != MAP_FAILED) << "Failed to map " << filename;
+  base_ = static_cast<char*>(base);
+  FlatWeightsHeader header;
+  memcpy(&header, base_, sizeof(header));
+  CHECK_EQ(memcmp(header.magic, kFlatWeightsMagic, sizeof(header.magic)), 0)
+      << filename << " is not a flat weight file.";
+  CHECK_EQ(header.version, kFlatWeightsVersion)
+      << "Unsupported flat weight file version (or byte order) in " << filename;
+  CHECK_LE(header.index_offset + header.index_size, size_)
+      << "Truncated file " << filename;
+  const char* cursor = base_ + header.index_offset;
+  const char* end = cursor + header.index_size;
+  entries_.resize(header.num_blobs);
+  for (int i = 0; i < entries_.size(); ++i) {
+    FlatWeightsEntry& entry = entries_[i];
+    const uint32_t name_size = ReadRaw<uint32_t>(&cursor, end);
+    CHECK_LE(cursor + name_size, end) << "Truncated flat weight index.";
+    entry.layer_name.assign(cursor, name_size);
+    cursor += name_size;
+    entry.blob_id = ReadRaw<int32_t>(&cursor, end);
+    entry.num = ReadRaw<int32_t>(&cursor, end);
+    entry.channels = ReadRaw<int32_t>(&cursor, end);
+    entry.length = ReadRaw<int32_t>(&cursor, end);
+    entry.height = ReadRaw<int32_t>(&cursor, end);
+    entry.width = ReadRaw<int32_t>(&cursor, end);
+    entry.offset = ReadRaw<uint64_t>(&cursor, end);
+    CHECK_EQ(entry.offset % kFlatWeightsAlignment, 0);
+    CHECK_LE(entry.offset + entry.count() * sizeof(float), size_)
+        << "Truncated tensor for layer " << entry.layer_name;
+  }
+}
+
+FlatWeightsFile::~FlatWeightsFile() {
+  if (base_) {
+    munmap(base_, size_);
+  }
+}
+
+}  // namespace caffe
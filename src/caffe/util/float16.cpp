@@ -0,0 +1,177 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <stdint.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <cmath>
+#include <cstring>
+
+#include "caffe/util/float16.hpp"
+
+namespace caffe {
+
+uint16_t FloatToHalf(const float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  uint32_t abs_bits = bits & 0x7fffffff;
+  if (abs_bits >= 0x7f800000) {
+    // Infinity, or NaN with its top mantissa bit set so that it stays NaN.
+    return sign | 0x7c00 | (abs_bits > 0x7f800000 ? 0x200 : 0);
+  }
+  if (abs_bits >= 0x477ff000) {
+    // 65520 and up round to infinity.
+    return sign | 0x7c00;
+  }
+  if (abs_bits < 0x38800000) {
+    // Below the smallest normal half: count units of 2^-24, which is exact
+    // in float, and let rint round to nearest even.
+    float abs_value;
+    memcpy(&abs_value, &abs_bits, sizeof(abs_value));
+    return sign | static_cast<uint16_t>(rint(abs_value * 16777216.0f));
+  }
+  // Rebias the exponent from 127 to 15 and round the 13 dropped mantissa
+  // bits to nearest even.
+  abs_bits += 0xc8000fff + ((abs_bits >> 13) & 1);
+  return sign | static_cast<uint16_t>(abs_bits >> 13);
+}
+
+float HalfToFloat(const uint16_t value) {
+  const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+  const uint32_t exponent = (value >> 10) & 0x1f;
+  const uint32_t mantissa = value & 0x3ff;
+  uint32_t bits;
+  if (exponent == 0) {
+    // Zero or subnormal: mantissa * 2^-24.
+    float abs_value = mantissa / 16777216.0f;
+    memcpy(&bits, &abs_value, sizeof(bits));
+    bits |= sign;
+  } else if (exponent == 0x1f) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+void FloatToHalf(const int n, const float* x, uint16_t* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = FloatToHalf(x[i]);
+  }
+}
+
+uint16_t FloatToBfloat16(const float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  if ((bits & 0x7fffffff) > 0x7f800000) {
+    // Keep NaNs NaN even if their mantissa bits are all in the low half.
+    return (bits >> 16) | 0x40;
+  }
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return bits >> 16;
+}
+
+float Bfloat16ToFloat(const uint16_t value) {
+  const uint32_t bits = static_cast<uint32_t>(value) << 16;
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+template <typename Dtype>
+void ToHalf(const HalfFormat format, const int n, const Dtype* x,
+    uint16_t* y) {
+  if (format == HALF_FLOAT16) {
+    for (int i = 0; i < n; ++i) {
+      y[i] = FloatToHalf(static_cast<float>(x[i]));
+    }
+  } else {
+    for (int i = 0; i < n; ++i) {
+      y[i] = FloatToBfloat16(static_cast<float>(x[i]));
+    }
+  }
+}
+
+template void ToHalf<float>(const HalfFormat format, const int n,
+    const float* x, uint16_t* y);
+template void ToHalf<double>(const HalfFormat format, const int n,
+    const double* x, uint16_t* y);
+
+template <typename Dtype>
+void FromHalf(const HalfFormat format, const int n, const uint16_t* x,
+    Dtype* y) {
+  if (format == HALF_FLOAT16) {
+    for (int i = 0; i < n; ++i) {
+      y[i] = HalfToFloat(x[i]);
+    }
+  } else {
+    for (int i = 0; i < n; ++i) {
+      y[i] = Bfloat16ToFloat(x[i]);
+    }
+  }
+}
+
+template <>
+void FromHalf<float>(const HalfFormat format, const int n, const uint16_t* x,
+    float* y) {
+  int i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  if (format == HALF_FLOAT16) {
+    // Shifting the exponent and mantissa into place and scaling by 2^112
+    // rebiases normals and normalizes subnormals in one multiply; only
+    // infinities and NaNs need their exponent forced to all ones.
+    const __m128i sign_mask = _mm_set1_epi32(0x8000);
+    const __m128i abs_mask = _mm_set1_epi32(0x7fff);
+    const __m128i max_finite = _mm_set1_epi32(0x0f7fffff);
+    const __m128i float_exponent = _mm_set1_epi32(0x7f800000);
+    const __m128 rebias = _mm_castsi128_ps(_mm_set1_epi32(0x77800000));
+    for (; i + 8 <= n; i += 8) {
+      const __m128i halves =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+      for (int part = 0; part < 2; ++part) {
+        const __m128i h = part ? _mm_unpackhi_epi16(halves, zero) :
+            _mm_unpacklo_epi16(halves, zero);
+        const __m128i sign = _mm_slli_epi32(_mm_and_si128(h, sign_mask), 16);
+        const __m128i shifted = _mm_slli_epi32(_mm_and_si128(h, abs_mask), 13);
+        __m128i bits = _mm_castps_si128(
+            _mm_mul_ps(_mm_castsi128_ps(shifted), rebias));
+        bits = _mm_or_si128(bits, _mm_and_si128(
+            _mm_cmpgt_epi32(shifted, max_finite), float_exponent));
+        _mm_storeu_ps(y + i + 4 * part,
+            _mm_castsi128_ps(_mm_or_si128(bits, sign)));
+      }
+    }
+  } else {
+    for (; i + 8 <= n; i += 8) {
+      const __m128i halves =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+      _mm_storeu_ps(y + i, _mm_castsi128_ps(_mm_unpacklo_epi16(zero, halves)));
+      _mm_storeu_ps(y + i + 4,
+          _mm_castsi128_ps(_mm_unpackhi_epi16(zero, halves)));
+    }
+  }
+#endif
+  if (format == HALF_FLOAT16) {
+    for (; i < n; ++i) {
+      y[i] = HalfToFloat(x[i]);
+    }
+  } else {
+    for (; i < n; ++i) {
+      y[i] = Bfloat16ToFloat(x[i]);
+    }
+  }
+}
+
+template void FromHalf<double>(const HalfFormat format, const int n,
+    const uint16_t* x, double* y);
+
+void HalfToFloat(const int n, const uint16_t* x, float* y) {
+  FromHalf(HALF_FLOAT16, n, x, y);
+}
+
+}  // namespace caffe
@@ -0,0 +1,170 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/host_allocator.hpp"
+
+namespace caffe {
+
+// The cache keeps up to this many bytes of returned blocks by default.
+static const size_t kDefaultHostCacheLimit = size_t(1) << 30;
+
+static HostAllocator* host_allocator = NULL;
+static pthread_once_t host_allocator_once = PTHREAD_ONCE_INIT;
+
+void HostAllocator::CreateInstance() {
+  // Never deleted: blobs in static objects may free their memory after any
+  // destructor of this file would have run.
+  host_allocator = new HostAllocator();
+}
+
+HostAllocator& HostAllocator::Get() {
+  pthread_once(&host_allocator_once, CreateInstance);
+  return *host_allocator;
+}
+
+HostAllocator::HostAllocator()
+    : cache_limit_(kDefaultHostCacheLimit), huge_pages_(false) {
+  CHECK(!pthread_mutex_init(&mutex_, NULL));
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+size_t HostAllocator::SizeClass(size_t size) {
+  if (size <= kHostAlignment) {
+    return kHostAlignment;
+  }
+  // Quarters of the largest power of two below size, e.g. 80, 96, 112, 128
+  // for the sizes in (64, 128].
+  size_t power = kHostAlignment;
+  while (power * 2 < size) {
+    power *= 2;
+  }
+  const size_t step = power / 4;
+  return (size + step - 1) / step * step;
+}
+
+void* HostAllocator::SystemAllocate(size_t size_class, bool huge_pages) {
+  if (size_class >= kHostMapThreshold) {
+    void* ptr = mmap(NULL, size_class, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(ptr != MAP_FAILED) << "Failed to map " << size_class << " bytes.";
+#ifdef MADV_HUGEPAGE
+    if (huge_pages) {
+      // Only a hint: the kernel may lack transparent huge pages.
+      madvise(ptr, size_class, MADV_HUGEPAGE);
+    }
+#endif
+    return ptr;
+  }
+  void* ptr = NULL;
+  CHECK_EQ(posix_memalign(&ptr, kHostAlignment, size_class), 0)
+      << "Failed to allocate " << size_class << " bytes.";
+  return ptr;
+}
+
+void HostAllocator::SystemFree(void* ptr, size_t size_class) {
+  if (size_class >= kHostMapThreshold) {
+    CHECK_EQ(munmap(ptr, size_class), 0);
+  } else {
+    free(ptr);
+  }
+}
+
+void* HostAllocator::Allocate(size_t size, bool* zeroed) {
+  const size_t size_class = SizeClass(size);
+  void* ptr = NULL;
+  pthread_mutex_lock(&mutex_);
+  ++stats_.allocations;
+  stats_.in_use_bytes += size_class;
+  stats_.peak_in_use_bytes =
+      std::max(stats_.peak_in_use_bytes, stats_.in_use_bytes);
+  std::map<size_t, std::vector<void*> >::iterator it =
+      free_lists_.find(size_class);
+  if (it != free_lists_.end() && !it->second.empty()) {
+    ptr = it->second.back();
+    it->second.pop_back();
+    stats_.cached_bytes -= size_class;
+    ++stats_.cache_hits;
+  }
+  const bool huge_pages = huge_pages_;
+  pthread_mutex_unlock(&mutex_);
+  if (ptr) {
+    *zeroed = false;
+    return ptr;
+  }
+  // Fresh anonymous mappings are zero-filled by the kernel.
+  *zeroed = (size_class >= kHostMapThreshold);
+  return SystemAllocate(size_class, huge_pages);
+}
+
+void HostAllocator::Free(void* ptr, size_t size) {
+  if (!ptr) {
+    return;
+  }
+  const size_t size_class = SizeClass(size);
+  pthread_mutex_lock(&mutex_);
+  stats_.in_use_bytes -= size_class;
+  const bool keep = (stats_.cached_bytes + size_class <= cache_limit_);
+  if (keep) {
+    free_lists_[size_class].push_back(ptr);
+    stats_.cached_bytes += size_class;
+  }
+  pthread_mutex_unlock(&mutex_);
+  if (!keep) {
+    SystemFree(ptr, size_class);
+  }
+}
+
+void HostAllocator::ReleaseCached() {
+  std::map<size_t, std::vector<void*> > free_lists;
+  pthread_mutex_lock(&mutex_);
+  free_lists.swap(free_lists_);
+  stats_.cached_bytes = 0;
+  pthread_mutex_unlock(&mutex_);
+  for (std::map<size_t, std::vector<void*> >::iterator it =
+       free_lists.begin(); it != free_lists.end(); ++it) {
+    for (int i = 0; i < it->second.size(); ++i) {
+      SystemFree(it->second[i], it->first);
+    }
+  }
+}
+
+HostMemoryStats HostAllocator::stats() {
+  pthread_mutex_lock(&mutex_);
+  const HostMemoryStats stats = stats_;
+  pthread_mutex_unlock(&mutex_);
+  return stats;
+}
+
+size_t HostAllocator::cache_limit() {
+  pthread_mutex_lock(&mutex_);
+  const size_t limit = cache_limit_;
+  pthread_mutex_unlock(&mutex_);
+  return limit;
+}
+
+void HostAllocator::set_cache_limit(size_t bytes) {
+  pthread_mutex_lock(&mutex_);
+  cache_limit_ = bytes;
+  const bool over_limit = (stats_.cached_bytes > cache_limit_);
+  pthread_mutex_unlock(&mutex_);
+  if (over_limit) {
+    ReleaseCached();
+  }
+}
+
+void HostAllocator::set_huge_pages(bool enable) {
+  pthread_mutex_lock(&mutex_);
+  huge_pages_ = enable;
+  pthread_mutex_unlock(&mutex_);
+}
+
+}  // namespace caffe
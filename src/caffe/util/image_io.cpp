@@ -25,9 +25,11 @@
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include <algorithm>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <fstream>  // NOLINT(readability/streams)
+#include <iterator>
 #include <stdio.h>
 
 #include "caffe/common.hpp"
@@ -173,74 +175,145 @@ bool ReadVideoToVolumeDatum(const char* filename, const int start_frm, const int
  	return true;
 }
 
-bool ReadImageSequenceToVolumeDatum(const char* img_dir, const int frm_num, const int label,
-		const int length, const int height, const int width, const int seg_id, const bool temporal_jitter, VolumeDatum* datum){
-	char fn_im[256];
-	cv::Mat img, img_origin;
-	char *buffer;
-	int offset, channel_size, image_size, data_size;
-	int start_pos[4];
-	int end_pos[4];
+// Reads the height and width of a baseline or progressive JPEG from its
+// start-of-frame marker.
+static bool JpegSize(const std::vector<uchar>& buf, int* rows, int* cols){
+	if (buf.size() < 4 || buf[0] != 0xFF || buf[1] != 0xD8)
+		return false;
+	size_t pos = 2;
+	while (pos + 9 < buf.size()) {
+		if (buf[pos] != 0xFF) {
+			++pos;
+			continue;
+		}
+		const uchar marker = buf[pos + 1];
+		if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 &&
+				marker != 0xC8 && marker != 0xCC) {
+			*rows = (buf[pos + 5] << 8) | buf[pos + 6];
+			*cols = (buf[pos + 7] << 8) | buf[pos + 8];
+			return true;
+		}
+		if (marker == 0xFF || marker == 0xD8 || (marker >= 0xD0 && marker <= 0xD7)) {
+			++pos;
+			continue;
+		}
+		pos += 2 + ((buf[pos + 2] << 8) | buf[pos + 3]);
+	}
+	return false;
+}
 
-	if (frm_num <= length) {
-		start_pos[0] = start_pos[1] = start_pos[2] = 1;
-		end_pos[0] = end_pos[1] = end_pos[2] = frm_num;
-	} else if (frm_num > length && frm_num < length*3) {
-		offset = length - (length*3-frm_num)/2;
-		start_pos[0] = 1;
-		end_pos[0] = length;
-		start_pos[1] = start_pos[0] + offset;
-		end_pos[1] = start_pos[1] + length - 1;
-		start_pos[2] = start_pos[1] + offset;
-		end_pos[2] = frm_num;
+bool ReadImageFrame(const char* filename, const int height, const int width,
+		const bool reduced_decode, cv::Mat* img){
+	if (height <= 0 || width <= 0) {
+		*img = cv::imread(filename, CV_LOAD_IMAGE_COLOR);
+		return img->data != NULL;
+	}
+	cv::Mat img_origin;
+#if CV_MAJOR_VERSION >= 3
+	if (reduced_decode) {
+		std::ifstream file(filename, ios::in | ios::binary);
+		if (!file)
+			return false;
+		std::vector<uchar> buf((std::istreambuf_iterator<char>(file)),
+				std::istreambuf_iterator<char>());
+		// The libjpeg scaled IDCT decodes at 1/2, 1/4 or 1/8 of the size:
+		// take the smallest that still covers the target.
+		int flags = cv::IMREAD_COLOR;
+		int rows, cols;
+		if (JpegSize(buf, &rows, &cols)) {
+			const int factors[3] = {8, 4, 2};
+			const int reduced_flags[3] = {cv::IMREAD_REDUCED_COLOR_8,
+					cv::IMREAD_REDUCED_COLOR_4, cv::IMREAD_REDUCED_COLOR_2};
+			for (int i = 0; i < 3; i++) {
+				if ((rows + factors[i] - 1) / factors[i] >= height &&
+						(cols + factors[i] - 1) / factors[i] >= width) {
+					flags = reduced_flags[i];
+					break;
+				}
+			}
+		}
+		img_origin = cv::imdecode(buf, flags);
 	} else {
-		start_pos[0] = 1;
-		end_pos[0] = frm_num/3;
-		start_pos[1] = end_pos[0] + 1;
-		end_pos[1] = frm_num*2/3;
-		start_pos[2] = end_pos[1] + 1;
-		end_pos[2] = frm_num;
+		img_origin = cv::imread(filename, CV_LOAD_IMAGE_COLOR);
 	}
-	start_pos[3] = 1;
-	end_pos[3] = frm_num;
-
-	std::vector<int> frm_idx(length, 0);
-	int seg_len = end_pos[seg_id] - start_pos[seg_id] + 1;
-	if (seg_len <= length) {
-		for (int i = 0; i < seg_len; i++)
-			frm_idx[i] = start_pos[seg_id] + i;
-		for (int i = seg_len; i < length; i++)
-			frm_idx[i] = end_pos[seg_id];
+#else
+	img_origin = cv::imread(filename, CV_LOAD_IMAGE_COLOR);
+#endif
+	if (!img_origin.data)
+		return false;
+	cv::resize(img_origin, *img, cv::Size(width, height));
+	return true;
+}
+
+void PlanImageSequenceSegments(const int frm_num, const int length,
+		const int num_segments, const bool temporal_jitter,
+		std::vector<std::vector<int> >* segment_frames){
+	CHECK_GE(num_segments, 1);
+	// Segments [0, parts) split the video, segment parts is all of it.
+	const int parts = num_segments - 1;
+	std::vector<int> start_pos(num_segments);
+	std::vector<int> end_pos(num_segments);
+	if (frm_num <= length) {
+		for (int k = 0; k < parts; k++) {
+			start_pos[k] = 1;
+			end_pos[k] = frm_num;
+		}
+	} else if (frm_num < length*parts) {
+		// Too short for disjoint parts: overlapping clip-long ones.
+		const int offset = length - (length*parts-frm_num)/(parts-1);
+		for (int k = 0; k < parts; k++) {
+			start_pos[k] = 1 + k*offset;
+			end_pos[k] = start_pos[k] + length - 1;
+		}
+		end_pos[parts-1] = frm_num;
 	} else {
-		float jit = 0.0;
-		float rate = frm_num;
-		rate = rate/length;
-		frm_idx[0] = 1;
-		frm_idx[length-1] = frm_num;
-		for (int i= 1; i < length - 1; i++) {
-			if (temporal_jitter)
-				caffe_rng_uniform(1, float(-1.0), float(1.0), &jit);
-			frm_idx[i] = int(round(rate*i + rate/2*jit));
-			if (frm_idx[i] == 0) frm_idx[i] = 1;
+		for (int k = 0; k < parts; k++) {
+			start_pos[k] = k ? end_pos[k-1] + 1 : 1;
+			end_pos[k] = frm_num*(k+1)/parts;
 		}
 	}
+	start_pos[parts] = 1;
+	end_pos[parts] = frm_num;
+
+	segment_frames->resize(num_segments);
+	for (int seg_id = 0; seg_id < num_segments; seg_id++) {
+		std::vector<int>& frm_idx = (*segment_frames)[seg_id];
+		frm_idx.assign(length, 0);
+		int seg_len = end_pos[seg_id] - start_pos[seg_id] + 1;
+		if (seg_len <= length) {
+			for (int i = 0; i < seg_len; i++)
+				frm_idx[i] = start_pos[seg_id] + i;
+			for (int i = seg_len; i < length; i++)
+				frm_idx[i] = end_pos[seg_id];
+		} else {
+			float jit = 0.0;
+			float rate = frm_num;
+			rate = rate/length;
+			frm_idx[0] = 1;
+			frm_idx[length-1] = frm_num;
+			for (int i= 1; i < length - 1; i++) {
+				if (temporal_jitter)
+					caffe_rng_uniform(1, float(-1.0), float(1.0), &jit);
+				frm_idx[i] = int(round(rate*i + rate/2*jit));
+				if (frm_idx[i] == 0) frm_idx[i] = 1;
+			}
+		}
+	}
+}
+
+bool ReadImageFramesToVolumeDatum(const char* img_dir,
+		const std::vector<int>& frm_idx, const int label, const int height,
+		const int width, VolumeDatum* datum, const bool reduced_decode){
+	char fn_im[256];
+	cv::Mat img;
+	char *buffer;
+	int offset, channel_size, image_size, data_size;
+	const int length = frm_idx.size();
 
 	offset = 0;
 	for (int i = 0; i < length; i++) {
 		sprintf(fn_im, "%s/%06d.jpg", img_dir, frm_idx[i]);
-		if (height > 0 && width > 0) {
-			img_origin = cv::imread(fn_im, CV_LOAD_IMAGE_COLOR);
-			if (!img_origin.data) {
-				LOG(ERROR) << "Could not open or find file " << fn_im;
-				return false;
-			}
-			cv::resize(img_origin, img, cv::Size(width, height));
-			img_origin.release();
-		} else {
-			img = cv::imread(fn_im, CV_LOAD_IMAGE_COLOR);
-		}
-
-		if (!img.data){
+		if (!ReadImageFrame(fn_im, height, width, reduced_decode, &img)){
 			LOG(ERROR) << "Could not open or find file " << fn_im;
 			return false;
 		}
@@ -267,6 +340,66 @@ bool ReadImageSequenceToVolumeDatum(const char* img_dir, const int frm_num, cons
  	return true;
 }
 
+bool ReadImageSegmentsToVolumeData(const char* img_dir,
+		const std::vector<std::vector<int> >& segment_frames, const int label,
+		const int height, const int width, std::vector<VolumeDatum>* datums,
+		const bool reduced_decode){
+	// Decode every frame of the union once, into planar buffers.
+	std::vector<int> frames;
+	for (int k = 0; k < segment_frames.size(); k++)
+		frames.insert(frames.end(), segment_frames[k].begin(), segment_frames[k].end());
+	std::sort(frames.begin(), frames.end());
+	frames.erase(std::unique(frames.begin(), frames.end()), frames.end());
+	char fn_im[256];
+	cv::Mat img;
+	int image_size = 0;
+	string planes;
+	for (int i = 0; i < frames.size(); i++) {
+		sprintf(fn_im, "%s/%06d.jpg", img_dir, frames[i]);
+		if (!ReadImageFrame(fn_im, height, width, reduced_decode, &img)) {
+			LOG(ERROR) << "Could not open or find file " << fn_im;
+			return false;
+		}
+		if (i == 0) {
+			image_size = img.rows * img.cols;
+			planes.resize(frames.size() * 3 * image_size);
+		}
+		CHECK_EQ(img.rows * img.cols, image_size) << "Frame size differs in " << fn_im;
+		for (int c = 0; c < 3; c++)
+			ImageChannelToBuffer(&img, &planes[(i * 3 + c) * image_size], c);
+	}
+
+	// Assemble the clips: channel-major, then frame.
+	datums->resize(segment_frames.size());
+	for (int k = 0; k < segment_frames.size(); k++) {
+		const std::vector<int>& frm_idx = segment_frames[k];
+		const int length = frm_idx.size();
+		VolumeDatum* datum = &(*datums)[k];
+		datum->set_channels(3);
+		datum->set_length(length);
+		datum->set_label(label);
+		datum->set_height(img.rows);
+		datum->set_width(img.cols);
+		datum->clear_float_data();
+		string* data = datum->mutable_data();
+		data->resize(3 * length * image_size);
+		for (int l = 0; l < length; l++) {
+			const int i = std::lower_bound(frames.begin(), frames.end(), frm_idx[l]) - frames.begin();
+			for (int c = 0; c < 3; c++)
+				memcpy(&(*data)[(c * length + l) * image_size], &planes[(i * 3 + c) * image_size], image_size);
+		}
+	}
+	return true;
+}
+
+bool ReadImageSequenceToVolumeDatum(const char* img_dir, const int frm_num, const int label,
+		const int length, const int height, const int width, const int seg_id, const bool temporal_jitter, VolumeDatum* datum){
+	std::vector<std::vector<int> > segment_frames;
+	PlanImageSequenceSegments(frm_num, length, 4, temporal_jitter, &segment_frames);
+	return ReadImageFramesToVolumeDatum(img_dir, segment_frames[seg_id], label,
+			height, width, datum);
+}
+
 template <>
 bool load_blob_from_binary<float>(const string fn_blob, Blob<float>* blob){
 	FILE *f;
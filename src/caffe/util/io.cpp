@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <google/protobuf/text_format.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/io/coded_stream.h>
@@ -72,6 +73,17 @@ void WriteProtoToBinaryFile(const Message& proto, const char* filename) {
   CHECK(proto.SerializeToOstream(&output));
 }
 
+void WriteProtoToBinaryFileAndSync(const Message& proto, const char* filename) {
+  int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  CHECK_NE(fd, -1) << "Cannot open " << filename << " for writing.";
+  FileOutputStream* output = new FileOutputStream(fd);
+  CHECK(proto.SerializeToZeroCopyStream(output));
+  CHECK(output->Flush()) << "Failed to write " << filename;
+  delete output;
+  CHECK_EQ(fsync(fd), 0) << "Failed to sync " << filename;
+  close(fd);
+}
+
 bool ReadImageToDatum(const string& filename, const int label,
     const int height, const int width, Datum* datum) {
   cv::Mat cv_img;
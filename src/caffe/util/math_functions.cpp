@@ -4,7 +4,9 @@
 #include <boost/random.hpp>
 #include <cublas_v2.h>
 
+#include <algorithm>
 #include <limits>
+#include <vector>
 
 #include "caffe/common.hpp"
 #include "caffe/util/math_functions.hpp"
@@ -34,6 +36,134 @@ void caffe_cpu_gemm<double>(const CBLAS_TRANSPOSE TransA,
       ldb, beta, C, N);
 }
 
+// Row-major BLAS gemm with explicit leading dimensions.
+static void Gemm(const CBLAS_TRANSPOSE TransA, const CBLAS_TRANSPOSE TransB,
+    const int M, const int N, const int K, const float alpha, const float* A,
+    const int lda, const float* B, const int ldb, const float beta, float* C,
+    const int ldc) {
+  cblas_sgemm(CblasRowMajor, TransA, TransB, M, N, K, alpha, A, lda, B, ldb,
+      beta, C, ldc);
+}
+
+static void Gemm(const CBLAS_TRANSPOSE TransA, const CBLAS_TRANSPOSE TransB,
+    const int M, const int N, const int K, const double alpha, const double* A,
+    const int lda, const double* B, const int ldb, const double beta,
+    double* C, const int ldc) {
+  cblas_dgemm(CblasRowMajor, TransA, TransB, M, N, K, alpha, A, lda, B, ldb,
+      beta, C, ldc);
+}
+
+// Elements per converted panel of a compact gemm operand (1 MB of float),
+// and the fewest K columns per panel that keep the BLAS calls efficient.
+static const int kCompactPanelSize = 262144;
+static const int kMinCompactPanelDepth = 128;
+// A dense operand up to this many elements is cheap to stream once per
+// panel, so the compact one is split along its other dimension instead of K.
+static const int kCompactDenseOperandSize = 262144;
+
+// The compact operand X of a gemm has K along its rows (k_major, e.g. a
+// transposed A) or along its columns, and extent other in the remaining
+// dimension. Converts rows or columns [k0, k0 + depth) of X into panel,
+// which then has leading dimension other if k_major and depth otherwise.
+template <typename Dtype>
+static void UnpackCompactPanel(const uint16_t* X, const HalfFormat format,
+    const bool k_major, const int other, const int K, const int k0,
+    const int depth, Dtype* panel) {
+  if (k_major) {
+    FromHalf(format, depth * other, X + k0 * other, panel);
+  } else {
+    for (int i = 0; i < other; ++i) {
+      FromHalf(format, depth, X + i * K + k0, panel + i * depth);
+    }
+  }
+}
+
+static int CompactPanelRows(const int K) {
+  return std::max(1, kCompactPanelSize / std::max(K, 1));
+}
+
+static int CompactPanelDepth(const int other, const int K) {
+  return std::min(K, std::max(kMinCompactPanelDepth,
+      kCompactPanelSize / std::max(other, 1)));
+}
+
+template <typename Dtype>
+void caffe_cpu_gemm(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const Dtype alpha, const uint16_t* A, const HalfFormat a_format,
+    const Dtype* B, const Dtype beta, Dtype* C) {
+  const bool k_major = (TransA == CblasTrans);
+  if (!k_major && N * K <= kCompactDenseOperandSize) {
+    const int max_rows = CompactPanelRows(K);
+    std::vector<Dtype> panel(max_rows * K);
+    for (int m0 = 0; m0 < M; m0 += max_rows) {
+      const int rows = std::min(max_rows, M - m0);
+      FromHalf(a_format, rows * K, A + m0 * K, &panel[0]);
+      Gemm(TransA, TransB, rows, N, K, alpha, &panel[0], K, B,
+          (TransB == CblasNoTrans) ? N : K, beta, C + m0 * N, N);
+    }
+    return;
+  }
+  const int max_depth = CompactPanelDepth(M, K);
+  std::vector<Dtype> panel(max_depth * M);
+  for (int k0 = 0; k0 < K; k0 += max_depth) {
+    const int depth = std::min(max_depth, K - k0);
+    UnpackCompactPanel(A, a_format, k_major, M, K, k0, depth, &panel[0]);
+    const Dtype* B_panel = (TransB == CblasNoTrans) ? B + k0 * N : B + k0;
+    Gemm(TransA, TransB, M, N, depth, alpha, &panel[0], k_major ? M : depth,
+        B_panel, (TransB == CblasNoTrans) ? N : K, k0 ? Dtype(1) : beta, C, N);
+  }
+}
+
+template void caffe_cpu_gemm<float>(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const float alpha, const uint16_t* A, const HalfFormat a_format,
+    const float* B, const float beta, float* C);
+template void caffe_cpu_gemm<double>(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const double alpha, const uint16_t* A, const HalfFormat a_format,
+    const double* B, const double beta, double* C);
+
+template <typename Dtype>
+void caffe_cpu_gemm(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const Dtype alpha, const Dtype* A, const uint16_t* B,
+    const HalfFormat b_format, const Dtype beta, Dtype* C) {
+  const bool k_major = (TransB == CblasNoTrans);
+  if (!k_major && M * K <= kCompactDenseOperandSize) {
+    // A small A (e.g. an inner product over a small batch) stays in cache,
+    // so convert whole rows of B and keep the full depth in each BLAS call.
+    const int max_rows = CompactPanelRows(K);
+    std::vector<Dtype> panel(max_rows * K);
+    for (int n0 = 0; n0 < N; n0 += max_rows) {
+      const int rows = std::min(max_rows, N - n0);
+      FromHalf(b_format, rows * K, B + n0 * K, &panel[0]);
+      Gemm(TransA, TransB, M, rows, K, alpha, A,
+          (TransA == CblasNoTrans) ? K : M, &panel[0], K, beta, C + n0, N);
+    }
+    return;
+  }
+  const int max_depth = CompactPanelDepth(N, K);
+  std::vector<Dtype> panel(max_depth * N);
+  for (int k0 = 0; k0 < K; k0 += max_depth) {
+    const int depth = std::min(max_depth, K - k0);
+    UnpackCompactPanel(B, b_format, k_major, N, K, k0, depth, &panel[0]);
+    const Dtype* A_panel = (TransA == CblasNoTrans) ? A + k0 : A + k0 * M;
+    Gemm(TransA, TransB, M, N, depth, alpha, A_panel,
+        (TransA == CblasNoTrans) ? K : M, &panel[0], k_major ? N : depth,
+        k0 ? Dtype(1) : beta, C, N);
+  }
+}
+
+template void caffe_cpu_gemm<float>(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const float alpha, const float* A, const uint16_t* B,
+    const HalfFormat b_format, const float beta, float* C);
+template void caffe_cpu_gemm<double>(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const double alpha, const double* A, const uint16_t* B,
+    const HalfFormat b_format, const double beta, double* C);
+
 template <>
 void caffe_gpu_gemm<float>(const CBLAS_TRANSPOSE TransA,
     const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
@@ -0,0 +1,93 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "caffe/util/philox.hpp"
+
+namespace caffe {
+
+#if defined(__SSE2__)
+// Low and high halves of the 32x32-bit products of the four lanes of x and
+// multiplier.
+static inline void MulHiLo(const __m128i x, const __m128i multiplier,
+    __m128i* lo, __m128i* hi) {
+  const __m128i even = _mm_mul_epu32(x, multiplier);
+  const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), multiplier);
+  *lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+      _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+  *hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)),
+      _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+}
+
+// The 16 mask bits of counters 4 * group to 4 * group + 3.
+static inline uint32_t PhiloxGroupBits(const uint32_t key[2],
+    const uint32_t group, const __m128i threshold) {
+  const __m128i m0 = _mm_set1_epi32(0xD2511F53u);
+  const __m128i m1 = _mm_set1_epi32(0xCD9E8D57u);
+  __m128i x0 = _mm_add_epi32(_mm_set1_epi32(4 * group),
+      _mm_set_epi32(3, 2, 1, 0));
+  __m128i x1 = _mm_setzero_si128();
+  __m128i x2 = _mm_setzero_si128();
+  __m128i x3 = _mm_setzero_si128();
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < 10; ++round) {
+    __m128i lo0, hi0, lo1, hi1;
+    MulHiLo(x0, m0, &lo0, &hi0);
+    MulHiLo(x2, m1, &lo1, &hi1);
+    x0 = _mm_xor_si128(_mm_xor_si128(hi1, x1), _mm_set1_epi32(k0));
+    x1 = lo1;
+    x2 = _mm_xor_si128(_mm_xor_si128(hi0, x3), _mm_set1_epi32(k1));
+    x3 = lo0;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  // Unsigned greater-than through the signed compare.
+  const __m128i sign = _mm_set1_epi32(0x80000000u);
+  const __m128i words[4] = {x0, x1, x2, x3};
+  uint32_t bits = 0;
+  for (int j = 0; j < 4; ++j) {
+    const __m128i keep =
+        _mm_cmpgt_epi32(_mm_xor_si128(words[j], sign), threshold);
+    bits |= static_cast<uint32_t>(
+        _mm_movemask_ps(_mm_castsi128_ps(keep))) << (4 * j);
+  }
+  return bits;
+}
+#else
+static inline uint32_t PhiloxGroupBits(const uint32_t key[2],
+    const uint32_t group, const uint32_t threshold) {
+  uint32_t bits = 0;
+  for (uint32_t lane = 0; lane < 4; ++lane) {
+    const uint32_t counter[4] = {4 * group + lane, 0, 0, 0};
+    uint32_t words[4];
+    Philox4x32(counter, key, words);
+    for (int j = 0; j < 4; ++j) {
+      bits |= static_cast<uint32_t>(words[j] > threshold) << (4 * j + lane);
+    }
+  }
+  return bits;
+}
+#endif
+
+void PhiloxBernoulliBits(const uint32_t key[2], const int n,
+    const uint32_t threshold, uint32_t* bits) {
+#if defined(__SSE2__)
+  const __m128i group_threshold = _mm_set1_epi32(threshold ^ 0x80000000u);
+#else
+  const uint32_t group_threshold = threshold;
+#endif
+  const int num_words = BitMaskWords(n);
+  for (int i = 0; i < num_words; ++i) {
+    bits[i] = PhiloxGroupBits(key, 2 * i, group_threshold) |
+        (PhiloxGroupBits(key, 2 * i + 1, group_threshold) << 16);
+  }
+  if (n % 32) {
+    bits[num_words - 1] &= (1u << (n % 32)) - 1;
+  }
+}
+
+}  // namespace caffe
@@ -17,6 +17,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 #include "caffe/util/vol2col.hpp"
 
@@ -63,6 +64,38 @@ template void vol2col_cpu<double>(const double* data_im, const int channels,cons
 	    const int height, const int width, const int ksize, const int kdepth, const int pad,
 	    const int temporal_pad, const int stride, const int temporal_stride, double* data_col);
 
+template <typename Dtype>
+void vol2col_cpu(const uint16_t* data_im, const HalfFormat format,
+    const int channels, const int length, const int height, const int width,
+    const int ksize, const int kdepth, const int pad, const int temporal_pad,
+    const int stride, const int temporal_stride, Dtype* data_col) {
+  const int length_col = (length + 2 * temporal_pad - kdepth) / temporal_stride
+      + 1;
+  const int height_col = (height + 2 * pad - ksize) / stride + 1;
+  const int width_col = (width + 2 * pad - ksize) / stride + 1;
+  // The columns of one image channel are a contiguous block of the buffer.
+  const int channel_size = length * height * width;
+  const int channel_col_size = kdepth * ksize * ksize * length_col * height_col
+      * width_col;
+  std::vector<Dtype> channel(channel_size);
+  for (int c = 0; c < channels; ++c) {
+    FromHalf(format, channel_size, data_im + c * channel_size, &channel[0]);
+    vol2col_cpu(&channel[0], 1, length, height, width, ksize, kdepth, pad,
+        temporal_pad, stride, temporal_stride, data_col + c * channel_col_size);
+  }
+}
+
+template void vol2col_cpu<float>(const uint16_t* data_im,
+    const HalfFormat format, const int channels, const int length,
+    const int height, const int width, const int ksize, const int kdepth,
+    const int pad, const int temporal_pad, const int stride,
+    const int temporal_stride, float* data_col);
+template void vol2col_cpu<double>(const uint16_t* data_im,
+    const HalfFormat format, const int channels, const int length,
+    const int height, const int width, const int ksize, const int kdepth,
+    const int pad, const int temporal_pad, const int stride,
+    const int temporal_stride, double* data_col);
+
 template <typename Dtype>
 void col2vol_cpu(const Dtype* data_col, const int channels, const int length,
     const int height, const int width, const int ksize, const int kdepth, const int pad,
@@ -0,0 +1,121 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <glog/logging.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <string>
+
+#include "caffe/util/volume_mean.hpp"
+
+namespace caffe {
+
+// A uint32 partial sum can absorb this many uint8 values without overflow.
+static const uint32_t kMaxPendingBytes = 0xFFFFFFFFu / 255u;
+
+void VolumeMeanAccumulator::Init(const int channels, const int length,
+    const int height, const int width) {
+  channels_ = channels;
+  length_ = length;
+  height_ = height;
+  width_ = width;
+  size_ = channels * length * height * width;
+  count_ = 0;
+  pending_ = 0;
+  partial_.assign(size_, 0);
+  sum_.assign(size_, 0.);
+}
+
+void VolumeMeanAccumulator::Add(const VolumeDatum& datum) {
+  const std::string& data = datum.data();
+  if (data.size() != 0) {
+    AddBytes(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+  } else {
+    AddFloats(datum.float_data().data(), datum.float_data_size());
+  }
+}
+
+void VolumeMeanAccumulator::Add(const DatumView& datum) {
+  if (datum.data_size() != 0) {
+    AddBytes(datum.data(), datum.data_size());
+  } else {
+    AddFloats(datum.float_data(), datum.float_data_size());
+  }
+}
+
+void VolumeMeanAccumulator::AddBytes(const uint8_t* data, const int size) {
+  CHECK_EQ(size, size_) << "Incorrect data field size " << size;
+  if (pending_ == kMaxPendingBytes) {
+    Flush();
+  }
+  uint32_t* acc = &partial_[0];
+  int i = 0;
+#if defined(__SSE2__)
+  // Widen 16 bytes at a time to 4 x 4 uint32 lanes and add them in place.
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= size; i += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+    const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+    __m128i* out = reinterpret_cast<__m128i*>(acc + i);
+    _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out),
+        _mm_unpacklo_epi16(lo, zero)));
+    _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1),
+        _mm_unpackhi_epi16(lo, zero)));
+    _mm_storeu_si128(out + 2, _mm_add_epi32(_mm_loadu_si128(out + 2),
+        _mm_unpacklo_epi16(hi, zero)));
+    _mm_storeu_si128(out + 3, _mm_add_epi32(_mm_loadu_si128(out + 3),
+        _mm_unpackhi_epi16(hi, zero)));
+  }
+#endif
+  for (; i < size; ++i) {
+    acc[i] += data[i];
+  }
+  ++pending_;
+  ++count_;
+}
+
+void VolumeMeanAccumulator::AddFloats(const float* data, const int size) {
+  CHECK_EQ(size, size_) << "Incorrect data field size " << size;
+  for (int i = 0; i < size; ++i) {
+    sum_[i] += data[i];
+  }
+  ++count_;
+}
+
+void VolumeMeanAccumulator::Merge(const VolumeMeanAccumulator& other) {
+  CHECK_EQ(size_, other.size_) << "Cannot merge volumes of different size.";
+  for (int i = 0; i < size_; ++i) {
+    sum_[i] += other.sum_[i] + other.partial_[i];
+  }
+  count_ += other.count_;
+}
+
+void VolumeMeanAccumulator::Flush() {
+  for (int i = 0; i < size_; ++i) {
+    sum_[i] += partial_[i];
+  }
+  std::fill(partial_.begin(), partial_.end(), 0);
+  pending_ = 0;
+}
+
+void VolumeMeanAccumulator::ToProto(BlobProto* proto) const {
+  CHECK_GT(count_, 0) << "No data has been accumulated.";
+  proto->Clear();
+  proto->set_num(1);
+  proto->set_channels(channels_);
+  proto->set_length(length_);
+  proto->set_height(height_);
+  proto->set_width(width_);
+  proto->mutable_data()->Reserve(size_);
+  for (int i = 0; i < size_; ++i) {
+    proto->add_data((sum_[i] + partial_[i]) / count_);
+  }
+}
+
+}  // namespace caffe
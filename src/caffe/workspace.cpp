@@ -0,0 +1,53 @@
+// Copyright 2014 BVLC and contributors.
+
+#include <cuda_runtime.h>
+
+#include <algorithm>
+
+#include "caffe/common.hpp"
+#include "caffe/syncedmem.hpp"
+#include "caffe/workspace.hpp"
+
+using std::max;
+
+namespace caffe {
+
+Workspace::~Workspace() {
+  if (cpu_ptr_) {
+    CaffeFreeHost(cpu_ptr_, cpu_size_);
+  }
+  if (gpu_ptr_) {
+    CUDA_CHECK(cudaFree(gpu_ptr_));
+  }
+}
+
+void Workspace::Reserve(size_t size) {
+  size_ = max(size_, size);
+}
+
+void* Workspace::mutable_cpu_data(size_t size) {
+  Reserve(size);
+  if (cpu_size_ < size_) {
+    if (cpu_ptr_) {
+      CaffeFreeHost(cpu_ptr_, cpu_size_);
+    }
+    bool zeroed;
+    CaffeMallocHost(&cpu_ptr_, size_, &zeroed);
+    cpu_size_ = size_;
+  }
+  return cpu_ptr_;
+}
+
+void* Workspace::mutable_gpu_data(size_t size) {
+  Reserve(size);
+  if (gpu_size_ < size_) {
+    if (gpu_ptr_) {
+      CUDA_CHECK(cudaFree(gpu_ptr_));
+    }
+    CUDA_CHECK(cudaMalloc(&gpu_ptr_, size_));
+    gpu_size_ = size_;
+  }
+  return gpu_ptr_;
+}
+
+}  // namespace caffe
@@ -19,24 +19,155 @@
 
 #include <glog/logging.h>
 #include <leveldb/db.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/datum_view.hpp"
 #include "caffe/util/io.hpp"
+#include "caffe/util/volume_mean.hpp"
 
-using caffe::VolumeDatum;
 using caffe::BlobProto;
+using caffe::DatumView;
+using caffe::VolumeMeanAccumulator;
 using std::max;
+using std::string;
+using std::vector;
+
+// One contiguous key range [begin, end) of the database, summed by its own
+// thread. An empty begin means the first key, an empty end means past the
+// last key.
+struct MeanShard {
+  leveldb::DB* db;
+  const leveldb::Snapshot* snapshot;
+  int id;
+  string begin;
+  string end;
+  VolumeMeanAccumulator accumulator;
+};
+
+// Reads up to 8 bytes of key starting at pos as a big-endian integer.
+static uint64_t KeyPrefixValue(const string& key, const size_t pos) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    value <<= 8;
+    if (pos + i < key.size()) {
+      value |= static_cast<unsigned char>(key[pos + i]);
+    }
+  }
+  return value;
+}
+
+// Length of the run of decimal digits in key starting at pos.
+static size_t DigitRunLength(const string& key, const size_t pos) {
+  size_t len = 0;
+  while (pos + len < key.size() && key[pos + len] >= '0' &&
+      key[pos + len] <= '9') {
+    ++len;
+  }
+  return len;
+}
+
+// Splits the key space between first and last into at most num_shards
+// ranges by interpolating on the part that follows their common prefix:
+// numerically when it starts with a decimal index (the zero-padded keys
+// written by the convert tools), bytewise otherwise. The split keys are
+// strictly increasing, so the ranges partition the database whatever its
+// key distribution; they are only balanced when the keys are roughly
+// uniform.
+static void ComputeKeySplits(const string& first, const string& last,
+    const int num_shards, vector<string>* splits) {
+  splits->clear();
+  size_t prefix = 0;
+  while (prefix < first.size() && prefix < last.size() &&
+      first[prefix] == last[prefix]) {
+    ++prefix;
+  }
+  const size_t digits = std::min(DigitRunLength(first, prefix),
+      DigitRunLength(last, prefix));
+  const bool decimal = digits > 0 && digits <= 18;
+  uint64_t lo, hi;
+  if (decimal) {
+    lo = strtoull(first.substr(prefix, digits).c_str(), NULL, 10);
+    hi = strtoull(last.substr(prefix, digits).c_str(), NULL, 10);
+  } else {
+    lo = KeyPrefixValue(first, prefix);
+    hi = KeyPrefixValue(last, prefix);
+  }
+  if (hi <= lo || (hi - lo) / num_shards == 0) {
+    return;
+  }
+  const uint64_t step = (hi - lo) / num_shards;
+  for (int i = 1; i < num_shards; ++i) {
+    const uint64_t value = lo + step * i;
+    string split = first.substr(0, prefix);
+    if (decimal) {
+      char buffer[32];
+      snprintf(buffer, sizeof(buffer), "%0*llu", static_cast<int>(digits),
+          static_cast<unsigned long long>(value));  // NOLINT(runtime/int)
+      split += buffer;
+    } else {
+      for (int b = 7; b >= 0; --b) {
+        split.push_back(static_cast<char>((value >> (8 * b)) & 0xFF));
+      }
+      // Trailing zero bytes only make the key longer, not larger.
+      while (split.size() > prefix + 1 && split[split.size() - 1] == 0) {
+        split.erase(split.size() - 1);
+      }
+    }
+    if (splits->empty() || split > splits->back()) {
+      splits->push_back(split);
+    }
+  }
+}
+
+static void* ComputeShardMean(void* shard_pointer) {
+  MeanShard* shard = reinterpret_cast<MeanShard*>(shard_pointer);
+  leveldb::ReadOptions read_options;
+  read_options.fill_cache = false;
+  read_options.snapshot = shard->snapshot;
+  leveldb::Iterator* it = shard->db->NewIterator(read_options);
+  if (shard->begin.empty()) {
+    it->SeekToFirst();
+  } else {
+    it->Seek(shard->begin);
+  }
+  const leveldb::Slice end(shard->end);
+  DatumView datum;
+  for (; it->Valid(); it->Next()) {
+    if (!shard->end.empty() && it->key().compare(end) >= 0) {
+      break;
+    }
+    CHECK(datum.ParseVolumeDatum(it->value().data(), it->value().size()))
+        << "Failed to parse the datum at " << it->key().ToString();
+    shard->accumulator.Add(datum);
+    if (shard->accumulator.count() % 10000 == 0) {
+      LOG(ERROR) << "Shard " << shard->id << " processed "
+          << shard->accumulator.count() << " files.";
+    }
+  }
+  CHECK(it->status().ok()) << it->status().ToString();
+  delete it;
+  return NULL;
+}
 
 int main(int argc, char** argv) {
   ::google::InitGoogleLogging(argv[0]);
-  if (argc != 3) {
-    LOG(ERROR) << "Usage: compute_image_mean input_leveldb output_file";
+  if (argc != 3 && argc != 4) {
+    LOG(ERROR) << "Usage: compute_volume_mean input_leveldb output_file"
+        << " [num_threads]";
     return 1;
   }
+  int num_threads = (argc == 4) ? atoi(argv[3])
+      : static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+  num_threads = max(num_threads, 1);
 
   leveldb::DB* db;
   leveldb::Options options;
@@ -47,54 +178,52 @@ int main(int argc, char** argv) {
       options, argv[1], &db);
   CHECK(status.ok()) << "Failed to open leveldb " << argv[1];
 
+  // Take the volume shape from the first datum and the key span from the
+  // first and last keys.
+  const leveldb::Snapshot* snapshot = db->GetSnapshot();
   leveldb::ReadOptions read_options;
   read_options.fill_cache = false;
+  read_options.snapshot = snapshot;
   leveldb::Iterator* it = db->NewIterator(read_options);
   it->SeekToFirst();
-  VolumeDatum datum;
-  BlobProto sum_blob;
-  int count = 0;
-  datum.ParseFromString(it->value().ToString());
-  sum_blob.set_num(1);
-  sum_blob.set_channels(datum.channels());
-  sum_blob.set_length(datum.length());
-  sum_blob.set_height(datum.height());
-  sum_blob.set_width(datum.width());
-  const int data_size = datum.channels() * datum.length() * datum.height() * datum.width();
-  int size_in_datum = std::max<int>(datum.data().size(),
-                                    datum.float_data_size());
-  for (int i = 0; i < size_in_datum; ++i) {
-    sum_blob.add_data(0.);
+  CHECK(it->Valid()) << "Empty leveldb " << argv[1];
+  DatumView datum;
+  CHECK(datum.ParseVolumeDatum(it->value().data(), it->value().size()))
+      << "Failed to parse the datum at " << it->key().ToString();
+  const string first_key = it->key().ToString();
+  it->SeekToLast();
+  const string last_key = it->key().ToString();
+  delete it;
+
+  vector<string> splits;
+  ComputeKeySplits(first_key, last_key, num_threads, &splits);
+  vector<MeanShard> shards(splits.size() + 1);
+  for (int i = 0; i < shards.size(); ++i) {
+    shards[i].db = db;
+    shards[i].snapshot = snapshot;
+    shards[i].id = i;
+    shards[i].begin = (i == 0) ? string() : splits[i - 1];
+    shards[i].end = (i == splits.size()) ? string() : splits[i];
+    shards[i].accumulator.Init(datum);
   }
-  LOG(INFO) << "Starting Iteration";
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    // just a dummy operation
-    datum.ParseFromString(it->value().ToString());
-    const string& data = datum.data();
-    size_in_datum = std::max<int>(datum.data().size(), datum.float_data_size());
-    CHECK_EQ(size_in_datum, data_size) << "Incorrect data field size " <<
-        size_in_datum;
-    if (data.size() != 0) {
-      for (int i = 0; i < size_in_datum; ++i) {
-        sum_blob.set_data(i, sum_blob.data(i) + (uint8_t)data[i]);
-      }
-    } else {
-      for (int i = 0; i < size_in_datum; ++i) {
-        sum_blob.set_data(i, sum_blob.data(i) +
-            static_cast<float>(datum.float_data(i)));
-      }
-    }
-    ++count;
-    if (count % 10000 == 0) {
-      LOG(ERROR) << "Processed " << count << " files.";
-    }
+  LOG(INFO) << "Starting Iteration with " << shards.size() << " shards";
+  vector<pthread_t> threads(shards.size());
+  for (int i = 0; i < shards.size(); ++i) {
+    CHECK(!pthread_create(&threads[i], NULL, ComputeShardMean,
+        static_cast<void*>(&shards[i]))) << "Pthread execution failed.";
   }
-  if (count % 10000 != 0) {
-    LOG(ERROR) << "Processed " << count << " files.";
+  for (int i = 0; i < shards.size(); ++i) {
+    CHECK(!pthread_join(threads[i], NULL)) << "Pthread joining failed.";
   }
-  for (int i = 0; i < sum_blob.data_size(); ++i) {
-    sum_blob.set_data(i, sum_blob.data(i) / count);
+  VolumeMeanAccumulator& sum = shards[0].accumulator;
+  for (int i = 1; i < shards.size(); ++i) {
+    sum.Merge(shards[i].accumulator);
   }
+  LOG(ERROR) << "Processed " << sum.count() << " files.";
+  db->ReleaseSnapshot(snapshot);
+
+  BlobProto sum_blob;
+  sum.ToProto(&sum_blob);
   // Write to disk
   LOG(INFO) << "Write to " << argv[2];
   WriteProtoToBinaryFile(sum_blob, argv[2]);
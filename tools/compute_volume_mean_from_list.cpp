@@ -18,25 +18,69 @@
 
 
 #include <glog/logging.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/image_io.hpp"
 #include "caffe/util/io.hpp"
+#include "caffe/util/volume_mean.hpp"
 
 using caffe::VolumeDatum;
 using caffe::BlobProto;
+using caffe::VolumeMeanAccumulator;
 using std::max;
+using std::vector;
+
+struct ClipEntry {
+  string frm_dir;
+  int frm_num;
+  int label;
+};
+
+// A contiguous slice of the clip list, decoded and summed by one thread.
+struct DecodeWorker {
+  const vector<ClipEntry>* clips;
+  int begin;
+  int end;
+  int length;
+  int height;
+  int width;
+  int seg_id;
+  VolumeMeanAccumulator accumulator;
+};
+
+static void* DecodeAndSum(void* worker_pointer) {
+  DecodeWorker* worker = reinterpret_cast<DecodeWorker*>(worker_pointer);
+  VolumeDatum datum;
+  for (int i = worker->begin; i < worker->end; ++i) {
+    const ClipEntry& clip = (*worker->clips)[i];
+    if (!ReadImageSequenceToVolumeDatum(clip.frm_dir.c_str(), clip.frm_num,
+        clip.label, worker->length, worker->height, worker->width,
+        worker->seg_id, false, &datum)) {
+      LOG(WARNING) << "Skipping " << clip.frm_dir;
+      continue;
+    }
+    worker->accumulator.Add(datum);
+    if (worker->accumulator.count() % 10000 == 0) {
+      LOG(ERROR) << "Worker at clip " << i << " processed "
+          << worker->accumulator.count() << " files.";
+    }
+  }
+  return NULL;
+}
 
 int main(int argc, char** argv) {
   ::google::InitGoogleLogging(argv[0]);
   if (argc < 7) {
-    LOG(ERROR) << "Usage: compute_volume_mean_from_list input_chunk_list length height width seg_id output_file [dropping rate]";
+    LOG(ERROR) << "Usage: compute_volume_mean_from_list input_chunk_list length height width seg_id output_file [dropping rate] [num_threads]";
     return 1;
   }
 
@@ -52,69 +96,63 @@ int main(int argc, char** argv) {
 	  dropping_rate = atoi(argv[7]);
 	  LOG(INFO) << "using dropping rate " << dropping_rate;
   }
+  int num_threads = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+  if (argc >= 9) {
+    num_threads = atoi(argv[8]);
+  }
+  num_threads = max(num_threads, 1);
 
   VolumeDatum datum;
-  BlobProto sum_blob;
-  int count = 0;
 
   std::ifstream infile(fn_list);
   string frm_dir;
   int label, frm_num;
   infile >> frm_dir >> frm_num >> label;
 
+  // The first clip only defines the volume shape.
   ReadImageSequenceToVolumeDatum(frm_dir.c_str(), frm_num, label,
   	                             length, height, width, seg_id, false, &datum);
 
-  sum_blob.set_num(1);
-  sum_blob.set_channels(datum.channels());
-  sum_blob.set_length(datum.length());
-  sum_blob.set_height(datum.height());
-  sum_blob.set_width(datum.width());
-  const int data_size = datum.channels() * datum.length() * datum.height() * datum.width();
-  int size_in_datum = datum.data().size();
-  for (int i = 0; i < size_in_datum; ++i) {
-    sum_blob.add_data(0.);
-  }
-
-
-  LOG(INFO) << "Starting Iteration";
+  vector<ClipEntry> clips;
+  ClipEntry clip;
   int c = 0;
-  while (infile >> frm_dir >> frm_num >> label) {
+  while (infile >> clip.frm_dir >> clip.frm_num >> clip.label) {
 	  c++;
 	  if (c % dropping_rate!=0){
 		  continue;
 	  }
-
-	  ReadImageSequenceToVolumeDatum(frm_dir.c_str(), frm_num, label,
-	    	                             length, height, width, seg_id, false, &datum);
-	    const string& data = datum.data();
-	    size_in_datum = datum.data().size();
-	    CHECK_EQ(size_in_datum, data_size) << "Incorrect data field size " <<
-	        size_in_datum;
-	    if (data.size() != 0) {
-	      for (int i = 0; i < size_in_datum; ++i) {
-	        sum_blob.set_data(i, sum_blob.data(i) + (uint8_t)data[i]);
-	      }
-	    } else {
-	      for (int i = 0; i < size_in_datum; ++i) {
-	        sum_blob.set_data(i, sum_blob.data(i) +
-	            static_cast<float>(datum.float_data(i)));
-	      }
-	    }
-	    ++count;
-	    if (count % 10000 == 0) {
-	      LOG(ERROR) << "Processed " << count << " files.";
-	    }
+	  clips.push_back(clip);
   }
   infile.close();
 
-  if (count % 10000 != 0) {
-    LOG(ERROR) << "Processed " << count << " files.";
+  num_threads = std::min<int>(num_threads, max<int>(clips.size(), 1));
+  LOG(INFO) << "Starting Iteration over " << clips.size() << " clips with "
+      << num_threads << " decode threads";
+  vector<DecodeWorker> workers(num_threads);
+  vector<pthread_t> threads(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    workers[i].clips = &clips;
+    workers[i].begin = clips.size() * i / num_threads;
+    workers[i].end = clips.size() * (i + 1) / num_threads;
+    workers[i].length = length;
+    workers[i].height = height;
+    workers[i].width = width;
+    workers[i].seg_id = seg_id;
+    workers[i].accumulator.Init(datum);
+    CHECK(!pthread_create(&threads[i], NULL, DecodeAndSum,
+        static_cast<void*>(&workers[i]))) << "Pthread execution failed.";
   }
-
-  for (int i = 0; i < sum_blob.data_size(); ++i) {
-    sum_blob.set_data(i, sum_blob.data(i) / count);
+  for (int i = 0; i < num_threads; ++i) {
+    CHECK(!pthread_join(threads[i], NULL)) << "Pthread joining failed.";
   }
+  VolumeMeanAccumulator& sum = workers[0].accumulator;
+  for (int i = 1; i < num_threads; ++i) {
+    sum.Merge(workers[i].accumulator);
+  }
+  LOG(ERROR) << "Processed " << sum.count() << " files.";
+
+  BlobProto sum_blob;
+  sum.ToProto(&sum_blob);
   // Write to disk
   LOG(INFO) << "Write to " << fn_output;
   WriteProtoToBinaryFile(sum_blob, fn_output);
@@ -0,0 +1,131 @@
+// Copyright 2014 BVLC and contributors.
+// This program converts a list of frame folders to an lmdb by storing a clip
+// of each as a VolumeDatum proto buffer, for a VolumeDataLayer with
+// backend: LMDB.
+// Usage:
+//    convert_volumes_to_lmdb LISTFILE length height width seg_id DB_NAME [0/1]
+// where LISTFILE holds a frame folder, its number of frames and its label per
+// line, as
+//   video1/ 120 7
+//   ....
+// if the last argument is 1, a random shuffle will be carried out before we
+// process the file lines.
+
+#include <glog/logging.h>
+#include <lmdb.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/image_io.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+using std::string;
+
+struct ClipEntry {
+  string frm_dir;
+  int frm_num;
+  int label;
+};
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  if (argc < 7 || argc > 8) {
+    printf("Convert a list of frame folders to the lmdb format used\n"
+        "as input for Caffe.\n"
+        "Usage:\n"
+        "    convert_volumes_to_lmdb LISTFILE length height width seg_id"
+        " DB_NAME RANDOM_SHUFFLE_DATA[0 or 1]\n");
+    return 1;
+  }
+  const int length = atoi(argv[2]);
+  const int height = atoi(argv[3]);
+  const int width = atoi(argv[4]);
+  const int seg_id = atoi(argv[5]);
+  const char* db_name = argv[6];
+
+  std::ifstream infile(argv[1]);
+  std::vector<ClipEntry> clips;
+  ClipEntry clip;
+  while (infile >> clip.frm_dir >> clip.frm_num >> clip.label) {
+    clips.push_back(clip);
+  }
+  if (argc == 8 && argv[7][0] == '1') {
+    // randomly shuffle data
+    LOG(INFO) << "Shuffling data";
+    std::random_shuffle(clips.begin(), clips.end());
+  }
+  LOG(INFO) << "A total of " << clips.size() << " clips.";
+
+  MDB_env* env;
+  MDB_dbi dbi;
+  MDB_txn* txn;
+  LOG(INFO) << "Opening lmdb " << db_name;
+  CHECK_EQ(mkdir(db_name, 0744), 0) << "mkdir " << db_name << " failed";
+  CHECK_EQ(mdb_env_create(&env), MDB_SUCCESS) << "mdb_env_create failed";
+  // The map only reserves address space; the file grows as clips are added.
+  CHECK_EQ(mdb_env_set_mapsize(env, 1099511627776), MDB_SUCCESS)  // 1TB
+      << "mdb_env_set_mapsize failed";
+  CHECK_EQ(mdb_env_open(env, db_name, 0, 0664), MDB_SUCCESS)
+      << "mdb_env_open failed";
+  CHECK_EQ(mdb_txn_begin(env, NULL, 0, &txn), MDB_SUCCESS)
+      << "mdb_txn_begin failed";
+  CHECK_EQ(mdb_dbi_open(txn, NULL, 0, &dbi), MDB_SUCCESS)
+      << "mdb_dbi_open failed";
+
+  VolumeDatum datum;
+  int count = 0;
+  const int kMaxKeyLength = 256;
+  char key_cstr[kMaxKeyLength];
+  int data_size;
+  bool data_size_initialized = false;
+  for (int line_id = 0; line_id < clips.size(); ++line_id) {
+    if (!ReadImageSequenceToVolumeDatum(clips[line_id].frm_dir.c_str(),
+        clips[line_id].frm_num, clips[line_id].label, length, height, width,
+        seg_id, false, &datum)) {
+      LOG(WARNING) << "Skipping " << clips[line_id].frm_dir;
+      continue;
+    }
+    if (!data_size_initialized) {
+      data_size = datum.channels() * datum.length() * datum.height() *
+          datum.width();
+      data_size_initialized = true;
+    } else {
+      const string& data = datum.data();
+      CHECK_EQ(data.size(), data_size) << "Incorrect data field size "
+          << data.size();
+    }
+    // sequential, so that the keys are appended in order
+    const int key_length = snprintf(key_cstr, kMaxKeyLength, "%08d_%s",
+        line_id, clips[line_id].frm_dir.c_str());
+    string value;
+    // get the value
+    datum.SerializeToString(&value);
+    MDB_val mdb_key, mdb_data;
+    mdb_key.mv_size = std::min(key_length, kMaxKeyLength - 1);
+    mdb_key.mv_data = reinterpret_cast<void*>(key_cstr);
+    mdb_data.mv_size = value.size();
+    mdb_data.mv_data = reinterpret_cast<void*>(&value[0]);
+    CHECK_EQ(mdb_put(txn, dbi, &mdb_key, &mdb_data, MDB_APPEND), MDB_SUCCESS)
+        << "mdb_put failed";
+    if (++count % 1000 == 0) {
+      CHECK_EQ(mdb_txn_commit(txn), MDB_SUCCESS) << "mdb_txn_commit failed";
+      LOG(ERROR) << "Processed " << count << " files.";
+      CHECK_EQ(mdb_txn_begin(env, NULL, 0, &txn), MDB_SUCCESS)
+          << "mdb_txn_begin failed";
+    }
+  }
+  // write the last batch
+  CHECK_EQ(mdb_txn_commit(txn), MDB_SUCCESS) << "mdb_txn_commit failed";
+  if (count % 1000 != 0) {
+    LOG(ERROR) << "Processed " << count << " files.";
+  }
+  mdb_env_close(env);
+  return 0;
+}
@@ -0,0 +1,29 @@
+// Copyright 2014 BVLC and contributors.
+//
+// This is a script to convert a trained binary NetParameter into a flat
+// weight file, which Net::CopyTrainedLayersFrom maps instead of parsing.
+// Usage:
+//    convert_weights_to_flat trained_net_proto_file_in flat_weights_file_out
+
+#include "caffe/caffe.hpp"
+#include "caffe/util/flat_weights.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  if (argc != 3) {
+    LOG(ERROR) << "Usage: "
+        << "convert_weights_to_flat trained_net_proto_file_in "
+        << "flat_weights_file_out";
+    return 1;
+  }
+
+  NetParameter net_param;
+  ReadNetParamsFromBinaryFileOrDie(argv[1], &net_param);
+  WriteFlatWeightsFile(net_param, argv[2]);
+
+  LOG(ERROR) << "Wrote flat weights to " << argv[2];
+  return 0;
+}
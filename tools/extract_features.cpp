@@ -3,8 +3,6 @@
 #include <stdio.h>  // for snprintf
 #include <cuda_runtime.h>
 #include <google/protobuf/text_format.h>
-#include <leveldb/db.h>
-#include <leveldb/write_batch.h>
 #include <string>
 #include <vector>
 
@@ -13,6 +11,7 @@
 #include "caffe/net.hpp"
 #include "caffe/vision_layers.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/feature_db_writer.hpp"
 #include "caffe/util/io.hpp"
 
 using namespace caffe;  // NOLINT(build/namespaces)
@@ -34,7 +33,9 @@ int feature_extraction_pipeline(int argc, char** argv) {
     " extract features of the input data produced by the net.\n"
     "Usage: demo_extract_features  pretrained_net_param"
     "  feature_extraction_proto_file  extract_feature_blob_name"
-    "  save_feature_leveldb_name  num_mini_batches  [CPU/GPU]  [DEVICE_ID=0]";
+    "  save_feature_leveldb_name  num_mini_batches  [CPU/GPU]  [DEVICE_ID=0]"
+    "  [NUM_WRITER_THREADS=2]  [BULK_LOAD=0]\n"
+    "BULK_LOAD=1 commits the features in key order.";
     return 1;
   }
   int arg_pos = num_required_args;
@@ -97,26 +98,23 @@ int feature_extraction_pipeline(int argc, char** argv) {
       << " in the network " << feature_extraction_proto;
 
   string save_feature_leveldb_name(argv[++arg_pos]);
-  leveldb::DB* db;
-  leveldb::Options options;
-  options.error_if_exists = true;
-  options.create_if_missing = true;
-  options.write_buffer_size = 268435456;
-  LOG(INFO)<< "Opening leveldb " << save_feature_leveldb_name;
-  leveldb::Status status = leveldb::DB::Open(options,
-                                             save_feature_leveldb_name.c_str(),
-                                             &db);
-  CHECK(status.ok()) << "Failed to open leveldb " << save_feature_leveldb_name;
-
   int num_mini_batches = atoi(argv[++arg_pos]);
 
+  // Serialization and database writes run on their own threads; the loop
+  // below only copies each batch of features into the writer's queue.
+  int num_writer_threads = 2;
+  if (argc > num_required_args + 2) {
+    num_writer_threads = atoi(argv[num_required_args + 2]);
+  }
+  bool bulk_load = false;
+  if (argc > num_required_args + 3) {
+    bulk_load = atoi(argv[num_required_args + 3]) != 0;
+  }
+  FeatureDBWriter writer(save_feature_leveldb_name, num_writer_threads, 8,
+      bulk_load);
+
   LOG(ERROR)<< "Extacting Features";
 
-  Datum datum;
-  leveldb::WriteBatch* batch = new leveldb::WriteBatch();
-  const int kMaxKeyStrLength = 100;
-  char key_str[kMaxKeyStrLength];
-  int num_bytes_of_binary_code = sizeof(Dtype);
   vector<Blob<float>*> input_vec;
   int image_index = 0;
   for (int batch_index = 0; batch_index < num_mini_batches; ++batch_index) {
@@ -125,41 +123,16 @@ int feature_extraction_pipeline(int argc, char** argv) {
         ->blob_by_name(extract_feature_blob_name);
     int num_features = feature_blob->num();
     int dim_features = feature_blob->count() / num_features;
-    Dtype* feature_blob_data;
-    for (int n = 0; n < num_features; ++n) {
-      datum.set_height(dim_features);
-      datum.set_width(1);
-      datum.set_channels(1);
-      datum.clear_data();
-      datum.clear_float_data();
-      feature_blob_data = feature_blob->mutable_cpu_data() +
-          feature_blob->offset(n);
-      for (int d = 0; d < dim_features; ++d) {
-        datum.add_float_data(feature_blob_data[d]);
-      }
-      string value;
-      datum.SerializeToString(&value);
-      snprintf(key_str, kMaxKeyStrLength, "%016d", image_index);
-      batch->Put(string(key_str), value);
-      ++image_index;
-      if (image_index % 1000 == 0) {
-        db->Write(leveldb::WriteOptions(), batch);
-        LOG(ERROR)<< "Extracted features of " << image_index <<
-            " query images.";
-        delete batch;
-        batch = new leveldb::WriteBatch();
-      }
-    }  // for (int n = 0; n < num_features; ++n)
+    writer.Write(image_index, num_features, dim_features,
+        feature_blob->cpu_data());
+    if ((image_index + num_features) / 1000 > image_index / 1000) {
+      LOG(ERROR)<< "Extracted features of " << image_index + num_features <<
+          " query images.";
+    }
+    image_index += num_features;
   }  // for (int batch_index = 0; batch_index < num_mini_batches; ++batch_index)
-  // write the last batch
-  if (image_index % 1000 != 0) {
-    db->Write(leveldb::WriteOptions(), batch);
-    LOG(ERROR)<< "Extracted features of " << image_index <<
-        " query images.";
-  }
-
-  delete batch;
-  delete db;
+  writer.Close();
+  LOG(ERROR)<< "Wrote features of " << image_index << " query images.";
   LOG(ERROR)<< "Successfully extracted the features!";
   return 0;
 }
@@ -28,6 +28,7 @@
 #include "caffe/vision_layers.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/io.hpp"
+#include "caffe/util/feature_shard.hpp"
 #include "caffe/util/image_io.hpp"
 
 using namespace caffe;  // NOLINT(build/namespaces)
@@ -63,10 +64,36 @@ int feature_extraction_pipeline(int argc, char** argv) {
       new Net<Dtype>(string(net_proto)));
   feature_extraction_net->CopyTrainedLayersFrom(string(pretrained_model));
 
+  // The arguments after the prefix list are the feature blob names and the
+  // options
+  //   --shard_out=PREFIX  write the features into large shard files (see
+  //                       caffe/util/feature_shard.hpp) instead of one file
+  //                       per clip and blob
+  //   --fp16              store the sharded features as float16
+  //   --compress          compress the sharded features with snappy
+  vector<string> blob_names;
+  string shard_prefix;
+  FeatureStorage storage = FEATURE_FLOAT32;
+  bool compress = false;
   for (int i=7; i<argc; i++){
-  CHECK(feature_extraction_net->has_blob(string(argv[i])))
-      << "Unknown feature blob name " << string(argv[i])
+  const string arg(argv[i]);
+  if (arg.compare(0, 12, "--shard_out=") == 0) {
+    shard_prefix = arg.substr(12);
+  } else if (arg == "--fp16") {
+    storage = FEATURE_FLOAT16;
+  } else if (arg == "--compress") {
+    compress = true;
+  } else {
+  CHECK(feature_extraction_net->has_blob(arg))
+      << "Unknown feature blob name " << arg
       << " in the network " << string(net_proto);
+    blob_names.push_back(arg);
+  }
+  }
+  shared_ptr<FeatureShardWriter> shard_writer;
+  if (!shard_prefix.empty()) {
+    LOG(ERROR) << "Writing features to shards " << shard_prefix;
+    shard_writer.reset(new FeatureShardWriter(shard_prefix, storage, compress));
   }
 
   LOG(ERROR)<< "Extracting features for " << num_mini_batches << " batches";
@@ -90,16 +117,19 @@ int feature_extraction_pipeline(int argc, char** argv) {
 
     if (list_prefix.empty())
     	break;
-    for (int k=7; k<argc; k++){
+    for (int k=0; k<blob_names.size(); k++){
     	const shared_ptr<Blob<Dtype> > feature_blob = feature_extraction_net
-        ->blob_by_name(string(argv[k]));
+        ->blob_by_name(blob_names[k]);
     	int num_features = feature_blob->num();
 
-    	Dtype* feature_blob_data;
         for (int n = 0; n < num_features; ++n) {
           if (list_prefix.size()>n){
-        	  string fn_feat = list_prefix[n] + string(".") + string(argv[k]);
-        	  save_blob_to_binary(feature_blob.get(), fn_feat, n);
+        	  string fn_feat = list_prefix[n] + string(".") + blob_names[k];
+        	  if (shard_writer) {
+        	    shard_writer->Write(fn_feat, feature_blob.get(), n);
+        	  } else {
+        	    save_blob_to_binary(feature_blob.get(), fn_feat, n);
+        	  }
           }
         }
     }
@@ -109,6 +139,9 @@ int feature_extraction_pipeline(int argc, char** argv) {
             " images.";
     }
   }
+  if (shard_writer) {
+    shard_writer->Close();
+  }
   LOG(ERROR)<< "Successfully extracted " << image_index << " features!";
   infile.close();
   return 0;
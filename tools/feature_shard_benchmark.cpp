@@ -0,0 +1,108 @@
+// Copyright 2014 BVLC and contributors.
+//
+// Compares writing and randomly reading clip features as one file per clip
+// (save_blob_to_binary / load_blob_from_binary) against feature shards.
+// Usage:
+//    feature_shard_benchmark output_dir [num_clips=10000] [feature_dim=4096]
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/feature_shard.hpp"
+#include "caffe/util/image_io.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+static string ClipKey(const string& dir, const int clip) {
+  char key[64];
+  snprintf(key, sizeof(key), "/clip_%08d.fc6", clip);
+  return dir + key;
+}
+
+static void BenchmarkShards(const string& dir, const int num_clips,
+    Blob<float>* features, const vector<int>& read_order,
+    const FeatureStorage storage, const bool compress, const string& name) {
+  const string prefix = dir + "/" + name;
+  Timer timer;
+  timer.Start();
+  {
+    FeatureShardWriter writer(prefix, storage, compress);
+    for (int i = 0; i < num_clips; ++i) {
+      writer.Write(ClipKey(dir, i), features, i % features->num());
+    }
+  }
+  timer.Stop();
+  const float write_ms = timer.MilliSeconds();
+  timer.Start();
+  {
+    FeatureShardReader reader(prefix);
+    Blob<float> feature;
+    for (int i = 0; i < read_order.size(); ++i) {
+      CHECK(reader.Read(ClipKey(dir, read_order[i]), &feature));
+    }
+  }
+  timer.Stop();
+  struct stat shard_stat;
+  CHECK_EQ(stat((prefix + ".shard-00000").c_str(), &shard_stat), 0);
+  LOG(ERROR) << name << ": write " << write_ms << " ms, random read "
+      << timer.MilliSeconds() << " ms, first shard " << shard_stat.st_size
+      << " bytes";
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  if (argc < 2 || argc > 4) {
+    LOG(ERROR) << "feature_shard_benchmark output_dir [num_clips=10000]"
+        " [feature_dim=4096]";
+    return 1;
+  }
+  const string dir(argv[1]);
+  const int num_clips = argc >= 3 ? atoi(argv[2]) : 10000;
+  const int feature_dim = argc >= 4 ? atoi(argv[3]) : 4096;
+  Caffe::set_mode(Caffe::CPU);
+
+  // A batch of ReLU-like features, reused for every batch of clips.
+  Blob<float> features(50, feature_dim, 1, 1, 1);
+  float* data = features.mutable_cpu_data();
+  for (int i = 0; i < features.count(); ++i) {
+    data[i] = (rand() % 4 == 0) ? 0 : static_cast<float>(rand()) / RAND_MAX;
+  }
+  vector<int> read_order(num_clips);
+  for (int i = 0; i < num_clips; ++i) {
+    read_order[i] = rand() % num_clips;
+  }
+
+  Timer timer;
+  timer.Start();
+  for (int i = 0; i < num_clips; ++i) {
+    CHECK(save_blob_to_binary(&features, ClipKey(dir, i), i % features.num()));
+  }
+  timer.Stop();
+  const float write_ms = timer.MilliSeconds();
+  timer.Start();
+  Blob<float> feature;
+  for (int i = 0; i < read_order.size(); ++i) {
+    CHECK(load_blob_from_binary(ClipKey(dir, read_order[i]), &feature));
+  }
+  timer.Stop();
+  LOG(ERROR) << "one file per clip: write " << write_ms << " ms, random read "
+      << timer.MilliSeconds() << " ms";
+  for (int i = 0; i < num_clips; ++i) {
+    remove(ClipKey(dir, i).c_str());
+  }
+
+  BenchmarkShards(dir, num_clips, &features, read_order, FEATURE_FLOAT32,
+      false, "float32");
+  BenchmarkShards(dir, num_clips, &features, read_order, FEATURE_FLOAT16,
+      false, "float16");
+  BenchmarkShards(dir, num_clips, &features, read_order, FEATURE_FLOAT16,
+      true, "float16_snappy");
+  return 0;
+}
@@ -0,0 +1,89 @@
+// Copyright 2014 BVLC and contributors.
+//
+// Measures the frame decode throughput of the video data layer: full-size
+// JPEG decode and resize against reduced-scale decode and resize, on the
+// frames 000001.jpg ... of a frame directory.
+// Usage:
+//    frame_decode_benchmark frame_dir num_frames [new_height=128]
+//        [new_width=171] [iterations=3]
+
+#include <opencv2/core/core.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "caffe/common.hpp"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/image_io.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+// Decodes every frame iterations times; returns the frames per second.
+static double DecodeFramesPerSecond(const char* frame_dir, const int num_frames,
+    const int height, const int width, const int iterations,
+    const bool reduced_decode) {
+  char filename[256];
+  cv::Mat img;
+  Timer timer;
+  timer.Start();
+  for (int iter = 0; iter < iterations; ++iter) {
+    for (int i = 1; i <= num_frames; ++i) {
+      snprintf(filename, sizeof(filename), "%s/%06d.jpg", frame_dir, i);
+      CHECK(ReadImageFrame(filename, height, width, reduced_decode, &img))
+          << "Could not read " << filename;
+    }
+  }
+  timer.Stop();
+  return iterations * num_frames * 1000. / timer.MilliSeconds();
+}
+
+// The mean absolute difference between the two ways of reading frame 1.
+static double MeanAbsDifference(const char* frame_dir, const int height,
+    const int width) {
+  char filename[256];
+  snprintf(filename, sizeof(filename), "%s/%06d.jpg", frame_dir, 1);
+  cv::Mat full, reduced;
+  CHECK(ReadImageFrame(filename, height, width, false, &full));
+  CHECK(ReadImageFrame(filename, height, width, true, &reduced));
+  double sum = 0;
+  for (int h = 0; h < height; ++h) {
+    for (int w = 0; w < width; ++w) {
+      for (int c = 0; c < 3; ++c) {
+        sum += std::abs(full.at<cv::Vec3b>(h, w)[c] -
+            reduced.at<cv::Vec3b>(h, w)[c]);
+      }
+    }
+  }
+  return sum / (height * width * 3);
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  if (argc < 3 || argc > 6) {
+    LOG(ERROR) << "frame_decode_benchmark frame_dir num_frames"
+        " [new_height=128] [new_width=171] [iterations=3]";
+    return 1;
+  }
+  const char* frame_dir = argv[1];
+  const int num_frames = atoi(argv[2]);
+  const int height = argc >= 4 ? atoi(argv[3]) : 128;
+  const int width = argc >= 5 ? atoi(argv[4]) : 171;
+  const int iterations = argc >= 6 ? atoi(argv[5]) : 3;
+  CHECK_GT(num_frames, 0);
+  CHECK_GT(height, 0);
+  CHECK_GT(width, 0);
+
+  // Warm the page cache so that both runs measure decoding, not the disk.
+  DecodeFramesPerSecond(frame_dir, num_frames, height, width, 1, false);
+  const double full_fps = DecodeFramesPerSecond(frame_dir, num_frames,
+      height, width, iterations, false);
+  const double reduced_fps = DecodeFramesPerSecond(frame_dir, num_frames,
+      height, width, iterations, true);
+  LOG(ERROR) << "Full decode and resize: " << full_fps << " frames/s";
+  LOG(ERROR) << "Reduced decode and resize: " << reduced_fps << " frames/s ("
+      << reduced_fps / full_fps << "x)";
+  LOG(ERROR) << "Mean absolute pixel difference: "
+      << MeanAbsDifference(frame_dir, height, width);
+  return 0;
+}
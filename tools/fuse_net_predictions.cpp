@@ -0,0 +1,189 @@
+// Copyright 2014 BVLC and contributors.
+//
+// Late fusion of several nets (e.g. the RGB and depth C3D streams) in one
+// process: every net runs its test batches in its own thread, its score blob
+// is weighted and summed per example, and only the fused predictions are
+// written, one "<list line> <predicted label>" line per example.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/net.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+template <typename Dtype>
+struct FusionStream {
+  shared_ptr<Net<Dtype> > net;
+  Dtype weight;
+  string score_blob_name;
+  int num_mini_batches;
+  int device_id;
+  // weight times the scores of every example, in batch order.
+  vector<Dtype> scores;
+  int dim;
+};
+
+template <typename Dtype>
+void* RunFusionStream(void* arg) {
+  FusionStream<Dtype>* stream = static_cast<FusionStream<Dtype>*>(arg);
+  if (Caffe::mode() == Caffe::GPU) {
+    // The current device is a property of the thread.
+    CUDA_CHECK(cudaSetDevice(stream->device_id));
+  }
+  const shared_ptr<Blob<Dtype> > score_blob =
+      stream->net->blob_by_name(stream->score_blob_name);
+  vector<Blob<Dtype>*> input_vec;
+  stream->dim = 0;
+  for (int batch_index = 0; batch_index < stream->num_mini_batches;
+       ++batch_index) {
+    stream->net->Forward(input_vec);
+    const int dim = score_blob->count() / score_blob->num();
+    CHECK(stream->dim == 0 || stream->dim == dim);
+    stream->dim = dim;
+    const Dtype* score = score_blob->cpu_data();
+    for (int i = 0; i < score_blob->count(); ++i) {
+      stream->scores.push_back(stream->weight * score[i]);
+    }
+  }
+  return static_cast<void*>(NULL);
+}
+
+template <typename Dtype>
+int fusion_pipeline(int argc, char** argv);
+
+int main(int argc, char** argv) {
+  return fusion_pipeline<float>(argc, argv);
+}
+
+template <typename Dtype>
+int fusion_pipeline(int argc, char** argv) {
+  const int num_required_args = 8;
+  if (argc < num_required_args) {
+    LOG(ERROR) <<
+    "This program runs several trained networks over the same examples in "
+    "one process, fuses their scores with the given weights and writes the "
+    "predictions.\n"
+    "Usage: fuse_net_predictions  score_blob_name  num_mini_batches"
+    "  list_file  save_prediction_file"
+    "  net_proto_1  pretrained_net_param_1  fusion_weight_1"
+    "  [net_proto_2  pretrained_net_param_2  fusion_weight_2 ...]"
+    "  [CPU/GPU]  [DEVICE_ID=0]\n"
+    "Line i of save_prediction_file is line i of list_file followed by the "
+    "1-based index of the highest fused score of example i.";
+    return 1;
+  }
+  int arg_pos = 0;  // the name of the executable
+  const string score_blob_name(argv[++arg_pos]);
+  const int num_mini_batches = atoi(argv[++arg_pos]);
+  const string list_file(argv[++arg_pos]);
+  const string save_prediction_file(argv[++arg_pos]);
+  vector<string> net_protos, pretrained_nets;
+  vector<Dtype> weights;
+  while (arg_pos + 3 < argc && strcmp(argv[arg_pos + 1], "CPU") != 0 &&
+      strcmp(argv[arg_pos + 1], "GPU") != 0) {
+    net_protos.push_back(argv[++arg_pos]);
+    pretrained_nets.push_back(argv[++arg_pos]);
+    weights.push_back(atof(argv[++arg_pos]));
+  }
+  CHECK_GT(net_protos.size(), 0) << "No networks to fuse.";
+  CHECK(arg_pos + 1 == argc || strcmp(argv[arg_pos + 1], "CPU") == 0 ||
+      strcmp(argv[arg_pos + 1], "GPU") == 0)
+      << "Every network needs a net_proto, pretrained_net_param and "
+      << "fusion_weight.";
+
+  int device_id = 0;
+  if (arg_pos + 1 < argc && strcmp(argv[arg_pos + 1], "GPU") == 0) {
+    ++arg_pos;
+    if (arg_pos + 1 < argc) {
+      device_id = atoi(argv[++arg_pos]);
+      CHECK_GE(device_id, 0);
+    }
+    LOG(ERROR) << "Using GPU, device_id=" << device_id;
+    Caffe::SetDevice(device_id);
+    Caffe::set_mode(Caffe::GPU);
+  } else {
+    LOG(ERROR) << "Using CPU";
+    Caffe::set_mode(Caffe::CPU);
+  }
+  Caffe::set_phase(Caffe::TEST);
+
+  vector<string> lines;
+  std::ifstream infile(list_file.c_str());
+  CHECK(infile.good()) << "Failed to open list file " << list_file;
+  string line;
+  while (std::getline(infile, line)) {
+    lines.push_back(line);
+  }
+  LOG(INFO) << "A total of " << lines.size() << " examples.";
+
+  // The nets are created, with their prefetch threads, before any stream
+  // starts, so all of them decode their first batches at once.
+  const int num_streams = net_protos.size();
+  vector<FusionStream<Dtype> > streams(num_streams);
+  for (int s = 0; s < num_streams; ++s) {
+    LOG(INFO) << "Stream " << s << ": " << net_protos[s] << " with weights "
+        << pretrained_nets[s] << ", fusion weight " << weights[s];
+    streams[s].net.reset(new Net<Dtype>(net_protos[s]));
+    streams[s].net->CopyTrainedLayersFrom(pretrained_nets[s]);
+    CHECK(streams[s].net->has_blob(score_blob_name))
+        << "Unknown score blob name " << score_blob_name
+        << " in the network " << net_protos[s];
+    streams[s].weight = weights[s];
+    streams[s].score_blob_name = score_blob_name;
+    streams[s].num_mini_batches = num_mini_batches;
+    streams[s].device_id = device_id;
+  }
+  LOG(ERROR) << "Running " << num_streams << " streams";
+  vector<pthread_t> threads(num_streams);
+  for (int s = 0; s < num_streams; ++s) {
+    CHECK(!pthread_create(&threads[s], NULL, RunFusionStream<Dtype>,
+        &streams[s])) << "Pthread execution failed.";
+  }
+  for (int s = 0; s < num_streams; ++s) {
+    CHECK(!pthread_join(threads[s], NULL)) << "Pthread joining failed.";
+  }
+
+  const int dim = streams[0].dim;
+  vector<Dtype>& fused = streams[0].scores;
+  for (int s = 1; s < num_streams; ++s) {
+    CHECK_EQ(streams[s].dim, dim) << "Stream " << s << " has " <<
+        streams[s].dim << " scores per example instead of " << dim;
+    CHECK_EQ(streams[s].scores.size(), fused.size());
+    for (int i = 0; i < fused.size(); ++i) {
+      fused[i] += streams[s].scores[i];
+    }
+  }
+  // The last batch may wrap around to the start of the list.
+  const int num_examples = fused.size() / dim;
+  const int num_predictions = std::min<int>(num_examples, lines.size());
+  if (num_examples < lines.size()) {
+    LOG(ERROR) << "Only " << num_examples << " of the " << lines.size()
+        << " examples were run.";
+  }
+  std::ofstream outfile(save_prediction_file.c_str());
+  CHECK(outfile.good()) << "Failed to open " << save_prediction_file;
+  for (int n = 0; n < num_predictions; ++n) {
+    const Dtype* score = &fused[n * dim];
+    int best = 0;
+    for (int d = 1; d < dim; ++d) {
+      if (score[d] > score[best]) {
+        best = d;
+      }
+    }
+    outfile << lines[n] << " " << best + 1 << "\n";
+  }
+  outfile.close();
+  LOG(ERROR) << "Wrote " << num_predictions << " predictions to "
+      << save_prediction_file;
+  return 0;
+}
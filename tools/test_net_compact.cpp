@@ -0,0 +1,100 @@
+// Copyright 2014 BVLC and contributors.
+//
+// Runs a pre-trained network on CPU twice, once as is and once with its
+// weights and activations in compact 16-bit storage (see
+// Net::CompactWeights and Net::CompactActivations), and reports the accuracy
+// of both, the largest output difference, the memory saved and the forward
+// time of every layer that uses compact storage.
+// Usage:
+//    test_net_compact net_proto pretrained_net_proto iterations
+//        [FLOAT16/BFLOAT16]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "caffe/caffe.hpp"
+#include "caffe/util/benchmark.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+// Milliseconds per forward pass of layer i of net, over iterations passes.
+static float TimeLayer(Net<float>* net, const int i, const int iterations) {
+  Timer timer;
+  timer.Start();
+  for (int j = 0; j < iterations; ++j) {
+    net->layers()[i]->Forward(net->bottom_vecs()[i], &net->top_vecs()[i]);
+  }
+  return timer.MilliSeconds() / iterations;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 4 || argc > 5) {
+    LOG(ERROR) << "test_net_compact net_proto pretrained_net_proto iterations "
+        << "[FLOAT16/BFLOAT16]";
+    return 1;
+  }
+  HalfFormat format = HALF_FLOAT16;
+  if (argc == 5 && strcmp(argv[4], "BFLOAT16") == 0) {
+    format = HALF_BFLOAT16;
+  } else if (argc == 5) {
+    CHECK_EQ(strcmp(argv[4], "FLOAT16"), 0) << "Unknown format " << argv[4];
+  }
+
+  Caffe::set_phase(Caffe::TEST);
+  Caffe::set_mode(Caffe::CPU);
+  Net<float> full_net(argv[1]);
+  full_net.CopyTrainedLayersFrom(argv[2]);
+  Net<float> compact_net(argv[1]);
+  compact_net.CopyTrainedLayersFrom(argv[2]);
+  const size_t bytes_saved = compact_net.CompactWeights(format);
+  LOG(ERROR) << "Compact weights save " << bytes_saved / (1024. * 1024.)
+      << " MB";
+  const size_t activation_bytes_saved = compact_net.CompactActivations(format);
+  LOG(ERROR) << "Compact activations save "
+      << activation_bytes_saved / (1024. * 1024.) << " MB";
+
+  int total_iter = atoi(argv[3]);
+  LOG(ERROR) << "Running " << total_iter << " iterations.";
+  double full_accuracy = 0;
+  double compact_accuracy = 0;
+  float max_diff = 0;
+  for (int i = 0; i < total_iter; ++i) {
+    const vector<Blob<float>*>& full_result = full_net.ForwardPrefilled();
+    const vector<Blob<float>*>& compact_result =
+        compact_net.ForwardPrefilled();
+    full_accuracy += full_result[0]->cpu_data()[0];
+    compact_accuracy += compact_result[0]->cpu_data()[0];
+    for (int j = 0; j < full_result.size(); ++j) {
+      const float* full_data = full_result[j]->cpu_data();
+      const float* compact_data = compact_result[j]->cpu_data();
+      for (int k = 0; k < full_result[j]->count(); ++k) {
+        max_diff = std::max(max_diff, std::fabs(full_data[k] -
+            compact_data[k]));
+      }
+    }
+  }
+  LOG(ERROR) << "Test accuracy: " << full_accuracy / total_iter
+      << ", compact: " << compact_accuracy / total_iter;
+  LOG(ERROR) << "Largest output difference: " << max_diff;
+
+  for (int i = 0; i < compact_net.layers().size(); ++i) {
+    const vector<shared_ptr<Blob<float> > >& blobs =
+        compact_net.layers()[i]->blobs();
+    bool compact = blobs.size() && blobs[0]->compact();
+    for (int j = 0; j < compact_net.bottom_vecs()[i].size(); ++j) {
+      compact |= compact_net.bottom_vecs()[i][j]->compact();
+    }
+    for (int j = 0; j < compact_net.top_vecs()[i].size(); ++j) {
+      compact |= compact_net.top_vecs()[i][j]->compact();
+    }
+    if (compact) {
+      LOG(ERROR) << compact_net.layer_names()[i] << "\tforward: "
+          << TimeLayer(&full_net, i, total_iter) << " ms, compact: "
+          << TimeLayer(&compact_net, i, total_iter) << " ms";
+    }
+  }
+  return 0;
+}